@@ -0,0 +1,304 @@
+// vDSO task-info benchmark and correctness harness
+//
+// usage: bench [iterations] [threads]
+// Every result is printed as one "name value unit" line so that runs on
+// different kernel builds can be diffed or collected by a script.
+#include <elf.h>
+#include <sched.h>
+#include <sys/auxv.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern "C" {
+
+struct task_info {
+  pid_t pid;
+  uint64_t task_token;
+  uint32_t cpu;
+  uint32_t node;
+  uint64_t nvcsw;
+  uint64_t nivcsw;
+  uint64_t sum_exec_runtime;
+  uint32_t state;
+  uint32_t reserved;
+  uint64_t rss;
+  pid_t vpid;
+  pid_t vtid;
+};
+}
+
+#define __NR_get_task_info_batch 454
+
+typedef int (*vdso_get_task_info_t)(struct task_info *info, size_t size);
+
+static vdso_get_task_info_t vdso_get_task_info;
+static int failures;
+
+// 在 vDSO 的动态符号表里查找 __vdso_get_task_info
+static vdso_get_task_info_t find_vdso_symbol(const char *name) {
+  auto base = getauxval(AT_SYSINFO_EHDR);
+  if (!base) return nullptr;
+  auto *ehdr = reinterpret_cast<const Elf64_Ehdr *>(base);
+  auto *phdr = reinterpret_cast<const Elf64_Phdr *>(base + ehdr->e_phoff);
+
+  uintptr_t load_offset = 0;
+  const Elf64_Dyn *dyn = nullptr;
+  for (int i = 0; i < ehdr->e_phnum; ++i) {
+    if (phdr[i].p_type == PT_LOAD && !load_offset)
+      load_offset = base + phdr[i].p_offset - phdr[i].p_vaddr;
+    else if (phdr[i].p_type == PT_DYNAMIC)
+      dyn = reinterpret_cast<const Elf64_Dyn *>(base + phdr[i].p_offset);
+  }
+  if (!dyn) return nullptr;
+
+  const Elf64_Sym *symtab = nullptr;
+  const char *strtab = nullptr;
+  const Elf64_Word *hash = nullptr;
+  for (; dyn->d_tag != DT_NULL; ++dyn) {
+    auto ptr = dyn->d_un.d_ptr + load_offset;
+    if (dyn->d_tag == DT_SYMTAB)
+      symtab = reinterpret_cast<const Elf64_Sym *>(ptr);
+    else if (dyn->d_tag == DT_STRTAB)
+      strtab = reinterpret_cast<const char *>(ptr);
+    else if (dyn->d_tag == DT_HASH)
+      hash = reinterpret_cast<const Elf64_Word *>(ptr);
+  }
+  if (!symtab || !strtab || !hash) return nullptr;
+
+  for (Elf64_Word i = 0; i < hash[1]; ++i) {
+    if (ELF64_ST_TYPE(symtab[i].st_info) != STT_FUNC) continue;
+    if (symtab[i].st_shndx == SHN_UNDEF) continue;
+    if (strcmp(strtab + symtab[i].st_name, name) == 0)
+      return reinterpret_cast<vdso_get_task_info_t>(symtab[i].st_value +
+                                                    load_offset);
+  }
+  return nullptr;
+}
+
+static void report(const std::string &name, double value,
+                   const std::string &unit) {
+  std::cout << name << " " << value << " " << unit << std::endl;
+}
+
+static void check(bool ok, const std::string &what) {
+  if (!ok) {
+    ++failures;
+    std::cerr << "FAIL " << what << std::endl;
+  }
+}
+
+static pid_t proc_stat_pid() {
+  std::ifstream stat_file("/proc/self/stat");
+  pid_t pid = -1;
+  stat_file >> pid;
+  return pid;
+}
+
+template <typename F>
+static double ns_per_call(long iterations, F &&fn) {
+  auto start = std::chrono::steady_clock::now();
+  for (long i = 0; i < iterations; ++i) fn();
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         iterations;
+}
+
+static void bench_calls(long iterations) {
+  task_info info;
+  volatile pid_t sink;
+
+  report("ns_per_call.vdso_get_task_info", ns_per_call(iterations, [&] {
+           vdso_get_task_info(&info, sizeof(info));
+           sink = info.pid;
+         }),
+         "ns");
+  report("ns_per_call.syscall_getpid", ns_per_call(iterations, [&] {
+           sink = syscall(SYS_getpid);
+         }),
+         "ns");
+  report("ns_per_call.proc_self_stat", ns_per_call(iterations / 100 + 1, [&] {
+           sink = proc_stat_pid();
+         }),
+         "ns");
+
+  pid_t self = getpid();
+  report("ns_per_call.get_task_info_batch_1", ns_per_call(iterations, [&] {
+           syscall(__NR_get_task_info_batch, &self, &info, 1, sizeof(info));
+           sink = info.pid;
+         }),
+         "ns");
+  (void)sink;
+}
+
+static void check_fork() {
+  const int num_forks = 64;
+  int bad = 0;
+  for (int i = 0; i < num_forks; ++i) {
+    pid_t pid = fork();
+    if (pid == 0) {
+      task_info info;
+      vdso_get_task_info(&info, sizeof(info));
+      _exit(info.vpid == getpid() && info.vpid == proc_stat_pid() ? 0 : 1);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) ++bad;
+  }
+  check(bad == 0, "fork: " + std::to_string(bad) + " children saw wrong pid");
+  report("check.fork_children", num_forks, "tasks");
+}
+
+// 每个线程（clone(CLONE_THREAD)）应当看到自己的 tid 和不同的令牌
+static void check_threads(int num_threads) {
+  std::vector<uint64_t> tokens(num_threads);
+  std::atomic<int> bad{0};
+  std::vector<std::thread> threads;
+  std::atomic<bool> go{false};
+
+  for (int i = 0; i < num_threads; ++i) {
+    threads.emplace_back([&, i] {
+      while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+      task_info info;
+      // pid 是全局 tid，只有在初始 pid 命名空间里才等于 gettid()
+      if (vdso_get_task_info(&info, sizeof(info)) < 0 || info.pid <= 0 ||
+          info.vtid != gettid() || info.vpid != getpid())
+        bad.fetch_add(1);
+      tokens[i] = info.task_token;
+    });
+  }
+  auto start = std::chrono::steady_clock::now();
+  go.store(true, std::memory_order_release);
+  for (auto &t : threads) t.join();
+  auto end = std::chrono::steady_clock::now();
+
+  std::set<uint64_t> unique(tokens.begin(), tokens.end());
+  check(bad == 0, "threads: " + std::to_string(bad.load()) +
+                      " threads saw wrong tid");
+  check(unique.size() == tokens.size(), "threads: duplicate task tokens");
+  report("check.threads", num_threads, "tasks");
+  report("check.threads_wall",
+         std::chrono::duration<double, std::milli>(end - start).count(), "ms");
+}
+
+// 新 pid 命名空间里的第一个子进程应当是 1 号进程，vpid/vtid 随之为 1，
+// pid 仍是全局 tid
+static void check_pid_namespace() {
+  pid_t pid = fork();
+  if (pid == 0) {
+    if (unshare(CLONE_NEWPID) != 0) _exit(2);
+    pid_t child = fork();
+    if (child == 0) {
+      task_info info;
+      vdso_get_task_info(&info, sizeof(info));
+      _exit(getpid() == 1 && info.vpid == getpid() &&
+                    info.vtid == gettid() && info.pid != 1
+                ? 0
+                : 1);
+    }
+    int status;
+    waitpid(child, &status, 0);
+    _exit(WIFEXITED(status) ? WEXITSTATUS(status) : 1);
+  }
+  int status;
+  waitpid(pid, &status, 0);
+  if (WIFEXITED(status) && WEXITSTATUS(status) == 2) {
+    std::cerr << "SKIP unshare(CLONE_NEWPID): not permitted" << std::endl;
+    return;
+  }
+  check(WIFEXITED(status) && WEXITSTATUS(status) == 0,
+        "unshare(CLONE_NEWPID): vDSO vpid/vtid do not match getpid()");
+  report("check.pid_namespace", 1, "tasks");
+}
+
+// exec 不改变线程身份：pid 与令牌都应保持不变
+static void check_exec(const char *self_exe) {
+  task_info info;
+  vdso_get_task_info(&info, sizeof(info));
+
+  pid_t pid = fork();
+  if (pid == 0) {
+    vdso_get_task_info(&info, sizeof(info));
+    std::string token = std::to_string(info.task_token);
+    std::string pid_str = std::to_string(info.pid);
+    execl(self_exe, self_exe, "--exec-check", pid_str.c_str(), token.c_str(),
+          nullptr);
+    _exit(3);
+  }
+  int status;
+  waitpid(pid, &status, 0);
+  check(WIFEXITED(status) && WEXITSTATUS(status) == 0,
+        "exec: pid or task token changed across exec");
+  report("check.exec", 1, "tasks");
+}
+
+static int exec_check(const char *pid_str, const char *token_str) {
+  task_info info;
+  if (vdso_get_task_info(&info, sizeof(info)) < 0) return 1;
+  return info.pid == atoi(pid_str) && info.vtid == getpid() &&
+                 info.task_token == strtoull(token_str, nullptr, 10)
+             ? 0
+             : 1;
+}
+
+// 依次绑到每个 CPU 上，vDSO 报告的 cpu 应当跟着变
+static void check_migration() {
+  cpu_set_t orig, set;
+  sched_getaffinity(0, sizeof(orig), &orig);
+  int checked = 0, bad = 0;
+  for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+    if (!CPU_ISSET(cpu, &orig)) continue;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) continue;
+    task_info info;
+    vdso_get_task_info(&info, sizeof(info));
+    if (info.cpu != static_cast<uint32_t>(cpu)) ++bad;
+    ++checked;
+  }
+  sched_setaffinity(0, sizeof(orig), &orig);
+  check(bad == 0, "migration: cpu field stale on " + std::to_string(bad) +
+                      " of " + std::to_string(checked) + " CPUs");
+  report("check.migration_cpus", checked, "cpus");
+}
+
+int main(int argc, char **argv) {
+  vdso_get_task_info = find_vdso_symbol("__vdso_get_task_info");
+  if (!vdso_get_task_info) {
+    std::cerr << "__vdso_get_task_info not exported by this kernel"
+              << std::endl;
+    return 1;
+  }
+  if (argc == 4 && strcmp(argv[1], "--exec-check") == 0)
+    return exec_check(argv[2], argv[3]);
+
+  long iterations = argc > 1 ? atol(argv[1]) : 1000000;
+  int num_threads = argc > 2 ? atoi(argv[2]) : 4000;
+  if (iterations <= 0 || num_threads <= 0) {
+    std::cerr << "usage: " << argv[0] << " [iterations] [threads]"
+              << " (both must be positive)" << std::endl;
+    return 1;
+  }
+
+  bench_calls(iterations);
+  check_fork();
+  check_threads(num_threads);
+  check_pid_namespace();
+  check_exec("/proc/self/exe");
+  check_migration();
+
+  report("check.failures", failures, "checks");
+  return failures ? 1 : 0;
+}
@@ -1,22 +1,58 @@
+#include <sys/syscall.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
+#include <cstdint>
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <sstream>
 #include <string>
 
 extern "C" {
 
 struct task_info {
   pid_t pid;
-  void *task_struct_ptr;
-  // other key fields...
+  uint64_t task_token;
+  uint32_t cpu;
+  uint32_t node;
+  uint64_t nvcsw;
+  uint64_t nivcsw;
+  uint64_t sum_exec_runtime;
+  uint32_t state;
+  uint32_t reserved;
+  uint64_t rss;
+  pid_t vpid;
+  pid_t vtid;
 };
 
 int get_task_struct_info(struct task_info *info);
 }
 
+#define __NR_get_task_info_batch 454
+
+// field 39 of /proc/self/stat: CPU number last executed on
+static int proc_stat_cpu() {
+  std::ifstream stat_file("/proc/self/stat");
+  std::string line;
+  if (!std::getline(stat_file, line)) return -1;
+  // comm may contain spaces, skip past the closing ')'
+  std::istringstream rest(line.substr(line.rfind(')') + 2));
+  std::string field;
+  for (int i = 3; i <= 39 && rest >> field; ++i)
+    if (i == 39) return std::stoi(field);
+  return -1;
+}
+
+static uint64_t proc_status_field(const std::string &key) {
+  std::ifstream status_file("/proc/self/status");
+  std::string line;
+  while (std::getline(status_file, line))
+    if (line.compare(0, key.size(), key) == 0)
+      return std::stoull(line.substr(key.size() + 1));
+  return 0;
+}
+
 int main() {
   task_info info;
   if (get_task_struct_info(&info) != 0) {
@@ -38,6 +74,31 @@ int main() {
   } else {
     std::cout << "PID matches: " << pid_proc << std::endl;
   }
+  // the counters below move between the two reads, so only report them
+  get_task_struct_info(&info);
+  std::cout << "cpu: vDSO " << info.cpu << " (node " << info.node
+            << "), /proc " << proc_stat_cpu() << std::endl;
+  std::cout << "voluntary_ctxt_switches: vDSO " << info.nvcsw << ", /proc "
+            << proc_status_field("voluntary_ctxt_switches") << std::endl;
+  std::cout << "nonvoluntary_ctxt_switches: vDSO " << info.nivcsw
+            << ", /proc " << proc_status_field("nonvoluntary_ctxt_switches")
+            << std::endl;
+  std::cout << "sum_exec_runtime: " << info.sum_exec_runtime << " ns"
+            << std::endl;
+
+  pid_t self = getpid();
+  task_info batch_info;
+  long found = syscall(__NR_get_task_info_batch, &self, &batch_info, 1,
+                       sizeof(batch_info));
+  // pid 与 vDSO 一样是全局 tid，命名空间内的 tid 在 vtid
+  if (found != 1 || batch_info.pid != info.pid || batch_info.vtid != self ||
+      batch_info.task_token != info.task_token) {
+    std::cerr << "get_task_info_batch mismatch: found " << found << ", pid "
+              << batch_info.pid << std::endl;
+  } else {
+    std::cout << "get_task_info_batch matches, rss " << batch_info.rss
+              << " pages" << std::endl;
+  }
   const int num_forks = 5;
   for (int i = 0; i < num_forks; ++i) {
     pid_t pid = fork();
@@ -66,6 +127,10 @@ int main() {
       } else {
         std::cout << "Child PID matches: " << child_pid_proc << std::endl;
       }
+      if (child_info.task_token == info.task_token) {
+        std::cerr << "Child task token equals parent's: " << std::hex
+                  << child_info.task_token << std::endl;
+      }
       exit(0);
     } else {
       int status;
@@ -0,0 +1,80 @@
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <iostream>
+
+extern "C" {
+
+struct sched_ring_record {
+  uint64_t timestamp;
+  uint32_t cpu;
+  uint8_t event;
+  uint8_t state;
+  uint16_t reserved;
+};
+
+struct sched_ring_header {
+  uint64_t head;
+  uint32_t mask;
+  uint32_t reserved;
+  struct sched_ring_record records[];
+};
+}
+
+#define __NR_register_sched_ring 455
+#define SCHED_RING_OUT 1
+#define SCHED_RING_IN 2
+
+int main() {
+  const unsigned nr_records = 256;
+  size_t size =
+      sizeof(sched_ring_header) + nr_records * sizeof(sched_ring_record);
+  auto *ring = static_cast<sched_ring_header *>(
+      mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+           -1, 0));
+  if (ring == MAP_FAILED) {
+    std::cerr << "Failed to mmap ring" << std::endl;
+    return 1;
+  }
+  if (syscall(__NR_register_sched_ring, ring, nr_records) != 0) {
+    std::cerr << "Failed to register sched ring" << std::endl;
+    return 1;
+  }
+
+  const int num_sleeps = 5;
+  for (int i = 0; i < num_sleeps; ++i) usleep(10000);
+
+  // 单消费者：自己维护 tail，读完后检查记录是否已被覆盖
+  uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+  uint64_t tail = head > nr_records ? head - nr_records : 0;
+  uint64_t last_out = 0;
+  int off_cpu = 0;
+  for (uint64_t i = tail; i < head; ++i) {
+    sched_ring_record rec = ring->records[i & ring->mask];
+    // 内核在 head == i + mask + 1 时已经在写这个槽，等号也要丢弃
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&ring->head, __ATOMIC_RELAXED) - i >=
+        uint64_t(ring->mask) + 1)
+      continue;
+    if (rec.event == SCHED_RING_OUT) {
+      last_out = rec.timestamp;
+    } else if (rec.event == SCHED_RING_IN && last_out) {
+      std::cout << "off-CPU " << (rec.timestamp - last_out) / 1000
+                << " us (state " << int(rec.state) << ", back on cpu "
+                << rec.cpu << ")" << std::endl;
+      if (rec.state != 0) ++off_cpu;
+      last_out = 0;
+    }
+  }
+
+  syscall(__NR_register_sched_ring, nullptr, 0);
+  if (off_cpu < num_sleeps) {
+    std::cerr << "Expected at least " << num_sleeps
+              << " sleeping switches, got " << off_cpu << std::endl;
+    return 1;
+  }
+  std::cout << "Sched ring recorded " << head << " events" << std::endl;
+  return 0;
+}
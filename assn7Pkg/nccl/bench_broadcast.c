@@ -0,0 +1,98 @@
+// Broadcast bandwidth over the shared-memory transport: N forked ranks
+// broadcast a buffer from a rotating root for a number of iterations. Reports
+// the per-call latency and the algorithm bandwidth (bytes / time), for a
+// range of chunk sizes so the pipelining depth can be tuned.
+//
+// build: cc -O2 -DNCCL_BROADCAST_NO_CUDA bench_broadcast.c nccl_broadcast_shm.c
+// usage: bench_broadcast [ranks] [MiB] [iterations] [slots]
+#define _GNU_SOURCE
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "nccl_broadcast.h"
+
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int run(int nranks, size_t bytes, int iters, size_t chunk, int slots) {
+  struct nccl_broadcast_shm_config config = {chunk, slots, 10000};
+  pid_t pids[nranks];
+  char name[64];
+  int pipefd[2], status, failed = 0;
+  double sec = 0;
+  pid_t pid;
+
+  snprintf(name, sizeof(name), "/bench_broadcast.%d", getpid());
+  if (pipe(pipefd) < 0) return 1;
+  memset(pids, 0, sizeof(pids));
+  for (int r = 0; r < nranks && !failed; ++r) {
+    pids[r] = fork();
+    if (pids[r] < 0) {
+      perror("fork");
+      pids[r] = 0;
+      failed = 1;
+    }
+    if (pids[r] != 0 || failed) continue;
+    close(pipefd[0]);
+    struct nccl_broadcast_transport* t =
+        nccl_broadcast_shm_open(name, r, nranks, &config);
+    float* data = malloc(bytes);
+    if (!t || !data) _exit(1);
+    memset(data, r, bytes);
+    nccl_broadcast(t, data, bytes / sizeof(float), 0);  // 预热
+    double start = now_sec();
+    for (int i = 0; i < iters; ++i)
+      nccl_broadcast(t, data, bytes / sizeof(float), i % nranks);
+    double elapsed = now_sec() - start;
+    // rank 0 报告时间，它作为 root 与读者的次数与其他 rank 相同
+    if (r == 0 && write(pipefd[1], &elapsed, sizeof(elapsed)) < 0) _exit(1);
+    nccl_broadcast_close(t);
+    _exit(0);
+  }
+  // 父进程不持有写端，rank 0 没写就退出时 read 读到 EOF 而不是一直阻塞
+  close(pipefd[1]);
+
+  // 缺了一个 rank，其余 rank 会一直等它，只能全部杀掉
+  if (failed)
+    for (int r = 0; r < nranks; ++r)
+      if (pids[r] > 0) kill(pids[r], SIGKILL);
+  while ((pid = wait(&status)) > 0) {
+    if (failed || (WIFEXITED(status) && WEXITSTATUS(status) == 0)) continue;
+    fprintf(stderr, "rank process %d failed: status %d\n", (int)pid, status);
+    for (int r = 0; r < nranks; ++r)
+      if (pids[r] > 0 && pids[r] != pid) kill(pids[r], SIGKILL);
+    failed = 1;
+  }
+  if (read(pipefd[0], &sec, sizeof(sec)) != sizeof(sec)) failed = 1;
+  close(pipefd[0]);
+  if (failed) {
+    shm_unlink(name);  // 没有 rank 走到 close，段还在
+    return 1;
+  }
+
+  printf("shm.%d.%zuK.latency_us %.1f\n", nranks, chunk >> 10,
+         sec / iters * 1e6);
+  printf("shm.%d.%zuK.algbw_gbps %.2f\n", nranks, chunk >> 10,
+         (double)bytes * iters / sec / 1e9);
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  int nranks = argc > 1 ? atoi(argv[1]) : 4;
+  size_t bytes = (argc > 2 ? atol(argv[2]) : 64) << 20;
+  int iters = argc > 3 ? atoi(argv[3]) : 20;
+  int slots = argc > 4 ? atoi(argv[4]) : 8;
+
+  for (size_t chunk = 16 << 10; chunk <= 4 << 20; chunk <<= 2)
+    if (run(nranks, bytes, iters, chunk, slots) != 0) return 1;
+  return 0;
+}
@@ -1,5 +1,6 @@
+#include "nccl_broadcast.h"
+
 #include <cuda_runtime.h>
-#include <nccl.h>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -24,6 +25,11 @@
     }                                                       \
   } while (0)
 
+struct nccl_transport {
+  struct nccl_broadcast_transport base;  // 必须是第一个成员
+  ncclComm_t comm;
+};
+
 // 广播操作
 ncclResult_t nccl_broadcast_data(void* data, size_t count, int root,
                                  ncclComm_t comm) {
@@ -35,8 +41,38 @@ ncclResult_t nccl_broadcast_data(void* data, size_t count, int root,
   CHECK_CUDA(cudaMemcpyAsync(d_ptr, data, count * sizeof(float),
                              cudaMemcpyHostToDevice, stream));
   CHECK_NCCL(ncclBroadcast(d_ptr, d_ptr, count, ncclFloat, root, comm, stream));
+  // 把广播的结果拷回主机，非 root 的 data 才得到 root 的数据
+  CHECK_CUDA(cudaMemcpyAsync(data, d_ptr, count * sizeof(float),
+                             cudaMemcpyDeviceToHost, stream));
   CHECK_CUDA(cudaStreamSynchronize(stream));
   CHECK_CUDA(cudaFree(d_ptr));
+  CHECK_CUDA(cudaStreamDestroy(stream));
 
   return ncclSuccess;
-}
\ No newline at end of file
+}
+
+static int nccl_transport_broadcast(struct nccl_broadcast_transport* t,
+                                    void* data, size_t bytes, int root) {
+  struct nccl_transport* n = (struct nccl_transport*)t;
+  return nccl_broadcast_data(data, bytes / sizeof(float), root, n->comm) ==
+                 ncclSuccess
+             ? 0
+             : -1;
+}
+
+static void nccl_transport_close(struct nccl_broadcast_transport* t) {
+  free(t);
+}
+
+struct nccl_broadcast_transport* nccl_broadcast_nccl_open(ncclComm_t comm) {
+  struct nccl_transport* n = calloc(1, sizeof(*n));
+
+  if (!n) return NULL;
+  n->base.name = "nccl";
+  CHECK_NCCL(ncclCommUserRank(comm, &n->base.rank));
+  CHECK_NCCL(ncclCommCount(comm, &n->base.nranks));
+  n->base.broadcast = nccl_transport_broadcast;
+  n->base.close = nccl_transport_close;
+  n->comm = comm;
+  return &n->base;
+}
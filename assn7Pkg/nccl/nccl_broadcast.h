@@ -0,0 +1,90 @@
+#ifndef NCCL_BROADCAST_H
+#define NCCL_BROADCAST_H
+#include <stddef.h>
+
+// 可替换传输层的广播
+//
+// 调用方只面对 struct nccl_broadcast_transport：每个 rank 打开同一个通信域
+// 的一个传输端，然后所有 rank 用相同的 count 与 root 调用 nccl_broadcast，
+// 返回时每个 rank 的 data 都与 root 的相同。现有两种后端：
+//   nccl  CUDA + NCCL，数据经显存广播，在 nccl_broadcast.c 中
+//   shm   只用 CPU：同一台机器上的多个进程通过 POSIX 共享内存做流水线式
+//         的分块复制，不需要 GPU，用于开发、测试与 CI，在
+//         nccl_broadcast_shm.c 中
+// 只用 shm 后端、没有 CUDA 的构建定义 NCCL_BROADCAST_NO_CUDA，不编译
+// nccl_broadcast.c。
+
+struct nccl_broadcast_transport {
+  const char* name;  // 后端名称，"nccl" 或 "shm"
+  int rank;
+  int nranks;
+  /**
+   * @brief 把 root 上 data 的 bytes 字节广播到所有 rank
+   * @return 成功返回 0，失败返回负数
+   */
+  int (*broadcast)(struct nccl_broadcast_transport* t, void* data,
+                   size_t bytes, int root);
+  void (*close)(struct nccl_broadcast_transport* t);
+};
+
+/**
+ * @brief 广播 count 个 float，所有 rank 都要以相同的 count 与 root 调用
+ * @return 成功返回 0，失败返回负数
+ */
+static inline int nccl_broadcast(struct nccl_broadcast_transport* t,
+                                 float* data, size_t count, int root) {
+  if (root < 0 || root >= t->nranks) return -1;
+  return t->broadcast(t, data, count * sizeof(float), root);
+}
+
+/**
+ * @brief 关闭传输端，所有 rank 都关闭后通信域的资源才被释放
+ */
+static inline void nccl_broadcast_close(struct nccl_broadcast_transport* t) {
+  if (t) t->close(t);
+}
+
+struct nccl_broadcast_shm_config {
+  size_t chunk_bytes;  // 每块的字节数，按 64 字节向上取整
+  int nr_chunks;       // 共享内存中的块槽数，root 最多领先最慢的 rank 这么多块
+  int join_timeout_ms; // 打开时等所有 rank 到齐的最长时间，0 表示一直等
+};
+
+// 默认：8 个 256KiB 的块槽，最多等 30 秒所有 rank 到齐
+#define NCCL_BROADCAST_SHM_CONFIG_DEFAULT \
+  { 256U << 10, 8, 30000 }
+
+/**
+ * @brief 打开共享内存后端的传输端，所有 rank 都打开后才返回
+ *
+ * 名称在同一台机器上的同一时刻必须唯一，所有 rank 的 nranks 与 config
+ * 必须相同。join_timeout_ms 内没有到齐，或已到的 rank 退出时返回 NULL；
+ * 之后的广播中有 rank 没关闭就退出时返回负数，不会一直等下去。所有 rank
+ * 须在同一个 pid 命名空间中。
+ *
+ * @param name 共享内存名称，形如 "/bcast0"
+ * @param rank 本进程的 rank，0 <= rank < nranks
+ * @param config 参数，NULL 表示使用 NCCL_BROADCAST_SHM_CONFIG_DEFAULT
+ * @return 成功返回传输端，失败返回 NULL
+ */
+struct nccl_broadcast_transport* nccl_broadcast_shm_open(
+    const char* name, int rank, int nranks,
+    const struct nccl_broadcast_shm_config* config);
+
+#ifndef NCCL_BROADCAST_NO_CUDA
+#include <nccl.h>
+
+/**
+ * @brief 在已有的 NCCL 通信域上打开传输端，comm 仍由调用方销毁
+ */
+struct nccl_broadcast_transport* nccl_broadcast_nccl_open(ncclComm_t comm);
+
+/**
+ * @brief 直接在 NCCL 通信域上广播 count 个 float，等价于经
+ *        nccl_broadcast_nccl_open 打开的传输端调用 nccl_broadcast
+ */
+ncclResult_t nccl_broadcast_data(void* data, size_t count, int root,
+                                 ncclComm_t comm);
+#endif
+
+#endif
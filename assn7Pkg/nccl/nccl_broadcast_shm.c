@@ -0,0 +1,253 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "nccl_broadcast.h"
+
+// 共享内存后端
+//
+// 段内是一个块槽环：root 把数据按块依次复制进槽，每写完一块就把该槽的
+// ready 置为这一块的全局序号；其余 rank 等到自己要的序号出现后把块复制
+// 出来，再把槽的 reads 加 1。root 重用一个槽之前要等所有 rank 都读完它
+// 上一次装的块，因此 root 写第 k 块时其他 rank 可以同时在读前面的块，
+// 复制是流水线式的。块的全局序号跨多次广播连续递增，各 rank 按相同的
+// 调用序列各自计算，不需要额外同步。
+//
+// 段头之后是每个 rank 的 pid，打开时写入、关闭时清零。等待对端时定期
+// 检查其中仍未关闭的 rank 是否还活着，有 rank 异常退出就返回错误，而不是
+// 一直等一个永远不会来的块。
+
+enum { SEG_EMPTY, SEG_INIT, SEG_READY };
+
+struct seg_header {
+  uint32_t state;  // SEG_*
+  uint32_t nranks;
+  uint64_t chunk_bytes;
+  uint32_t nr_chunks;
+  uint32_t joined;  // 已打开的 rank 数
+  uint32_t left;    // 已关闭的 rank 数
+};
+
+_Static_assert(sizeof(struct seg_header) <= 64, "seg_header fits one line");
+
+struct seg_slot {
+  uint64_t ready;  // 最后写进这个槽的块的全局序号 + 1
+  uint64_t reads __attribute__((aligned(64)));  // 这个槽累计被读完的次数
+} __attribute__((aligned(64)));
+
+struct shm_transport {
+  struct nccl_broadcast_transport base;  // 必须是第一个成员
+  char name[NAME_MAX];
+  struct seg_header* hdr;
+  int32_t* pids;  // 每个 rank 的 pid，0 表示未打开或已关闭
+  struct seg_slot* slots;
+  uint8_t* data;
+  size_t size;
+  size_t chunk_bytes;
+  uint32_t nr_chunks;
+  uint64_t next;  // 下一块的全局序号
+};
+
+static void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  __asm__ __volatile__("yield");
+#endif
+}
+
+// 先忙等一小会儿，等不到再让出 CPU，rank 数多于 CPU 数时也能推进。每让出
+// 1024 次求一次 give_up，为真且 cond 仍不成立时不再等待，把 ret 置为 -1
+#define WAIT_UNTIL(cond, give_up, ret)                          \
+  do {                                                          \
+    for (unsigned int spins_ = 0; !(cond); ++spins_) {          \
+      if (spins_ < 256) {                                       \
+        cpu_relax();                                            \
+        continue;                                               \
+      }                                                         \
+      sched_yield();                                            \
+      if (spins_ % 1024 == 0 && (give_up) && !(cond)) {         \
+        (ret) = -1;                                             \
+        break;                                                  \
+      }                                                         \
+    }                                                           \
+  } while (0)
+
+static int process_gone(int32_t pid) {
+  return kill(pid, 0) < 0 && errno == ESRCH;
+}
+
+// 有打开后未关闭就退出的 rank，之后的广播都不可能完成
+static int peer_gone(const struct shm_transport* s) {
+  for (int r = 0; r < s->base.nranks; ++r) {
+    int32_t pid = __atomic_load_n(&s->pids[r], __ATOMIC_RELAXED);
+    if (pid && process_gone(pid)) return 1;
+  }
+  return 0;
+}
+
+static uint64_t monotonic_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000ULL + ts.tv_nsec / 1000000;
+}
+
+// 还没到的 rank 没有 pid 可查，只能靠期限
+static int join_expired(uint64_t deadline) {
+  return deadline && monotonic_ms() >= deadline;
+}
+
+static size_t pids_size(uint32_t nranks) {
+  return (nranks * sizeof(int32_t) + 63) & ~(size_t)63;
+}
+
+static size_t segment_size(uint32_t nranks, size_t chunk_bytes,
+                           uint32_t nr_chunks) {
+  return 64 + pids_size(nranks) +
+         nr_chunks * (sizeof(struct seg_slot) + chunk_bytes);
+}
+
+static int shm_broadcast(struct nccl_broadcast_transport* t, void* data,
+                         size_t bytes, int root) {
+  struct shm_transport* s = (struct shm_transport*)t;
+  uint64_t readers = (uint64_t)t->nranks - 1;
+  uint8_t* p = data;
+  int ret = 0;
+
+  if (readers == 0) return 0;
+  for (size_t off = 0; off < bytes; off += s->chunk_bytes, ++s->next) {
+    size_t len = bytes - off < s->chunk_bytes ? bytes - off : s->chunk_bytes;
+    uint64_t g = s->next;
+    struct seg_slot* slot = &s->slots[g % s->nr_chunks];
+    uint8_t* chunk = s->data + (g % s->nr_chunks) * s->chunk_bytes;
+
+    if (t->rank == root) {
+      // 这个槽之前装过 g / nr_chunks 块，每块都要被 readers 个 rank 读完
+      uint64_t uses = g / s->nr_chunks;
+      WAIT_UNTIL(__atomic_load_n(&slot->reads, __ATOMIC_ACQUIRE) >=
+                     uses * readers,
+                 peer_gone(s), ret);
+      if (ret < 0) return ret;
+      memcpy(chunk, p + off, len);
+      __atomic_store_n(&slot->ready, g + 1, __ATOMIC_RELEASE);
+    } else {
+      WAIT_UNTIL(__atomic_load_n(&slot->ready, __ATOMIC_ACQUIRE) == g + 1,
+                 peer_gone(s), ret);
+      if (ret < 0) return ret;
+      memcpy(p + off, chunk, len);
+      __atomic_add_fetch(&slot->reads, 1, __ATOMIC_RELEASE);
+    }
+  }
+  return 0;
+}
+
+static void shm_close(struct nccl_broadcast_transport* t) {
+  struct shm_transport* s = (struct shm_transport*)t;
+
+  // 最后一个关闭的 rank 删除名字；有 rank 没关闭就退出了，它永远不会
+  // 来关闭，由看到这一点的 rank 删除
+  __atomic_store_n(&s->pids[t->rank], 0, __ATOMIC_RELEASE);
+  if (__atomic_add_fetch(&s->hdr->left, 1, __ATOMIC_ACQ_REL) ==
+          s->hdr->nranks ||
+      peer_gone(s))
+    shm_unlink(s->name);
+  munmap(s->hdr, s->size);
+  free(s);
+}
+
+struct nccl_broadcast_transport* nccl_broadcast_shm_open(
+    const char* name, int rank, int nranks,
+    const struct nccl_broadcast_shm_config* config) {
+  struct nccl_broadcast_shm_config def = NCCL_BROADCAST_SHM_CONFIG_DEFAULT;
+  struct shm_transport* s;
+  struct seg_header* hdr;
+  struct stat st;
+  uint32_t empty = SEG_EMPTY;
+  size_t chunk_bytes, size;
+  uint64_t deadline;
+  int fd, ret = 0;
+
+  if (!config) config = &def;
+  if (nranks < 1 || rank < 0 || rank >= nranks || config->chunk_bytes == 0 ||
+      config->nr_chunks < 1 || strlen(name) >= NAME_MAX)
+    return NULL;
+  chunk_bytes = (config->chunk_bytes + 63) & ~(size_t)63;
+  size = segment_size(nranks, chunk_bytes, config->nr_chunks);
+  deadline = config->join_timeout_ms > 0
+                 ? monotonic_ms() + config->join_timeout_ms
+                 : 0;
+
+  // 每个 rank 都可能是第一个到的：都以 O_CREAT 打开，还是空的就扩展到
+  // 需要的大小；已有的段大小不同说明参数不一致，不能截断别人在用的段
+  fd = shm_open(name, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+  if (fd < 0) return NULL;
+  if (fstat(fd, &st) < 0 || (st.st_size && (size_t)st.st_size != size) ||
+      (!st.st_size && ftruncate(fd, size) < 0)) {
+    close(fd);
+    return NULL;
+  }
+  hdr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (hdr == MAP_FAILED) return NULL;
+
+  // 抢到初始化的 rank 写入参数，其余 rank 等它完成后核对
+  if (__atomic_compare_exchange_n(&hdr->state, &empty, SEG_INIT, 0,
+                                  __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+    hdr->nranks = nranks;
+    hdr->chunk_bytes = chunk_bytes;
+    hdr->nr_chunks = config->nr_chunks;
+    __atomic_store_n(&hdr->state, SEG_READY, __ATOMIC_RELEASE);
+  }
+  WAIT_UNTIL(__atomic_load_n(&hdr->state, __ATOMIC_ACQUIRE) == SEG_READY,
+             join_expired(deadline), ret);
+  if (ret < 0 || hdr->nranks != (uint32_t)nranks || hdr->chunk_bytes != chunk_bytes ||
+      hdr->nr_chunks != (uint32_t)config->nr_chunks) {
+    munmap(hdr, size);
+    return NULL;
+  }
+
+  s = calloc(1, sizeof(*s));
+  if (!s) {
+    munmap(hdr, size);
+    return NULL;
+  }
+  s->base.name = "shm";
+  s->base.rank = rank;
+  s->base.nranks = nranks;
+  s->base.broadcast = shm_broadcast;
+  s->base.close = shm_close;
+  strcpy(s->name, name);
+  s->hdr = hdr;
+  s->pids = (int32_t*)((uint8_t*)hdr + 64);
+  s->slots = (struct seg_slot*)((uint8_t*)s->pids + pids_size(nranks));
+  s->data = (uint8_t*)(s->slots + config->nr_chunks);
+  s->size = size;
+  s->chunk_bytes = chunk_bytes;
+  s->nr_chunks = config->nr_chunks;
+
+  // 所有 rank 都到齐后才能开始广播
+  __atomic_store_n(&s->pids[rank], (int32_t)getpid(), __ATOMIC_RELEASE);
+  __atomic_add_fetch(&hdr->joined, 1, __ATOMIC_ACQ_REL);
+  WAIT_UNTIL(__atomic_load_n(&hdr->joined, __ATOMIC_ACQUIRE) ==
+                 (uint32_t)nranks,
+             join_expired(deadline) || peer_gone(s), ret);
+  if (ret < 0) {
+    // 这个通信域已经不可能凑齐，删除名字，不让它留给之后的调用者
+    __atomic_store_n(&s->pids[rank], 0, __ATOMIC_RELEASE);
+    shm_unlink(name);
+    munmap(hdr, size);
+    free(s);
+    return NULL;
+  }
+  return &s->base;
+}
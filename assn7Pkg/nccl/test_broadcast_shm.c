@@ -0,0 +1,126 @@
+// nccl_broadcast over the shared-memory transport: four forked ranks run a
+// fixed sequence of broadcasts with rotating roots and sizes from empty to
+// several times the slot ring (not a multiple of the chunk size). Every rank
+// must end each call with exactly the root's data. A single-rank transport
+// broadcasts in place. A rank that exits without closing makes the root's
+// next broadcast fail instead of hang, and an open whose peers never arrive
+// gives up after the join timeout.
+//
+// build: cc -O2 -DNCCL_BROADCAST_NO_CUDA test_broadcast_shm.c nccl_broadcast_shm.c
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "nccl_broadcast.h"
+
+#define NRANKS 4
+#define CALLS 200
+
+static char name[64];
+
+// 第 call 次广播的元素个数与 root
+static size_t count_of(int call) {
+  static const size_t sizes[] = {0, 1, 1000, 3 * 8 * 1024 + 17, 64 * 1024};
+  return sizes[call % 5];
+}
+
+static float value(int call, size_t i) { return (float)(call * 131 + i % 977); }
+
+static int run_rank(int rank) {
+  struct nccl_broadcast_shm_config config = {4096, 8, 10000};
+  struct nccl_broadcast_transport* t =
+      nccl_broadcast_shm_open(name, rank, NRANKS, &config);
+  float* data = malloc(64 * 1024 * sizeof(float));
+
+  if (!t || !data || t->rank != rank || t->nranks != NRANKS) return 1;
+  for (int call = 0; call < CALLS; ++call) {
+    size_t count = count_of(call);
+    int root = call % NRANKS;
+    for (size_t i = 0; i < count; ++i)
+      data[i] = rank == root ? value(call, i) : -1.0f - rank;
+    if (nccl_broadcast(t, data, count, root) != 0) return 2;
+    for (size_t i = 0; i < count; ++i)
+      if (data[i] != value(call, i)) {
+        fprintf(stderr, "rank %d call %d: data[%zu] = %f\n", rank, call, i,
+                data[i]);
+        return 3;
+      }
+  }
+  nccl_broadcast_close(t);
+  free(data);
+  return 0;
+}
+
+// rank 1 打开后不关闭就退出，root 要等它读完才能重用槽位
+static int check_dead_peer(void) {
+  struct nccl_broadcast_shm_config config = {4096, 2, 10000};
+  static float data[64 * 1024];
+  struct nccl_broadcast_transport* t;
+  int status, ret = 0;
+  pid_t pid;
+
+  snprintf(name, sizeof(name), "/test_broadcast_shm.%d.dead", getpid());
+  pid = fork();
+  if (pid == 0) {
+    _exit(nccl_broadcast_shm_open(name, 1, 2, &config) ? 0 : 1);
+  }
+  t = nccl_broadcast_shm_open(name, 0, 2, &config);
+  waitpid(pid, &status, 0);
+  if (!t || !WIFEXITED(status) || WEXITSTATUS(status) != 0) return 1;
+  if (nccl_broadcast(t, data, 64 * 1024, 0) == 0) {
+    fprintf(stderr, "broadcast to a dead rank succeeded\n");
+    ret = 1;
+  }
+  nccl_broadcast_close(t);
+  return ret;
+}
+
+// 只有一个 rank 到达，打开在 join_timeout_ms 后失败
+static int check_join_timeout(void) {
+  struct nccl_broadcast_shm_config config = {4096, 2, 200};
+
+  snprintf(name, sizeof(name), "/test_broadcast_shm.%d.alone", getpid());
+  if (nccl_broadcast_shm_open(name, 0, 2, &config)) {
+    fprintf(stderr, "open without peers succeeded\n");
+    return 1;
+  }
+  return 0;
+}
+
+int main(void) {
+  pid_t pids[NRANKS];
+  int status, failed = 0;
+  float one[3] = {1, 2, 3};
+
+  snprintf(name, sizeof(name), "/test_broadcast_shm.%d", getpid());
+  for (int r = 0; r < NRANKS; ++r) {
+    pids[r] = fork();
+    if (pids[r] == 0) _exit(run_rank(r));
+  }
+  for (int r = 0; r < NRANKS; ++r) {
+    waitpid(pids[r], &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      fprintf(stderr, "rank %d failed: status %d\n", r, status);
+      failed = 1;
+    }
+  }
+  // 所有 rank 关闭后名字被删除
+  char path[128];
+  snprintf(path, sizeof(path), "/dev/shm%s", name);
+  if (access(path, F_OK) == 0) failed = 1;
+
+  snprintf(name, sizeof(name), "/test_broadcast_shm.%d.single", getpid());
+  struct nccl_broadcast_transport* t = nccl_broadcast_shm_open(name, 0, 1, NULL);
+  if (!t || nccl_broadcast(t, one, 3, 0) != 0 || one[2] != 3 ||
+      nccl_broadcast(t, one, 3, 1) == 0)
+    failed = 1;
+  nccl_broadcast_close(t);
+
+  if (check_dead_peer() || check_join_timeout()) failed = 1;
+  if (failed) return 1;
+  printf("broadcast_shm ok\n");
+  return 0;
+}
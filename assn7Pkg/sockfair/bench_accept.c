@@ -0,0 +1,243 @@
+// Loopback connection storm against SO_REUSEPORT workers. Worker i keeps each
+// connection open (i + 1) times longer than worker 0 and spends CPU on every
+// open connection before accepting the next one, so a worker that holds many
+// connections is slow to accept. With kernel hash dispatch the slow workers
+// pile up connections and their accept latency explodes; with the fairness
+// policy (reuseport_fair.h) new connections follow the load.
+//
+// usage: bench_accept hash|fair [workers] [clients] [connections] [hold_ms]
+//                     [priority...]
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "reuseport_fair.h"
+#include "sockfair.h"
+
+#define MAX_WORKERS 64
+#define SERVICE_NS_PER_CONN 2000  // 每轮为每个打开的连接花费的 CPU 时间
+
+struct conn {
+  int fd;
+  double expire;
+};
+
+struct worker {
+  int index;
+  int listen_fd;
+  int priority;
+  double hold_ns;
+  pthread_t thread;
+  pid_t tid;
+  double *lat;  // accept 延迟，ns
+  long nr_lat, cap_lat;
+  long max_open;
+};
+
+static struct worker workers[MAX_WORKERS];
+static int nr_workers = 4, nr_clients = 8;
+static long total_conns = 10000;
+static atomic_long accepted;
+static atomic_long next_conn;
+static atomic_int ready;
+static volatile int balancing = 1;
+static struct sockaddr_in addr;
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void spin_ns(double ns) {
+  double end = now_ns() + ns;
+  while (now_ns() < end) {
+  }
+}
+
+static int make_listener(void) {
+  int one = 1;
+  int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  if (fd < 0 || setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) ||
+      bind(fd, (struct sockaddr *)&addr, sizeof(addr)) || listen(fd, 4096)) {
+    perror("listener");
+    exit(1);
+  }
+  return fd;
+}
+
+static void *worker_main(void *arg) {
+  struct worker *w = arg;
+  struct conn *open_conns = NULL;
+  long nr_open = 0, cap_open = 0;
+
+  w->tid = gettid();
+  atomic_fetch_add(&ready, 1);
+
+  while (atomic_load(&accepted) < total_conns || nr_open) {
+    double now = now_ns();
+    for (long i = 0; i < nr_open;) {
+      if (open_conns[i].expire <= now) {
+        close(open_conns[i].fd);
+        open_conns[i] = open_conns[--nr_open];
+      } else {
+        ++i;
+      }
+    }
+    spin_ns((double)nr_open * SERVICE_NS_PER_CONN);
+
+    struct pollfd pfd = {.fd = w->listen_fd, .events = POLLIN};
+    if (poll(&pfd, 1, 1) <= 0) continue;
+    int fd = accept(w->listen_fd, NULL, NULL);
+    if (fd < 0) continue;
+    atomic_fetch_add(&accepted, 1);
+
+    // 客户端在 connect 前取的时间戳
+    double start;
+    if (read(fd, &start, sizeof(start)) == sizeof(start)) {
+      if (w->nr_lat == w->cap_lat) {
+        w->cap_lat = w->cap_lat ? w->cap_lat * 2 : 1024;
+        w->lat = realloc(w->lat, w->cap_lat * sizeof(*w->lat));
+      }
+      w->lat[w->nr_lat++] = now_ns() - start;
+    }
+    if (nr_open == cap_open) {
+      cap_open = cap_open ? cap_open * 2 : 64;
+      open_conns = realloc(open_conns, cap_open * sizeof(*open_conns));
+    }
+    open_conns[nr_open++] = (struct conn){fd, now_ns() + w->hold_ns};
+    if (nr_open > w->max_open) w->max_open = nr_open;
+  }
+  free(open_conns);
+  return NULL;
+}
+
+static void *client_main(void *arg) {
+  (void)arg;
+  while (atomic_fetch_add(&next_conn, 1) < total_conns) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    double start = now_ns();
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+      perror("connect");
+      exit(1);
+    }
+    if (write(fd, &start, sizeof(start)) != sizeof(start)) perror("write");
+    close(fd);
+  }
+  return NULL;
+}
+
+static void *balancer_main(void *arg) {
+  struct rp_fair *rp = arg;
+  while (balancing) {
+    rp_fair_rebalance(rp);
+    usleep(1000);
+  }
+  return NULL;
+}
+
+static int cmp_double(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return x < y ? -1 : x > y;
+}
+
+static double percentile(double *v, long n, double p) {
+  if (!n) return 0;
+  long i = (long)(p * (n - 1));
+  return v[i];
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2 || (strcmp(argv[1], "hash") && strcmp(argv[1], "fair"))) {
+    fprintf(stderr, "usage: %s hash|fair [workers] [clients] [connections] "
+                    "[hold_ms] [priority...]\n", argv[0]);
+    return 1;
+  }
+  int fair = strcmp(argv[1], "fair") == 0;
+  if (argc > 2) nr_workers = atoi(argv[2]);
+  if (argc > 3) nr_clients = atoi(argv[3]);
+  if (argc > 4) total_conns = atol(argv[4]);
+  double hold_ms = argc > 5 ? atof(argv[5]) : 5;
+  if (nr_workers < 1 || nr_workers > MAX_WORKERS) nr_workers = 4;
+
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  int probe = make_listener();
+  socklen_t len = sizeof(addr);
+  getsockname(probe, (struct sockaddr *)&addr, &len);  // 取系统分配的端口
+
+  struct rp_fair *rp = NULL;
+  if (fair && !(rp = rp_fair_create(nr_workers))) {
+    perror("rp_fair_create");
+    return 1;
+  }
+
+  for (int i = 0; i < nr_workers; ++i) {
+    struct worker *w = &workers[i];
+    w->index = i;
+    w->listen_fd = i ? make_listener() : probe;
+    w->priority = argc > 6 + i ? atoi(argv[6 + i]) : 1;
+    w->hold_ns = hold_ms * 1e6 * (i + 1);
+    pthread_create(&w->thread, NULL, worker_main, w);
+  }
+  while (atomic_load(&ready) < nr_workers) usleep(100);
+
+  pthread_t balancer;
+  if (fair) {
+    for (int i = 0; i < nr_workers; ++i) {
+      if (configure_socket_fairness(workers[i].tid, 0, workers[i].priority) ||
+          rp_fair_add(rp, workers[i].listen_fd, workers[i].tid) < 0) {
+        perror("fair setup");
+        return 1;
+      }
+    }
+    rp_fair_rebalance(rp);
+    pthread_create(&balancer, NULL, balancer_main, rp);
+  }
+
+  double start = now_ns();
+  pthread_t clients[nr_clients];
+  for (int i = 0; i < nr_clients; ++i)
+    pthread_create(&clients[i], NULL, client_main, NULL);
+  for (int i = 0; i < nr_clients; ++i) pthread_join(clients[i], NULL);
+  for (int i = 0; i < nr_workers; ++i) pthread_join(workers[i].thread, NULL);
+  double elapsed = now_ns() - start;
+  if (fair) {
+    balancing = 0;
+    pthread_join(balancer, NULL);
+  }
+
+  double *all = malloc(total_conns * sizeof(*all));
+  long nr_all = 0;
+  for (int i = 0; i < nr_workers; ++i) {
+    struct worker *w = &workers[i];
+    qsort(w->lat, w->nr_lat, sizeof(*w->lat), cmp_double);
+    printf("worker%d.connections %ld\n", i, w->nr_lat);
+    printf("worker%d.max_open %ld\n", i, w->max_open);
+    printf("worker%d.accept_p50_us %.1f\n", i,
+           percentile(w->lat, w->nr_lat, 0.5) / 1e3);
+    printf("worker%d.accept_p99_us %.1f\n", i,
+           percentile(w->lat, w->nr_lat, 0.99) / 1e3);
+    memcpy(all + nr_all, w->lat, w->nr_lat * sizeof(*all));
+    nr_all += w->nr_lat;
+    free(w->lat);
+  }
+  qsort(all, nr_all, sizeof(*all), cmp_double);
+  printf("%s.accept_p50_us %.1f\n", argv[1], percentile(all, nr_all, 0.5) / 1e3);
+  printf("%s.accept_p99_us %.1f\n", argv[1],
+         percentile(all, nr_all, 0.99) / 1e3);
+  printf("%s.connections_per_sec %.0f\n", argv[1], nr_all / (elapsed / 1e9));
+  free(all);
+  rp_fair_destroy(rp);
+  return 0;
+}
@@ -0,0 +1,181 @@
+// Socket accounting stress test: threads create sockets, other threads close
+// them. With per-thread limits configured, no thread may ever see -EMFILE as
+// long as it keeps fewer than its limit open.
+//
+// usage: bench_churn [threads] [cycles per thread] [limit]
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "sockfair.h"
+
+struct fd_item {
+  int fd;
+  atomic_int *owner_open;  // 创建者当前仍打开的 socket 数
+};
+
+// 容量足够放下所有线程同时未关闭的 socket，不会溢出
+static struct fd_item *queue;
+static size_t queue_size, queue_head, queue_tail;
+static pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queue_cond = PTHREAD_COND_INITIALIZER;
+static atomic_int producers_left;
+static atomic_long emfile_errors, other_errors, cycles_done;
+
+static struct sockaddr_in server_addr;
+static int num_cycles, sock_limit;
+
+static void queue_push(struct fd_item item) {
+  pthread_mutex_lock(&queue_lock);
+  queue[queue_tail++ % queue_size] = item;
+  pthread_cond_signal(&queue_cond);
+  pthread_mutex_unlock(&queue_lock);
+}
+
+static int queue_pop(struct fd_item *item) {
+  pthread_mutex_lock(&queue_lock);
+  while (queue_head == queue_tail && atomic_load(&producers_left) > 0)
+    pthread_cond_wait(&queue_cond, &queue_lock);
+  if (queue_head == queue_tail) {
+    pthread_mutex_unlock(&queue_lock);
+    return 0;
+  }
+  *item = queue[queue_head++ % queue_size];
+  pthread_mutex_unlock(&queue_lock);
+  return 1;
+}
+
+static void *acceptor(void *arg) {
+  int listen_fd = *(int *)arg;
+  for (;;) {
+    int fd = accept(listen_fd, NULL, NULL);
+    if (fd < 0) {
+      if (errno == EINVAL || errno == EBADF) break;  // listener closed
+      continue;
+    }
+    close(fd);
+  }
+  return NULL;
+}
+
+// 创建并连接 socket，交给其他线程关闭
+static void *producer(void *arg) {
+  atomic_int open_count = 0;
+  (void)arg;
+
+  if (configure_socket_fairness(gettid(), sock_limit, 0) != 0) {
+    perror("configure_socket_fairness");
+    exit(1);
+  }
+
+  for (int i = 0; i < num_cycles; ++i) {
+    // 自己最多保留 limit/2 个未关闭的 socket，正常情况下绝不会碰到上限
+    while (atomic_load(&open_count) >= sock_limit / 2) sched_yield();
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+      if (errno == EMFILE)
+        atomic_fetch_add(&emfile_errors, 1);
+      else
+        atomic_fetch_add(&other_errors, 1);
+      continue;
+    }
+    if (connect(fd, (struct sockaddr *)&server_addr, sizeof(server_addr)) <
+        0)
+      atomic_fetch_add(&other_errors, 1);
+
+    atomic_fetch_add(&open_count, 1);
+    queue_push((struct fd_item){fd, &open_count});
+  }
+
+  while (atomic_load(&open_count) > 0) sched_yield();
+  if (atomic_fetch_sub(&producers_left, 1) == 1) {
+    pthread_mutex_lock(&queue_lock);
+    pthread_cond_broadcast(&queue_cond);
+    pthread_mutex_unlock(&queue_lock);
+  }
+  return NULL;
+}
+
+static void *closer(void *arg) {
+  struct fd_item item;
+  (void)arg;
+  while (queue_pop(&item)) {
+    close(item.fd);
+    atomic_fetch_sub(item.owner_open, 1);
+    atomic_fetch_add(&cycles_done, 1);
+  }
+  return NULL;
+}
+
+int main(int argc, char **argv) {
+  int num_threads = argc > 1 ? atoi(argv[1]) : 16;
+  num_cycles = argc > 2 ? atoi(argv[2]) : 5000;
+  sock_limit = argc > 3 ? atoi(argv[3]) : 32;
+  // 每个线程最多保留 limit/2 个 socket，limit 小于 2 时一个也留不下
+  if (sock_limit < 2) {
+    fprintf(stderr, "limit must be at least 2\n");
+    return 1;
+  }
+  queue_size = (size_t)num_threads * (sock_limit / 2 + 1);
+  queue = calloc(queue_size, sizeof(*queue));
+
+  int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+  int one = 1;
+  setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  server_addr.sin_family = AF_INET;
+  server_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  server_addr.sin_port = 0;
+  socklen_t len = sizeof(server_addr);
+  if (bind(listen_fd, (struct sockaddr *)&server_addr, len) < 0 ||
+      listen(listen_fd, 4096) < 0 ||
+      getsockname(listen_fd, (struct sockaddr *)&server_addr, &len) < 0) {
+    perror("listen");
+    return 1;
+  }
+
+  pthread_t accept_thread;
+  pthread_create(&accept_thread, NULL, acceptor, &listen_fd);
+
+  pthread_t *producers = calloc(num_threads, sizeof(pthread_t));
+  pthread_t *closers = calloc(num_threads, sizeof(pthread_t));
+  struct timespec start, end;
+  atomic_store(&producers_left, num_threads);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (int i = 0; i < num_threads; ++i) {
+    pthread_create(&producers[i], NULL, producer, NULL);
+    pthread_create(&closers[i], NULL, closer, NULL);
+  }
+  for (int i = 0; i < num_threads; ++i) {
+    pthread_join(producers[i], NULL);
+    pthread_join(closers[i], NULL);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  shutdown(listen_fd, SHUT_RDWR);
+  close(listen_fd);
+  pthread_join(accept_thread, NULL);
+
+  double secs =
+      (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+  printf("threads %d\n", num_threads);
+  printf("cycles %ld\n", atomic_load(&cycles_done));
+  printf("cycles_per_sec %.0f\n", atomic_load(&cycles_done) / secs);
+  printf("spurious_emfile %ld\n", atomic_load(&emfile_errors));
+  printf("other_errors %ld\n", atomic_load(&other_errors));
+
+  free(producers);
+  free(closers);
+  free(queue);
+  return atomic_load(&emfile_errors) ? 1 : 0;
+}
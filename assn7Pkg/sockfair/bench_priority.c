@@ -0,0 +1,122 @@
+// Priority-weighted transmit bandwidth on loopback.
+// Each sender thread configures its socket priority (= weight), then all
+// senders push data to one receiver over a shared device. Run tc_setup.sh
+// first; without the qdisc every sender should get an equal share.
+//
+// usage: bench_priority [seconds] [weight ...]
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "sockfair.h"
+
+#define MAX_SENDERS 16
+#define CHUNK (64 * 1024)
+
+struct sender {
+  pthread_t thread;
+  int weight;
+  atomic_long bytes;
+};
+
+static struct sender senders[MAX_SENDERS];
+static struct sockaddr_in server_addr;
+static atomic_int running = 1;
+
+static void *sender_main(void *arg) {
+  struct sender *s = arg;
+  static char buf[CHUNK];
+
+  // 先设置权重再建 socket，sk_priority 在创建时确定
+  if (configure_socket_fairness(gettid(), 0, s->weight) != 0) {
+    perror("configure_socket_fairness");
+    exit(1);
+  }
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (connect(fd, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
+    perror("connect");
+    exit(1);
+  }
+  while (atomic_load(&running)) {
+    ssize_t n = send(fd, buf, sizeof(buf), 0);
+    if (n <= 0) break;
+    atomic_fetch_add(&s->bytes, n);
+  }
+  close(fd);
+  return NULL;
+}
+
+static void *receiver_main(void *arg) {
+  int fd = (int)(long)arg;
+  static __thread char buf[CHUNK];
+  while (recv(fd, buf, sizeof(buf), 0) > 0) {
+  }
+  close(fd);
+  return NULL;
+}
+
+int main(int argc, char **argv) {
+  int seconds = argc > 1 ? atoi(argv[1]) : 10;
+  int num_senders = 0;
+  long total_weight = 0;
+
+  for (int i = 2; i < argc && num_senders < MAX_SENDERS; ++i)
+    senders[num_senders++].weight = atoi(argv[i]);
+  if (num_senders == 0) {
+    int defaults[] = {1, 2, 4};
+    for (; num_senders < 3; ++num_senders)
+      senders[num_senders].weight = defaults[num_senders];
+  }
+
+  int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+  server_addr.sin_family = AF_INET;
+  server_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t len = sizeof(server_addr);
+  if (bind(listen_fd, (struct sockaddr *)&server_addr, len) < 0 ||
+      listen(listen_fd, MAX_SENDERS) < 0 ||
+      getsockname(listen_fd, (struct sockaddr *)&server_addr, &len) < 0) {
+    perror("listen");
+    return 1;
+  }
+
+  for (int i = 0; i < num_senders; ++i) {
+    pthread_t receiver;
+    pthread_create(&senders[i].thread, NULL, sender_main, &senders[i]);
+    int fd = accept(listen_fd, NULL, NULL);
+    pthread_create(&receiver, NULL, receiver_main, (void *)(long)fd);
+    pthread_detach(receiver);
+    total_weight += senders[i].weight;
+  }
+
+  // 先预热一秒，再统计区间内的字节数
+  sleep(1);
+  long start_bytes[MAX_SENDERS];
+  for (int i = 0; i < num_senders; ++i)
+    start_bytes[i] = atomic_load(&senders[i].bytes);
+  sleep(seconds);
+  long total = 0, delta[MAX_SENDERS];
+  for (int i = 0; i < num_senders; ++i) {
+    delta[i] = atomic_load(&senders[i].bytes) - start_bytes[i];
+    total += delta[i];
+  }
+  atomic_store(&running, 0);
+
+  printf("%-8s %-8s %-12s %-10s %-10s\n", "sender", "weight", "MB/s",
+         "share", "expected");
+  for (int i = 0; i < num_senders; ++i)
+    printf("%-8d %-8d %-12.1f %-10.3f %-10.3f\n", i, senders[i].weight,
+           delta[i] / 1e6 / seconds, (double)delta[i] / total,
+           (double)senders[i].weight / total_weight);
+  printf("total_MBps %.1f\n", total / 1e6 / seconds);
+
+  for (int i = 0; i < num_senders; ++i) pthread_join(senders[i].thread, NULL);
+  close(listen_fd);
+  return 0;
+}
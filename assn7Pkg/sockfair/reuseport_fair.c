@@ -0,0 +1,224 @@
+#define _GNU_SOURCE
+#include "reuseport_fair.h"
+
+#include <errno.h>
+#include <linux/bpf.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "sockfair.h"
+
+#ifndef SO_ATTACH_REUSEPORT_EBPF
+#define SO_ATTACH_REUSEPORT_EBPF 52
+#endif
+
+#define RP_FAIR_NONE UINT32_MAX  // 无效下标，程序不做选择
+
+// ARRAY map 的每个元素按 8 字节对齐存放，mmap 出来的布局与此相同
+struct rp_slot {
+  uint32_t idx;
+  uint32_t pad;
+};
+
+struct rp_worker {
+  pid_t tid;
+};
+
+struct rp_fair {
+  int sock_map;   // REUSEPORT_SOCKARRAY：下标 -> 监听 socket
+  int slot_map;   // ARRAY：RP_FAIR_SLOTS 项分发表
+  int prog;
+  struct rp_slot *slots;  // slot_map 的 mmap 映射
+  int max_workers;
+  int nr_workers;
+  struct rp_worker *workers;
+  pthread_mutex_t lock;
+};
+
+// 手写 eBPF 指令，避免依赖 libbpf 与 clang
+#define INSN(c, d, s, o, i) \
+  ((struct bpf_insn){.code = (c), .dst_reg = (d), .src_reg = (s), \
+                     .off = (o), .imm = (i)})
+#define MOV64_REG(d, s) INSN(BPF_ALU64 | BPF_MOV | BPF_X, d, s, 0, 0)
+#define MOV64_IMM(d, i) INSN(BPF_ALU64 | BPF_MOV | BPF_K, d, 0, 0, i)
+#define ALU64_IMM(op, d, i) INSN(BPF_ALU64 | (op) | BPF_K, d, 0, 0, i)
+#define LDX_W(d, s, o) INSN(BPF_LDX | BPF_MEM | BPF_W, d, s, o, 0)
+#define STX_W(d, s, o) INSN(BPF_STX | BPF_MEM | BPF_W, d, s, o, 0)
+#define LD_MAP_FD(d, fd)                                         \
+  INSN(BPF_LD | BPF_DW | BPF_IMM, d, BPF_PSEUDO_MAP_FD, 0, fd), \
+      INSN(0, 0, 0, 0, 0)
+#define JEQ_IMM(d, i, o) INSN(BPF_JMP | BPF_JEQ | BPF_K, d, 0, o, i)
+#define CALL(f) INSN(BPF_JMP | BPF_CALL, 0, 0, 0, f)
+#define EXIT() INSN(BPF_JMP | BPF_EXIT, 0, 0, 0, 0)
+
+static long bpf(int cmd, union bpf_attr *attr) {
+  return syscall(SYS_bpf, cmd, attr, sizeof(*attr));
+}
+
+static int map_create(enum bpf_map_type type, uint32_t value_size,
+                      uint32_t max_entries, uint32_t flags) {
+  union bpf_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.map_type = type;
+  attr.key_size = sizeof(uint32_t);
+  attr.value_size = value_size;
+  attr.max_entries = max_entries;
+  attr.map_flags = flags;
+  return bpf(BPF_MAP_CREATE, &attr);
+}
+
+// slot = ctx->hash & (RP_FAIR_SLOTS - 1)
+// idx = slot_map[slot]
+// bpf_sk_select_reuseport(ctx, sock_map, &idx, 0)
+// 查表或选择失败时不做选择，内核按哈希分发
+static int prog_load(int slot_map, int sock_map) {
+  struct bpf_insn insns[] = {
+      MOV64_REG(BPF_REG_6, BPF_REG_1),
+      LDX_W(BPF_REG_2, BPF_REG_6, offsetof(struct sk_reuseport_md, hash)),
+      ALU64_IMM(BPF_AND, BPF_REG_2, RP_FAIR_SLOTS - 1),
+      STX_W(BPF_REG_10, BPF_REG_2, -4),
+      LD_MAP_FD(BPF_REG_1, slot_map),
+      MOV64_REG(BPF_REG_2, BPF_REG_10),
+      ALU64_IMM(BPF_ADD, BPF_REG_2, -4),
+      CALL(BPF_FUNC_map_lookup_elem),
+      JEQ_IMM(BPF_REG_0, 0, 9),
+      LDX_W(BPF_REG_1, BPF_REG_0, 0),
+      STX_W(BPF_REG_10, BPF_REG_1, -8),
+      MOV64_REG(BPF_REG_1, BPF_REG_6),
+      LD_MAP_FD(BPF_REG_2, sock_map),
+      MOV64_REG(BPF_REG_3, BPF_REG_10),
+      ALU64_IMM(BPF_ADD, BPF_REG_3, -8),
+      MOV64_IMM(BPF_REG_4, 0),
+      CALL(BPF_FUNC_sk_select_reuseport),
+      MOV64_IMM(BPF_REG_0, SK_PASS),
+      EXIT(),
+  };
+  union bpf_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.prog_type = BPF_PROG_TYPE_SK_REUSEPORT;
+  attr.expected_attach_type = BPF_SK_REUSEPORT_SELECT;
+  attr.insns = (uintptr_t)insns;
+  attr.insn_cnt = sizeof(insns) / sizeof(insns[0]);
+  attr.license = (uintptr_t) "GPL";
+  return bpf(BPF_PROG_LOAD, &attr);
+}
+
+struct rp_fair *rp_fair_create(int max_workers) {
+  struct rp_fair *rp = calloc(1, sizeof(*rp));
+  if (!rp) return NULL;
+  rp->sock_map = rp->slot_map = rp->prog = -1;
+  rp->slots = MAP_FAILED;
+  pthread_mutex_init(&rp->lock, NULL);
+  rp->max_workers = max_workers;
+  rp->workers = calloc(max_workers, sizeof(*rp->workers));
+  if (!rp->workers) goto fail;
+
+  rp->sock_map = map_create(BPF_MAP_TYPE_REUSEPORT_SOCKARRAY, sizeof(uint64_t),
+                            max_workers, 0);
+  if (rp->sock_map < 0) goto fail;
+  rp->slot_map = map_create(BPF_MAP_TYPE_ARRAY, sizeof(uint32_t),
+                            RP_FAIR_SLOTS, BPF_F_MMAPABLE);
+  if (rp->slot_map < 0) goto fail;
+  rp->slots = mmap(NULL, RP_FAIR_SLOTS * sizeof(struct rp_slot),
+                   PROT_READ | PROT_WRITE, MAP_SHARED, rp->slot_map, 0);
+  if (rp->slots == MAP_FAILED) goto fail;
+  for (int i = 0; i < RP_FAIR_SLOTS; ++i) rp->slots[i].idx = RP_FAIR_NONE;
+
+  rp->prog = prog_load(rp->slot_map, rp->sock_map);
+  if (rp->prog < 0) goto fail;
+  return rp;
+
+fail:
+  rp_fair_destroy(rp);
+  return NULL;
+}
+
+int rp_fair_add(struct rp_fair *rp, int listen_fd, pid_t tid) {
+  pthread_mutex_lock(&rp->lock);
+  int idx = rp->nr_workers;
+  if (idx == rp->max_workers) {
+    pthread_mutex_unlock(&rp->lock);
+    errno = ENOSPC;
+    return -1;
+  }
+
+  // 程序挂在整个 reuseport 组上，挂到任意一个成员即可
+  if (idx == 0 && setsockopt(listen_fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_EBPF,
+                             &rp->prog, sizeof(rp->prog)) != 0)
+    goto fail;
+
+  uint32_t key = idx;
+  uint64_t value = listen_fd;
+  union bpf_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.map_fd = rp->sock_map;
+  attr.key = (uintptr_t)&key;
+  attr.value = (uintptr_t)&value;
+  attr.flags = BPF_ANY;
+  if (bpf(BPF_MAP_UPDATE_ELEM, &attr) != 0) goto fail;
+
+  rp->workers[idx].tid = tid;
+  rp->nr_workers++;
+  pthread_mutex_unlock(&rp->lock);
+  return idx;
+
+fail:
+  pthread_mutex_unlock(&rp->lock);
+  return -1;
+}
+
+int rp_fair_rebalance(struct rp_fair *rp) {
+  double share[rp->max_workers];
+  double total = 0;
+
+  pthread_mutex_lock(&rp->lock);
+  int n = rp->nr_workers;
+  for (int i = 0; i < n; ++i) {
+    struct sock_fair_info info;
+    if (get_socket_fairness(rp->workers[i].tid, &info) < 0) {
+      share[i] = 0;  // 线程已退出
+      continue;
+    }
+    if (info.limit > 0 && info.count >= info.limit) {
+      share[i] = 0;  // 已满，不再分配
+      continue;
+    }
+    int weight = info.priority > 0 ? info.priority : 1;
+    share[i] = (double)weight / (info.count + info.accepted + 1);
+    total += share[i];
+  }
+
+  // 按份额把分发表切成连续的段；连接哈希是均匀的，段长即分到的比例
+  int w = 0;
+  double acc = n ? share[0] : 0;
+  for (int s = 0; s < RP_FAIR_SLOTS; ++s) {
+    if (total == 0) {
+      __atomic_store_n(&rp->slots[s].idx, RP_FAIR_NONE, __ATOMIC_RELAXED);
+      continue;
+    }
+    double pos = (s + 0.5) * total / RP_FAIR_SLOTS;
+    while (w < n - 1 && pos >= acc) acc += share[++w];
+    __atomic_store_n(&rp->slots[s].idx, (uint32_t)w, __ATOMIC_RELAXED);
+  }
+  pthread_mutex_unlock(&rp->lock);
+  return 0;
+}
+
+void rp_fair_destroy(struct rp_fair *rp) {
+  if (!rp) return;
+  if (rp->slots != MAP_FAILED)
+    munmap(rp->slots, RP_FAIR_SLOTS * sizeof(struct rp_slot));
+  if (rp->prog >= 0) close(rp->prog);
+  if (rp->slot_map >= 0) close(rp->slot_map);
+  if (rp->sock_map >= 0) close(rp->sock_map);
+  pthread_mutex_destroy(&rp->lock);
+  free(rp->workers);
+  free(rp);
+}
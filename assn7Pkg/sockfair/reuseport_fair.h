@@ -0,0 +1,43 @@
+#ifndef REUSEPORT_FAIR_H
+#define REUSEPORT_FAIR_H
+#include <sys/types.h>
+
+// SO_REUSEPORT 监听组的按负载分发
+//
+// 每个工作线程持有一个绑定在同一端口上的监听 socket。内核默认按四元组哈希
+// 选择监听 socket，不知道各线程的负载。这里给监听组挂一段 SK_REUSEPORT
+// eBPF 程序：它用连接的哈希值查一张 RP_FAIR_SLOTS 项的分发表，表项是监听
+// socket 在 REUSEPORT_SOCKARRAY 里的下标。rp_fair_rebalance() 通过
+// get_socket_fairness 读取每个线程当前持有的连接数与优先级，按
+// priority / (count + accepted + 1) 的比例重新划分分发表，负载越轻、权重越高
+// 的线程分到的新连接越多；自己创建的 socket 已达到上限的线程不再分配。分发表可以 mmap，更新
+// 不需要系统调用。表项无效时程序不做选择，内核退回到哈希分发。
+
+#define RP_FAIR_SLOTS 256
+
+struct rp_fair;
+
+/**
+ * @brief 创建分发表与 eBPF 程序
+ * @param max_workers 最多的工作线程（监听 socket）数
+ * @return 成功返回句柄，失败返回 NULL 并设置 errno
+ */
+struct rp_fair *rp_fair_create(int max_workers);
+
+/**
+ * @brief 加入一个已经 listen 的 SO_REUSEPORT 监听 socket
+ * @param listen_fd 监听 socket
+ * @param tid 负责 accept 该 socket 的线程
+ * @return 成功返回该 socket 在组内的下标，失败返回 -1 并设置 errno
+ */
+int rp_fair_add(struct rp_fair *rp, int listen_fd, pid_t tid);
+
+/**
+ * @brief 按各线程当前负载重新划分分发表，可在任意线程周期性调用
+ * @return 成功返回 0，失败返回 -1 并设置 errno
+ */
+int rp_fair_rebalance(struct rp_fair *rp);
+
+void rp_fair_destroy(struct rp_fair *rp);
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef SOCKFAIR_H
+#define SOCKFAIR_H
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#define SYS_configure_socket_fairness 453
+#define SYS_configure_socket_group 456
+#define SYS_configure_socket_rate 457
+#define SYS_get_socket_fairness 458
+
+#define SOCK_FAIR_GROUP_NEW 1
+#define SOCK_FAIR_RATE_GROUP 1
+
+struct sock_fair_info {
+  int limit;
+  int count;     // 自己创建、仍打开的 socket 数，受 limit 约束
+  int priority;
+  int group_limit;
+  long long group_count;
+  long long rejected_limit;  // 超过上限（-EMFILE）的次数
+  long long rejected_rate;   // 超过速率（-EAGAIN）的次数
+  long long group_rejected;
+  int accepted;  // accept 得到、仍打开的连接数，不受 limit 约束
+  int reserved;
+};
+
+/**
+ * @brief 设置线程的 socket 上限与优先级
+ *
+ * 没有 CAP_SYS_RESOURCE 时只能修改自己能 ptrace 的线程，上限只能收紧、
+ * 优先级只能调低，否则返回 EPERM。
+ *
+ * @param tid 目标线程 tid
+ * @param max_sock 同时打开的 socket 上限，0 表示不限
+ * @param priority 发送优先级
+ * @return 成功返回 0，失败返回 -1 并设置 errno
+ */
+static inline int configure_socket_fairness(pid_t tid, int max_sock,
+                                            int priority) {
+  return syscall(SYS_configure_socket_fairness, tid, max_sock, priority);
+}
+
+/**
+ * @brief 新建 socket 分组并让调用线程加入，之后创建的线程与子进程都继承它
+ *
+ * 调用线程自己的上限、速率和仍打开的 socket 都保留，这些 socket 同时计入
+ * 新分组。
+ *
+ * @param max_sock 整个分组（含子分组）同时打开的 socket 上限，0 表示不限
+ * @return 成功返回 0，失败返回 -1 并设置 errno
+ */
+static inline int socket_group_enter(int max_sock) {
+  return syscall(SYS_configure_socket_group, 0, max_sock,
+                 SOCK_FAIR_GROUP_NEW);
+}
+
+/**
+ * @brief 修改线程 tid 所在分组的 socket 上限
+ *
+ * 没有 CAP_SYS_RESOURCE 时只能修改自己能 ptrace 的线程所在的分组，且只能
+ * 收紧：上限会先被压到上一级分组的上限，比原上限宽松（含改为 0）时返回
+ * EPERM。
+ */
+static inline int socket_group_set_limit(pid_t tid, int max_sock) {
+  return syscall(SYS_configure_socket_group, tid, max_sock, 0);
+}
+
+/**
+ * @brief 限制线程（或其所在分组）创建 socket 的速率，超出时 socket() 返回
+ *        EAGAIN
+ * @param tid 目标线程 tid
+ * @param rate 每秒允许创建的 socket 数，0 表示不限速
+ * @param burst 允许的突发个数
+ * @param flags SOCK_FAIR_RATE_GROUP 表示作用于 tid 所在的分组
+ *
+ * 权限规则同 configure_socket_fairness：无特权时速率只能调低、突发只能
+ * 调小。
+ */
+static inline int configure_socket_rate(pid_t tid, unsigned int rate,
+                                        unsigned int burst,
+                                        unsigned int flags) {
+  return syscall(SYS_configure_socket_rate, tid, rate, burst, flags);
+}
+
+/**
+ * @brief 读取线程的 socket 上限、优先级与当前持有的 socket 数
+ *
+ * 只能读取调用者能以 PTRACE_MODE_READ 访问的线程，否则失败并设置
+ * errno 为 EPERM。
+ *
+ * @param tid 目标线程 tid
+ * @param info 输出
+ * @return 成功返回填充的字节数，失败返回 -1 并设置 errno
+ */
+static inline int get_socket_fairness(pid_t tid, struct sock_fair_info *info) {
+  return syscall(SYS_get_socket_fairness, tid, info, sizeof(*info));
+}
+
+#endif
@@ -0,0 +1,25 @@
+#!/bin/bash
+# 在 lo 上挂一个 handle 10: 的 drr，类 10:<p> 的 quantum 与 p 成正比，
+# configure_socket_fairness 设置的 priority 即发送权重。
+# lo 本身不会排队，所以外面套一层 tbf 限速，让 drr 有积压可以调度。
+# usage: sudo ./tc_setup.sh [max_priority] [rate]   sudo ./tc_setup.sh clean
+DEV=lo
+QUANTUM=65536 # lo 的 MTU
+
+if [ "$1" == "clean" ]; then
+  tc qdisc del dev $DEV root 2>/dev/null
+  exit 0
+fi
+
+MAX_PRIO=${1:-8}
+RATE=${2:-1gbit}
+tc qdisc del dev $DEV root 2>/dev/null
+tc qdisc add dev $DEV root handle 1: tbf rate $RATE burst 1mb latency 50ms
+tc qdisc add dev $DEV parent 1:1 handle 10: drr
+for p in $(seq 1 $MAX_PRIO); do
+  tc class add dev $DEV parent 10: classid 10:$(printf '%x' $p) drr \
+    quantum $((p * QUANTUM))
+done
+# 未配置权重的流量（ACK、其他进程）走默认类，避免被 drr 丢弃
+tc class add dev $DEV parent 10: classid 10:ffff drr quantum $QUANTUM
+tc filter add dev $DEV parent 10: prio 1 matchall classid 10:ffff
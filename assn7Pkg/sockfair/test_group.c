@@ -0,0 +1,139 @@
+// Socket group test: a group limit covers every thread and child process
+// created after joining, including threads that were never configured. A
+// thread that joins keeps its own limit and the sockets it already has open,
+// which also count against the new group.
+//
+// usage: test_group [limit] [children] [threads per child]
+#define _GNU_SOURCE
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "sockfair.h"
+
+#define MAX_SOCKS 4096
+
+struct shared {
+  int opened;  // 整个分组成功打开的 socket 总数
+  int rejected;
+  pthread_barrier_t hold;
+};
+
+static struct shared *shared;
+static int threads_per_child;
+
+// 尽可能多地打开 socket，并保持打开直到所有人都试过
+static void *opener(void *arg) {
+  int fds[MAX_SOCKS], n = 0;
+  (void)arg;
+  while (n < MAX_SOCKS) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+      if (errno == EMFILE)
+        __atomic_fetch_add(&shared->rejected, 1, __ATOMIC_RELAXED);
+      break;
+    }
+    fds[n++] = fd;
+  }
+  __atomic_fetch_add(&shared->opened, n, __ATOMIC_RELAXED);
+  pthread_barrier_wait(&shared->hold);
+  for (int i = 0; i < n; ++i) close(fds[i]);
+  return NULL;
+}
+
+static void child_main(void) {
+  pthread_t threads[64];
+  for (int i = 0; i < threads_per_child; ++i)
+    pthread_create(&threads[i], NULL, opener, NULL);
+  for (int i = 0; i < threads_per_child; ++i) pthread_join(threads[i], NULL);
+  exit(0);
+}
+
+// 带着线程配额和 THREAD_OPEN 个已打开的 socket 进组，进组后配额不能重新开始
+#define THREAD_OPEN 3
+
+static int enter_with_thread_quota(int limit) {
+  struct sock_fair_info info;
+  int fds[THREAD_OPEN], fd, ret = -1;
+
+  if (configure_socket_fairness(gettid(), THREAD_OPEN, 0) != 0) {
+    perror("configure_socket_fairness");
+    return -1;
+  }
+  for (int i = 0; i < THREAD_OPEN; ++i) fds[i] = socket(AF_INET, SOCK_DGRAM, 0);
+  if (socket_group_enter(limit) != 0) {
+    perror("socket_group_enter");
+    goto out;
+  }
+  fd = socket(AF_INET, SOCK_DGRAM, 0);
+  if (fd >= 0 || errno != EMFILE) {
+    fprintf(stderr, "thread quota restarted after joining the group\n");
+    if (fd >= 0) close(fd);
+    goto out;
+  }
+  if (get_socket_fairness(gettid(), &info) < 0 || info.limit != THREAD_OPEN ||
+      info.count != THREAD_OPEN || info.group_count != THREAD_OPEN) {
+    fprintf(stderr, "after joining: limit %d count %d group_count %lld\n",
+            info.limit, info.count, info.group_count);
+    goto out;
+  }
+  ret = 0;
+out:
+  for (int i = 0; i < THREAD_OPEN; ++i) close(fds[i]);
+  // 关闭沿新的层级退回，分组里不应留下计数
+  if (!ret && (get_socket_fairness(gettid(), &info) < 0 ||
+               info.group_count != 0)) {
+    fprintf(stderr, "group_count %lld after closing\n", info.group_count);
+    ret = -1;
+  }
+  // 清掉线程配额（需要 CAP_SYS_RESOURCE），子进程本来也不继承它
+  if (configure_socket_fairness(gettid(), 0, 0) != 0) ret = -1;
+  return ret;
+}
+
+int main(int argc, char **argv) {
+  int limit = argc > 1 ? atoi(argv[1]) : 100;
+  int children = argc > 2 ? atoi(argv[2]) : 4;
+  threads_per_child = argc > 3 ? atoi(argv[3]) : 4;
+  if (threads_per_child > 64) threads_per_child = 64;
+
+  shared = mmap(NULL, sizeof(*shared), PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  pthread_barrierattr_t attr;
+  pthread_barrierattr_init(&attr);
+  pthread_barrierattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+  pthread_barrier_init(&shared->hold, &attr, children * threads_per_child);
+
+  if (enter_with_thread_quota(limit) != 0) return 1;
+
+  for (int i = 0; i < children; ++i)
+    if (fork() == 0) child_main();
+  while (wait(NULL) > 0) {
+  }
+
+  printf("limit %d\n", limit);
+  printf("opened %d\n", shared->opened);
+  printf("rejected %d\n", shared->rejected);
+  // 两个线程同时卡在上限时可能都回退，所以允许略少于 limit，但绝不能超过
+  if (shared->opened > limit ||
+      shared->opened < limit - children * threads_per_child) {
+    fprintf(stderr, "group opened %d sockets, limit %d\n", shared->opened,
+            limit);
+    return 1;
+  }
+  // 每次 -EMFILE 都应记入分组的拒绝总数
+  struct sock_fair_info info;
+  if (get_socket_fairness(gettid(), &info) < 0 ||
+      info.group_rejected != shared->rejected) {
+    fprintf(stderr, "group_rejected %lld, observed %d\n", info.group_rejected,
+            shared->rejected);
+    return 1;
+  }
+  printf("Group limit enforced across %d processes\n", children);
+  return 0;
+}
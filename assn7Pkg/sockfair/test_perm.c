@@ -0,0 +1,89 @@
+// Permission test: an unprivileged caller may not read or change the socket
+// limits of another user's thread, and may only tighten its own. Run as root; the test
+// forks a root victim and an attacker that drops to nobody.
+//
+// build: cc -O2 test_perm.c
+// usage: test_perm
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "sockfair.h"
+
+#define NOBODY 65534
+
+static int failures;
+
+// 期望调用以 errno == err 失败；err 为 0 表示期望成功
+static void expect(const char *what, int ret, int err) {
+  if ((err == 0 && ret == 0) || (err && ret < 0 && errno == err)) return;
+  fprintf(stderr, "%s: ret %d errno %d, want %s\n", what, ret,
+          ret < 0 ? errno : 0, err ? "failure" : "success");
+  ++failures;
+}
+
+static int attack(pid_t victim) {
+  struct sock_fair_info info;
+
+  if (setgid(NOBODY) < 0 || setuid(NOBODY) < 0) {
+    perror("setuid");
+    return 1;
+  }
+  pid_t self = gettid();
+
+  // 别的用户的线程：一律拒绝，读取也不行
+  expect("read victim", get_socket_fairness(victim, &info) < 0 ? -1 : 0,
+         EPERM);
+  expect("limit on victim", configure_socket_fairness(victim, 1, 0), EPERM);
+  expect("rate on victim", configure_socket_rate(victim, 1, 1, 0), EPERM);
+  expect("group rate on victim",
+         configure_socket_rate(victim, 1, 1, SOCK_FAIR_RATE_GROUP), EPERM);
+
+  // 自己：可以读取，只能收紧
+  expect("read self", get_socket_fairness(self, &info) < 0 ? -1 : 0, 0);
+  expect("set own limit", configure_socket_fairness(self, 64, 0), 0);
+  expect("tighten own limit", configure_socket_fairness(self, 32, 0), 0);
+  expect("raise own limit", configure_socket_fairness(self, 128, 0), EPERM);
+  expect("clear own limit", configure_socket_fairness(self, 0, 0), EPERM);
+  expect("raise own priority", configure_socket_fairness(self, 32, 5), EPERM);
+  expect("set own rate", configure_socket_rate(self, 100, 10, 0), 0);
+  expect("tighten own rate", configure_socket_rate(self, 50, 10, 0), 0);
+  expect("raise own rate", configure_socket_rate(self, 1000, 10, 0), EPERM);
+  expect("raise own burst", configure_socket_rate(self, 50, 100, 0), EPERM);
+  expect("clear own rate", configure_socket_rate(self, 0, 0, 0), EPERM);
+  return failures != 0;
+}
+
+int main(void) {
+  int hold[2], status;
+
+  if (getuid() != 0) {
+    printf("test_perm: skipped, needs root\n");
+    return 0;
+  }
+  if (pipe(hold) < 0) return 1;
+  pid_t victim = fork();
+  if (victim == 0) {
+    char c;
+    close(hold[1]);
+    (void)!read(hold[0], &c, 1);  // 一直等到父进程关闭写端
+    _exit(0);
+  }
+  close(hold[0]);
+
+  pid_t attacker = fork();
+  if (attacker == 0) _exit(attack(victim));
+  waitpid(attacker, &status, 0);
+  close(hold[1]);
+  waitpid(victim, NULL, 0);
+
+  if (!WIFEXITED(status) || WEXITSTATUS(status)) {
+    fprintf(stderr, "permission checks failed\n");
+    return 1;
+  }
+  printf("Unprivileged callers cannot loosen or touch other users' limits\n");
+  return 0;
+}
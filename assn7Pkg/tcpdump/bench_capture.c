@@ -0,0 +1,421 @@
+// Capture backend benchmark, in two setups.
+//
+// Loopback replay (default): a generator thread blasts fixed-size UDP packets
+// at 127.0.0.1 while one capture engine runs with a "udp dst port" filter.
+// Every engine stops after one idle second, like custom_tcpdump_capture.
+// Modes that fill the buffer also report buffer bytes per captured packet;
+// the pcapng modes and view report kernel drops.
+//
+// Live interface (-i): while external traffic arrives on iface (udpgen, see
+// bench_veth.sh), run each engine for a fixed time with one filter, copying
+// into a rotating arena instead of a pcapng buffer, and report
+//
+//   offered_pps            packets received by the interface (sysfs rx_packets)
+//   captured_pps           packets handed to user space by the engine
+//   drop_rate              kernel drops / (captured + kernel drops)
+//   cpu_ns_per_packet      user + system CPU of this process per captured packet
+//   softirq_ns_per_packet  system-wide softirq CPU per offered packet
+//   copy_mbps              bytes copied out of the kernel buffers per second
+//
+// Modes:
+//   pcap     custom_tcpdump_capture (pcap_next + memcpy per packet)
+//   ring     custom_tcpdump_capture_ring (TPACKET_V3, one copy per packet)
+//   view     tpacket_ring zero-copy views, packets are only counted
+//   xdp      custom_tcpdump_capture_xdp (generic XDP + BPF ring buffer)
+//   headers  custom_tcpdump_capture_headers, 96-byte records, no payload
+//   hashed   the same plus a payload hash, full packets in the ring
+//
+// build: cc -O2 bench_capture.c custom_tcpdump.c custom_tcpdump_ring.c
+//        custom_tcpdump_xdp.c custom_tcpdump_headers.c tpacket_ring.c
+//        xdp_capture.c filter_cache.c pcapng_buf.c header_record.c
+//        flow_table.c -lpcap -lpthread
+// usage: bench_capture [packets] [payload bytes] [mode...]   (needs root)
+//        bench_capture -i iface seconds filter [mode...]
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pcap.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "custom_tcpdump.h"
+#include "custom_tcpdump_headers.h"
+#include "custom_tcpdump_ring.h"
+#include "custom_tcpdump_xdp.h"
+#include "tpacket_ring.h"
+#include "xdp_capture.h"
+
+#define BATCH 256
+#define FRAME_OVERHEAD (14 + 20 + 8)  // 以太网 + IPv4 + UDP 头
+#define ARENA_BYTES (64U << 20)       // -i 模式拷贝的目标区，写满后从头覆盖
+
+struct generator {
+  int port;
+  long packets;
+  int payload;
+  double seconds;
+};
+
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void* generate(void* arg) {
+  struct generator* g = arg;
+  struct sockaddr_in dst = {.sin_family = AF_INET,
+                            .sin_port = htons(g->port),
+                            .sin_addr.s_addr = htonl(INADDR_LOOPBACK)};
+  struct mmsghdr msgs[BATCH];
+  struct iovec iov;
+  char* payload = calloc(1, g->payload);
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+
+  iov.iov_base = payload;
+  iov.iov_len = g->payload;
+  memset(msgs, 0, sizeof(msgs));
+  for (int i = 0; i < BATCH; ++i) {
+    msgs[i].msg_hdr.msg_name = &dst;
+    msgs[i].msg_hdr.msg_namelen = sizeof(dst);
+    msgs[i].msg_hdr.msg_iov = &iov;
+    msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  usleep(300000);  // 等抓包端就绪
+  double start = now_sec();
+  for (long sent = 0; sent < g->packets;) {
+    int n = g->packets - sent < BATCH ? g->packets - sent : BATCH;
+    int r = sendmmsg(fd, msgs, n, 0);
+    if (r > 0) sent += r;
+  }
+  g->seconds = now_sec() - start;
+  close(fd);
+  free(payload);
+  return NULL;
+}
+
+// 目标端口上的接收端：只为了不产生 ICMP 端口不可达，从不读取
+static int bind_sink(int* port) {
+  struct sockaddr_in addr = {.sin_family = AF_INET,
+                             .sin_addr.s_addr = htonl(INADDR_LOOPBACK)};
+  socklen_t len = sizeof(addr);
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  bind(fd, (struct sockaddr*)&addr, sizeof(addr));
+  getsockname(fd, (struct sockaddr*)&addr, &len);
+  *port = ntohs(addr.sin_port);
+  return fd;
+}
+
+static long count_frames(const void* buf) {
+  uint32_t n = 0;
+  return pcapng_buf_index(buf, &n) ? (long)n : -1;
+}
+
+static long capture_view(const char* filter, uint64_t* kernel_drops) {
+  struct tpacket_ring* ring = tpacket_ring_open("lo", filter, NULL);
+  struct tpacket_block block;
+  struct tpacket_packet pkt;
+  uint64_t packets = 0;
+  long n = 0;
+
+  if (!ring) return -1;
+  while (tpacket_ring_next_block(ring, &block, 1000) > 0) {
+    while (tpacket_block_next(&block, &pkt)) ++n;
+    tpacket_ring_release_block(ring, &block);
+  }
+  tpacket_ring_stats(ring, &packets, kernel_drops);
+  tpacket_ring_close(ring);
+  return n;
+}
+
+static void run(const char* mode, long packets, int payload) {
+  struct generator g = {.packets = packets, .payload = payload};
+  int sink = bind_sink(&g.port);
+  // EPB 与索引项的开销都计算在内，保证放得下全部包
+  size_t record = 32 + FRAME_OVERHEAD + payload + 3 +
+                  sizeof(struct pcapng_index_entry);
+  size_t size = record * packets + 4096;
+  uint8_t* buf = malloc(size);
+  char filter[64];
+  struct custom_tcpdump_result result = {0};
+  uint64_t kernel_drops = 0;
+  long captured = -1;
+  size_t used = 0;
+  pthread_t gen;
+
+  snprintf(filter, sizeof(filter), "udp dst port %d", g.port);
+  pthread_create(&gen, NULL, generate, &g);
+  if (strcmp(mode, "pcap") == 0) {
+    if (custom_tcpdump_capture_ex("lo", filter, buf, size, &result) == 0) {
+      captured = count_frames(buf);
+      used = pcapng_buf_size(buf);
+      kernel_drops = result.kernel_drops;
+    }
+  } else if (strcmp(mode, "ring") == 0) {
+    if (custom_tcpdump_capture_ring_ex("lo", filter, buf, size, &result) ==
+        0) {
+      captured = count_frames(buf);
+      used = pcapng_buf_size(buf);
+      kernel_drops = result.kernel_drops;
+    }
+  } else if (strcmp(mode, "xdp") == 0) {
+    if (custom_tcpdump_capture_xdp_ex("lo", filter, buf, size, &result) ==
+        0) {
+      captured = count_frames(buf);
+      used = pcapng_buf_size(buf);
+      kernel_drops = result.kernel_drops;
+    }
+  } else if (strcmp(mode, "view") == 0) {
+    captured = capture_view(filter, &kernel_drops);
+  } else if (strcmp(mode, "headers") == 0 || strcmp(mode, "hashed") == 0) {
+    size_t n;
+    if (custom_tcpdump_capture_headers(
+            "lo", filter, strcmp(mode, "hashed") == 0 ? HEADER_RECORD_HASH : 0,
+            (struct header_record*)buf, size / sizeof(struct header_record),
+            &n) >= 0) {
+      captured = (long)n;
+      used = n * sizeof(struct header_record);
+    }
+  }
+  pthread_join(gen, NULL);
+
+  if (captured < 0) {
+    printf("%s.error 1\n", mode);
+  } else {
+    printf("%s.sent_pps %.0f\n", mode, packets / g.seconds);
+    printf("%s.captured_pps %.0f\n", mode, captured / g.seconds);
+    printf("%s.drop_rate %.4f\n", mode, 1.0 - (double)captured / packets);
+    if (captured > 0 && used)
+      printf("%s.bytes_per_packet %.1f\n", mode, (double)used / captured);
+    if (strcmp(mode, "headers") != 0 && strcmp(mode, "hashed") != 0)
+      printf("%s.kernel_drops %llu\n", mode,
+             (unsigned long long)kernel_drops);
+  }
+  free(buf);
+  close(sink);
+}
+
+// -i 模式：抓包时长固定，每个引擎各自循环到期限为止
+struct live_result {
+  uint64_t captured;
+  uint64_t drops;
+  uint64_t copied;  // 拷贝出的字节数
+  // live_begin 时的快照，live_end 时换算成差值
+  double start;
+  double cpu;
+  uint64_t rx;
+  uint64_t softirq;
+};
+
+static const char* live_iface;
+static uint8_t* arena;
+static size_t arena_pos;
+
+static double cpu_sec(void) {
+  struct rusage ru;
+  getrusage(RUSAGE_SELF, &ru);
+  return ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6 +
+         ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+}
+
+// /proc/stat 第一行的 softirq 列，单位 USER_HZ
+static uint64_t softirq_ticks(void) {
+  unsigned long long v[7] = {0};
+  FILE* f = fopen("/proc/stat", "r");
+
+  if (!f) return 0;
+  if (fscanf(f, "cpu %llu %llu %llu %llu %llu %llu %llu", &v[0], &v[1], &v[2],
+             &v[3], &v[4], &v[5], &v[6]) != 7)
+    v[6] = 0;
+  fclose(f);
+  return v[6];
+}
+
+// 引擎打开完成后才开始计时，XDP 程序加载等准备工作不计入
+static void live_begin(struct live_result* r) {
+  r->rx = custom_tcpdump_iface_packets(live_iface, 1);
+  r->softirq = softirq_ticks();
+  r->cpu = cpu_sec();
+  r->start = now_sec();
+}
+
+static void live_end(struct live_result* r) {
+  r->start = now_sec() - r->start;
+  r->cpu = cpu_sec() - r->cpu;
+  r->rx = custom_tcpdump_iface_packets(live_iface, 1) - r->rx;
+  r->softirq = softirq_ticks() - r->softirq;
+}
+
+static void copy_out(struct live_result* r, const void* data, uint32_t len) {
+  if (arena_pos + len > ARENA_BYTES) arena_pos = 0;
+  memcpy(arena + arena_pos, data, len);
+  arena_pos += len;
+  r->copied += len;
+}
+
+static int live_pcap(const char* filter, double seconds,
+                     struct live_result* r) {
+  char errbuf[PCAP_ERRBUF_SIZE];
+  struct bpf_program fp;
+  struct pcap_pkthdr header;
+  struct pcap_stat ps;
+  const u_char* packet;
+  pcap_t* handle = pcap_open_live(live_iface, 65535, 1, 100, errbuf);
+
+  if (!handle) {
+    fprintf(stderr, "pcap_open_live failed: %s\n", errbuf);
+    return -1;
+  }
+  if (pcap_compile(handle, &fp, filter, 0, PCAP_NETMASK_UNKNOWN) < 0 ||
+      pcap_setfilter(handle, &fp) < 0) {
+    fprintf(stderr, "pcap filter failed: %s\n", pcap_geterr(handle));
+    pcap_close(handle);
+    return -1;
+  }
+  pcap_freecode(&fp);
+
+  live_begin(r);
+  for (double deadline = r->start + seconds; now_sec() < deadline;) {
+    packet = pcap_next(handle, &header);
+    if (!packet) continue;
+    copy_out(r, packet, header.caplen);
+    r->captured++;
+  }
+  live_end(r);
+  if (pcap_stats(handle, &ps) == 0) r->drops = ps.ps_drop;
+  pcap_close(handle);
+  return 0;
+}
+
+// ring、view、headers、hashed 共用：mode 0 拷贝整包，1 只计数，
+// 2 生成头部记录，3 生成带负载哈希的头部记录
+static int live_tpacket(const char* filter, double seconds,
+                        struct live_result* r, int mode) {
+  struct tpacket_ring_config config = TPACKET_RING_CONFIG_LARGE;
+  struct tpacket_ring* ring;
+  struct tpacket_block block;
+  struct tpacket_packet pkt;
+  struct header_record rec;
+  uint64_t packets;
+
+  if (mode == 2) config.snaplen = HEADER_RECORD_SNAPLEN;
+  ring = tpacket_ring_open(live_iface, filter, &config);
+  if (!ring) return -1;
+  tpacket_ring_stats(ring, &packets, &r->drops);
+  r->drops = 0;
+
+  live_begin(r);
+  for (double deadline = r->start + seconds; now_sec() < deadline;) {
+    if (tpacket_ring_next_block(ring, &block, 100) <= 0) continue;
+    while (tpacket_block_next(&block, &pkt)) {
+      if (mode == 0) {
+        copy_out(r, pkt.data, pkt.caplen);
+      } else if (mode >= 2) {
+        header_record_parse(&rec, pkt.data, pkt.caplen, pkt.len, pkt.ts_ns,
+                            mode == 3 ? HEADER_RECORD_HASH : 0);
+        copy_out(r, &rec, sizeof(rec));
+      }
+      r->captured++;
+    }
+    tpacket_ring_release_block(ring, &block);
+  }
+  live_end(r);
+  tpacket_ring_stats(ring, &packets, &r->drops);
+  tpacket_ring_close(ring);
+  return 0;
+}
+
+static int live_xdp(const char* filter, double seconds,
+                    struct live_result* r) {
+  struct xdp_capture* xc = xdp_capture_open(live_iface, filter, NULL);
+  struct tpacket_packet pkt;
+  uint64_t packets;
+
+  if (!xc) return -1;
+  xdp_capture_stats(xc, &packets, &r->drops);
+  r->drops = 0;
+
+  live_begin(r);
+  for (double deadline = r->start + seconds; now_sec() < deadline;) {
+    if (xdp_capture_next(xc, &pkt, 100) <= 0) continue;
+    copy_out(r, pkt.data, pkt.caplen);
+    r->captured++;
+  }
+  live_end(r);
+  xdp_capture_stats(xc, &packets, &r->drops);
+  xdp_capture_close(xc);
+  return 0;
+}
+
+static void run_live(const char* mode, const char* filter, double seconds) {
+  static const char* tpacket_modes[] = {"ring", "view", "headers", "hashed"};
+  struct live_result r;
+  int ret = -1;
+
+  memset(&r, 0, sizeof(r));
+  if (strcmp(mode, "pcap") == 0) {
+    ret = live_pcap(filter, seconds, &r);
+  } else if (strcmp(mode, "xdp") == 0) {
+    ret = live_xdp(filter, seconds, &r);
+  } else {
+    for (int i = 0; i < 4; ++i)
+      if (strcmp(mode, tpacket_modes[i]) == 0)
+        ret = live_tpacket(filter, seconds, &r, i);
+  }
+
+  if (ret < 0) {
+    printf("%s.error 1\n", mode);
+    return;
+  }
+  printf("%s.offered_pps %.0f\n", mode, r.rx / r.start);
+  printf("%s.captured_pps %.0f\n", mode, r.captured / r.start);
+  printf("%s.drop_rate %.4f\n", mode,
+         r.captured + r.drops ? (double)r.drops / (r.captured + r.drops) : 0);
+  printf("%s.cpu_ns_per_packet %.1f\n", mode,
+         r.captured ? r.cpu * 1e9 / r.captured : 0);
+  printf("%s.softirq_ns_per_packet %.1f\n", mode,
+         r.rx ? r.softirq * 1e9 / sysconf(_SC_CLK_TCK) / r.rx : 0);
+  printf("%s.copy_mbps %.1f\n", mode, r.copied / r.start / 1e6);
+}
+
+int main(int argc, char** argv) {
+  static const char* all[] = {"pcap", "ring", "view", "xdp", "headers",
+                              "hashed"};
+
+  if (argc > 1 && strcmp(argv[1], "-i") == 0) {
+    if (argc < 5) {
+      fprintf(stderr, "usage: %s -i iface seconds filter [mode...]\n",
+              argv[0]);
+      return 1;
+    }
+    live_iface = argv[2];
+    arena = malloc(ARENA_BYTES);
+    // 预先触碰，避免缺页算进第一个引擎
+    memset(arena, 0, ARENA_BYTES);
+    if (argc > 5) {
+      for (int i = 5; i < argc; ++i) run_live(argv[i], argv[4], atof(argv[3]));
+    } else {
+      for (int i = 0; i < 6; ++i) run_live(all[i], argv[4], atof(argv[3]));
+    }
+    free(arena);
+    return 0;
+  }
+
+  long packets = argc > 1 ? atol(argv[1]) : 1000000;
+  int payload = argc > 2 ? atoi(argv[2]) : 64;
+
+  if (argc > 3) {
+    for (int i = 3; i < argc; ++i) run(argv[i], packets, payload);
+  } else {
+    for (int i = 0; i < 6; ++i) run(all[i], packets, payload);
+  }
+  return 0;
+}
@@ -0,0 +1,21 @@
+#!/bin/sh
+# Capture scaling over a veth pair: udpgen runs in its own network namespace
+# and sends into ct1, bench_fanout captures on ct0 with 1..16 workers.
+#
+# usage: sudo ./bench_fanout.sh [hash|cpu|rollover] [seconds] [udpgen threads]
+set -e
+cd "$(dirname "$0")"
+. ./bench_net.sh
+
+TYPE=${1:-hash}
+SECS=${2:-5}
+GEN_THREADS=${3:-$(nproc)}
+
+make -s bench_fanout udpgen
+veth_setup
+
+for n in 1 2 4 8 16; do
+  start_udpgen "$SECS"
+  ./bench_fanout ct0 $n "$TYPE" "$SECS" | grep -v worker
+  wait
+done
@@ -0,0 +1,39 @@
+# 压测脚本共用的 veth 环境，由 bench_veth.sh、bench_fanout.sh 用 . 引入。
+#
+# veth_setup 建立 ct0 <-> ct1 两端，ct1 放进独立的网络命名空间 $NS，
+# 退出时自动拆除；之后 start_udpgen 从命名空间里向 ct0 发包。
+# 不调用 veth_setup 时 GEN、DST 为空，由调用方自行指定（如 lo）。
+
+NS=ctbench
+GEN=
+DST=
+
+veth_cleanup() {
+  ip link del ct0 2>/dev/null || true
+  ip netns del $NS 2>/dev/null || true
+}
+
+veth_setup() {
+  trap veth_cleanup EXIT
+  veth_cleanup
+  ip netns add $NS
+  ip link add ct0 type veth peer name ct1
+  ip link set ct1 netns $NS
+  ip addr add 10.77.0.1/24 dev ct0
+  ip link set ct0 up
+  ip netns exec $NS ip addr add 10.77.0.2/24 dev ct1
+  ip netns exec $NS ip link set ct1 up
+  ip netns exec $NS ip link set lo up
+  GEN="ip netns exec $NS"
+  DST=10.77.0.1
+}
+
+# start_udpgen seconds [payload flows/thread pps]
+# 在后台向 $DST 的 9 端口发包，调用方抓完包后 wait
+start_udpgen() {
+  secs=$1
+  shift
+  # 发送端比抓包端多跑 2 秒，覆盖整个抓包窗口
+  $GEN ./udpgen "$DST" 9 "$GEN_THREADS" $((secs + 2)) "$@" >/dev/null &
+  sleep 1
+}
@@ -0,0 +1,100 @@
+// Per-capture setup cost for a dozen filters used round-robin:
+//
+//   pcap     pcap_open_live + pcap_compile + pcap_setfilter + pcap_close,
+//            what every custom_tcpdump_capture call pays
+//   ring     tpacket_ring_open + close with the filter cache warm
+//   session  filter swap on an open session: SO_ATTACH_FILTER from the
+//            cache, then pause and flush as custom_tcpdump_session_capture
+//            does around every capture
+//
+// build: cc -O2 bench_setup.c tpacket_ring.c filter_cache.c -lpcap -lpthread
+// usage: bench_setup [iface] [rounds]   (needs root)
+#include <pcap.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "filter_cache.h"
+#include "tpacket_ring.h"
+
+static const char* filters[] = {
+    "tcp port 80",          "tcp port 443",        "udp port 53",
+    "icmp",                 "arp",                 "tcp[tcpflags] & tcp-syn != 0",
+    "host 10.0.0.1",        "net 192.168.0.0/16",  "udp portrange 5000-6000",
+    "ip6",                  "tcp and not port 22", "vlan and udp",
+};
+#define NR_FILTERS (sizeof(filters) / sizeof(filters[0]))
+
+static double now_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int setup_pcap(const char* iface, const char* filter) {
+  char errbuf[PCAP_ERRBUF_SIZE];
+  struct bpf_program fp;
+  pcap_t* handle = pcap_open_live(iface, BUFSIZ, 1, 1000, errbuf);
+  if (!handle) return -1;
+  int ret = pcap_compile(handle, &fp, filter, 0, PCAP_NETMASK_UNKNOWN);
+  if (ret == 0) {
+    ret = pcap_setfilter(handle, &fp);
+    pcap_freecode(&fp);
+  }
+  pcap_close(handle);
+  return ret;
+}
+
+static int setup_ring(const char* iface, const char* filter) {
+  struct tpacket_ring* ring = tpacket_ring_open(iface, filter, NULL);
+  if (!ring) return -1;
+  tpacket_ring_close(ring);
+  return 0;
+}
+
+static struct tpacket_ring* session;
+
+static int setup_session(const char* iface, const char* filter) {
+  (void)iface;
+  if (tpacket_ring_set_filter(session, filter) < 0) return -1;
+  tpacket_ring_pause(session);
+  tpacket_ring_flush(session, 20);
+  return 0;
+}
+
+static void run(const char* name, int (*setup)(const char*, const char*),
+                const char* iface, int rounds) {
+  double start = now_us();
+  for (int i = 0; i < rounds; ++i) {
+    if (setup(iface, filters[i % NR_FILTERS]) != 0) {
+      printf("%s.error 1\n", name);
+      return;
+    }
+  }
+  printf("%s.setup_us %.1f\n", name, (now_us() - start) / rounds);
+}
+
+int main(int argc, char** argv) {
+  const char* iface = argc > 1 ? argv[1] : "lo";
+  int rounds = argc > 2 ? atoi(argv[2]) : 120;
+
+  // 第一次编译单独计时，之后都命中缓存
+  struct filter_cache* cache = filter_cache_default();
+  double start = now_us();
+  for (size_t i = 0; i < NR_FILTERS; ++i) {
+    const struct sock_fprog* prog =
+        cache ? filter_cache_get(cache, filters[i], 65535, 1) : NULL;
+    if (!prog) return 1;
+    filter_cache_put(cache, prog);
+  }
+  printf("compile.cold_us %.1f\n", (now_us() - start) / NR_FILTERS);
+
+  run("pcap", setup_pcap, iface, rounds);
+  run("ring", setup_ring, iface, rounds / 10 + 1);
+
+  session = tpacket_ring_open(iface, NULL, NULL);
+  if (!session) return 1;
+  run("session", setup_session, iface, rounds);
+  tpacket_ring_close(session);
+  return 0;
+}
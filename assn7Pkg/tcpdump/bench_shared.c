@@ -0,0 +1,110 @@
+// shared_ring fan-out cost: one producer publishes fixed-size packets as fast
+// as it can for a fixed time while 0..N consumer processes read them, with
+// either backpressure policy. Reports the producer rate, the mean consumer
+// rate and the fraction of packets consumers lost.
+//
+// build: cc -O2 bench_shared.c shared_ring.c
+// usage: bench_shared [seconds] [packet bytes] [max consumers]
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "shared_ring.h"
+
+struct consumer_result {
+  uint64_t packets;
+  uint64_t drops;
+  double seconds;
+};
+
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void consume(const char* name, enum shared_ring_policy policy,
+                    int ready, struct consumer_result* out) {
+  struct shared_ring_consumer* c = shared_ring_attach(name, policy);
+  struct tpacket_packet pkt;
+  double start = 0;
+
+  if (!c || write(ready, "x", 1) != 1) _exit(1);
+  while (shared_ring_read(c, &pkt, -1) == 1)
+    if (!start) start = now_sec();
+  out->seconds = now_sec() - start;
+  shared_ring_consumer_stats(c, &out->packets, &out->drops);
+  shared_ring_detach(c);
+  _exit(0);
+}
+
+static void run(enum shared_ring_policy policy, int consumers, double seconds,
+                uint32_t bytes) {
+  const char* label = policy == SHARED_RING_BLOCK ? "block" : "drop_oldest";
+  struct consumer_result* results =
+      mmap(NULL, sizeof(*results) * (consumers + 1), PROT_READ | PROT_WRITE,
+           MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  uint8_t* payload = calloc(1, bytes);
+  uint64_t published, waits, packets = 0, drops = 0;
+  double elapsed, consumer_sec = 0;
+  int attached, ready[2];
+  char name[64], c;
+
+  snprintf(name, sizeof(name), "/bench_shared.%d", getpid());
+  struct shared_ring* ring = shared_ring_create(name, NULL);
+  if (!ring || pipe(ready) < 0) return;
+  for (int i = 0; i < consumers; ++i)
+    if (fork() == 0) consume(name, policy, ready[1], &results[i]);
+  for (int i = 0; i < consumers; ++i)
+    if (read(ready[0], &c, 1) != 1) return;
+
+  double start = now_sec(), end = start + seconds;
+  for (uint64_t n = 0;; ++n) {
+    // 每 1024 个包看一次时间
+    if ((n & 1023) == 0 && now_sec() >= end) break;
+    shared_ring_publish(ring, payload, bytes, bytes, n);
+  }
+  elapsed = now_sec() - start;
+  shared_ring_stats(ring, &published, &waits, &attached);
+  shared_ring_destroy(ring);
+  while (wait(NULL) > 0) {
+  }
+
+  for (int i = 0; i < consumers; ++i) {
+    packets += results[i].packets;
+    drops += results[i].drops;
+    consumer_sec += results[i].seconds;
+  }
+  printf("%s.%d.publish_pps %.0f\n", label, consumers, published / elapsed);
+  if (consumers) {
+    printf("%s.%d.consumer_pps %.0f\n", label, consumers,
+           packets / consumer_sec);
+    printf("%s.%d.drop_rate %.4f\n", label, consumers,
+           (double)drops / (packets + drops));
+    printf("%s.%d.producer_waits %llu\n", label, consumers,
+           (unsigned long long)waits);
+  }
+  close(ready[0]);
+  close(ready[1]);
+  free(payload);
+  munmap(results, sizeof(*results) * (consumers + 1));
+}
+
+int main(int argc, char** argv) {
+  double seconds = argc > 1 ? atof(argv[1]) : 2;
+  uint32_t bytes = argc > 2 ? atoi(argv[2]) : 64;
+  int max = argc > 3 ? atoi(argv[3]) : 4;
+
+  run(SHARED_RING_DROP_OLDEST, 0, seconds, bytes);
+  for (int n = 1; n <= max; n *= 2) {
+    run(SHARED_RING_DROP_OLDEST, n, seconds, bytes);
+    run(SHARED_RING_BLOCK, n, seconds, bytes);
+  }
+  return 0;
+}
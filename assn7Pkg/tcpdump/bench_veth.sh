@@ -0,0 +1,42 @@
+#!/bin/sh
+# Capture backends over synthetic traffic: udpgen runs in its own network
+# namespace and sends into ct1, bench_capture -i captures on ct0 with every
+# backend. Sweeps packet size, offered rate and filter; "lo" sends to
+# 127.0.0.1 and captures on the loopback instead.
+#
+# usage: sudo ./bench_veth.sh [seconds] [udpgen threads] [veth|lo]
+#   SIZES, RATES (pps, 0 = unlimited) and BACKENDS override the sweep
+set -e
+cd "$(dirname "$0")"
+. ./bench_net.sh
+
+SECS=${1:-3}
+GEN_THREADS=${2:-2}
+LINK=${3:-veth}
+SIZES=${SIZES:-"64 512 1400"}
+RATES=${RATES:-"100000 0"}
+BACKENDS=${BACKENDS:-"pcap ring view xdp headers"}
+
+make -s bench_capture udpgen
+
+if [ "$LINK" = lo ]; then
+  IFACE=lo
+  DST=127.0.0.1
+else
+  IFACE=ct0
+  veth_setup
+fi
+
+# 不过滤、全部通过、精确匹配、全部拒绝
+for size in $SIZES; do
+  for rate in $RATES; do
+    for filter in "" "udp" "udp dst port 9" "tcp port 80"; do
+      for backend in $BACKENDS; do
+        echo "# payload $size rate $rate filter '$filter'"
+        start_udpgen "$SECS" "$size" 16 "$rate"
+        ./bench_capture -i $IFACE "$SECS" "$filter" "$backend"
+        wait
+      done
+    done
+  done
+done
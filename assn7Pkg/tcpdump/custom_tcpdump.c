@@ -1,33 +1,107 @@
 #include "custom_tcpdump.h"
 
+#include <net/if.h>
 #include <pcap.h>
 #include <stdio.h>
-#include <stdlib.h>
 #include <string.h>
 
+// 接口上出现过的包数：一般接口的抓包 socket 能看到收发两个方向，lo 上的
+// 每个包都既被发送又被接收，只算一次；XDP 只能看到接收方向
+uint64_t custom_tcpdump_iface_packets(const char* iface, int rx_only) {
+  static const char* names[] = {"rx_packets", "tx_packets"};
+  char path[128];
+  unsigned long long n, total = 0;
+  unsigned int flags = 0;
+  FILE* f;
+
+  snprintf(path, sizeof(path), "/sys/class/net/%s/flags", iface);
+  if ((f = fopen(path, "r"))) {
+    if (fscanf(f, "%x", &flags) != 1) flags = 0;
+    fclose(f);
+  }
+  if (flags & IFF_LOOPBACK) rx_only = 1;
+  for (int i = 0; i < (rx_only ? 1 : 2); ++i) {
+    snprintf(path, sizeof(path), "/sys/class/net/%s/statistics/%s", iface,
+             names[i]);
+    if (!(f = fopen(path, "r"))) continue;
+    if (fscanf(f, "%llu", &n) == 1) total += n;
+    fclose(f);
+  }
+  return total;
+}
+
+/**
+ * @brief 由内核计数补全 result
+ *
+ * passed 是通过过滤的包数（含内核丢弃的），其中既没被内核丢弃、也没写进
+ * buffer 的，都是 buffer 满了之后才到的；接口上出现过但没通过过滤的就是
+ * 被过滤掉的。接口计数包含抓包开始前后的少量包，filtered 只是估计值。
+ */
+void custom_tcpdump_finish_result(struct custom_tcpdump_result* result,
+                                  const struct pcapng_writer* writer,
+                                  uint64_t truncated, uint64_t passed,
+                                  uint64_t drops, uint64_t seen) {
+  result->received = writer->count;
+  result->kernel_drops = drops;
+  result->truncated = truncated;
+  result->buffer_drops =
+      passed > drops + writer->count ? passed - drops - writer->count : 0;
+  result->filtered = seen > passed ? seen - passed : 0;
+}
+
+int custom_tcpdump_capture(const char* iface, const char* custom_filter,
+                           void* buffer, size_t buffer_size) {
+  return custom_tcpdump_capture_ex(iface, custom_filter, buffer, buffer_size,
+                                   NULL);
+}
+
 /**
  * @brief 使用自定义过滤规则对网络数据进行抓包
  *
+ * 时间戳优先使用 libpcap 的 ns 精度，不支持时退回 µs。
+ *
  * @param iface 抓包使用的网络接口（如 "eth0", "lo"）
  * @param custom_filter 用户传入的过滤规则（如 "tcp port 80"）
- * @param buffer 用户传入的缓冲区，用于保存抓到的数据
+ * @param buffer 用户传入的缓冲区，用于保存抓到的数据（pcapng 格式）
  * @param buffer_size 缓冲区的最大大小（以字节为单位）
+ * @param result 返回抓包统计，可以为 NULL
  * @return 抓包成功返回 0，失败返回负数（不同负数代表不同错误）
  */
-int custom_tcpdump_capture(const char* iface, const char* custom_filter,
-                           void* buffer, size_t buffer_size) {
+int custom_tcpdump_capture_ex(const char* iface, const char* custom_filter,
+                              void* buffer, size_t buffer_size,
+                              struct custom_tcpdump_result* result) {
   char errbuf[PCAP_ERRBUF_SIZE];
   pcap_t* handle = NULL;
   struct bpf_program fp;
   const u_char* packet;
   struct pcap_pkthdr header;
-  size_t offset = 0;
+  struct pcapng_writer writer;
+  struct pcap_stat ps;
+  uint64_t truncated = 0, seen;
+  int nano, ret;
+
+  if (pcapng_writer_init(&writer, buffer, buffer_size, DLT_EN10MB, BUFSIZ) <
+      0) {
+    fprintf(stderr, "buffer too small for capture headers\n");
+    return -4;
+  }
 
-  handle = pcap_open_live(iface, BUFSIZ, 1, 1000, errbuf);
+  handle = pcap_create(iface, errbuf);
   if (!handle) {
-    fprintf(stderr, "pcap_open_live failed: %s\n", errbuf);
+    fprintf(stderr, "pcap_create failed: %s\n", errbuf);
+    return -1;
+  }
+  pcap_set_snaplen(handle, BUFSIZ);
+  pcap_set_promisc(handle, 1);
+  pcap_set_timeout(handle, 1000);
+  pcap_set_tstamp_precision(handle, PCAP_TSTAMP_PRECISION_NANO);
+  ret = pcap_activate(handle);
+  if (ret < 0) {
+    fprintf(stderr, "pcap_activate failed: %s\n", pcap_statustostr(ret));
+    pcap_close(handle);
     return -1;
   }
+  nano = pcap_get_tstamp_precision(handle) == PCAP_TSTAMP_PRECISION_NANO;
 
   if (pcap_compile(handle, &fp, custom_filter, 0, PCAP_NETMASK_UNKNOWN) < 0) {
     fprintf(stderr, "pcap_compile failed: %s\n", pcap_geterr(handle));
@@ -43,14 +117,27 @@ int custom_tcpdump_capture(const char* iface, const char* custom_filter,
   }
 
   pcap_freecode(&fp);
+  seen = custom_tcpdump_iface_packets(iface, 0);
 
+  // 只有 caplen 字节是有效数据，len 是原始长度；ns 精度时 tv_usec 中是 ns
   while ((packet = pcap_next(handle, &header)) != NULL) {
-    if (offset + header.len > buffer_size) break;
-
-    memcpy((u_char*)buffer + offset, packet, header.len);
-    offset += header.len;
+    uint64_t ts_ns = header.ts.tv_sec * 1000000000ULL +
+                     header.ts.tv_usec * (nano ? 1ULL : 1000ULL);
+    if (pcapng_writer_append(&writer, packet, header.caplen, header.len,
+                             ts_ns) < 0)
+      break;
+    if (header.caplen < header.len) ++truncated;
   }
 
+  pcapng_writer_finish(&writer);
+  if (result) {
+    // Linux 上 ps_recv 是通过过滤的包数，含 ps_drop
+    memset(&ps, 0, sizeof(ps));
+    pcap_stats(handle, &ps);
+    custom_tcpdump_finish_result(result, &writer, truncated, ps.ps_recv, ps.ps_drop,
+                  custom_tcpdump_iface_packets(iface, 0) - seen);
+    result->ts_resolution_ns = nano ? 1 : 1000;
+  }
   pcap_close(handle);
   return 0;
 }
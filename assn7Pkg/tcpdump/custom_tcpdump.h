@@ -1,9 +1,36 @@
 #ifndef CUSTOM_TCPDUMP_H
 #define CUSTOM_TCPDUMP_H
 #include <stddef.h>
+#include <stdint.h>
+
+#include "pcapng_buf.h"
+
+// 抓包接口：基于 libpcap 的基线实现与各后端共用的结果类型。其余后端各有
+// 自己的头文件与目标文件（custom_tcpdump_ring.h、custom_tcpdump_xdp.h 等），
+// 只用基线时只需链接 custom_tcpdump.c 与 pcapng_buf.c。
+
+struct custom_tcpdump_limits {
+  uint64_t max_packets;  // 抓到这么多包后结束，0 表示不限
+  uint64_t duration_ms;  // 从开始起经过这么久后结束，0 表示不限
+};
+
+// 一次抓包的统计，用来判断抓到的数据是否完整
+struct custom_tcpdump_result {
+  uint64_t received;      // 写进 buffer 的包数
+  uint64_t kernel_drops;  // 通过过滤，但内核的缓冲区或环已满而丢弃
+  uint64_t buffer_drops;  // 通过过滤且交到了用户态，但 buffer 已满没有写入
+  uint64_t truncated;     // 写入的包中被 snaplen 截断（caplen < len）的
+  uint64_t filtered;      // 被过滤器拒绝的包数，由接口的收发计数估计
+  uint32_t ts_resolution_ns;  // 时间戳的实际精度：1 为 ns，1000 为 µs
+};
 
 /**
  * @brief 使用自定义过滤规则对网络数据进行抓包
+ *
+ * buffer 中写入的是带索引的 pcapng 文件（格式见 pcapng_buf.h），总长度
+ * 由 pcapng_buf_size 给出，可以原样写盘；pcapng_buf_index 直接给出每个包的
+ * 时间戳、caplen、len 与偏移。buffer 需按 PCAPNG_BUF_ALIGN 对齐。
+ *
  * @param iface 需要进行抓包的网络接口名称
  * @param custom_filter 用户自定义的过滤表达式
  * @param buffer 存储抓取到的数据缓冲区
@@ -13,4 +40,35 @@
 int custom_tcpdump_capture(const char* iface, const char* custom_filter,
                            void* buffer, size_t buffer_size);
 
-#endif
\ No newline at end of file
+/**
+ * @brief 与 custom_tcpdump_capture 相同，并返回抓包统计
+ *
+ * custom_tcpdump_capture 的返回值只说明抓包是否成功进行；内核丢包、buffer
+ * 写满以及截断都要从 result 中判断。时间戳优先使用 ns 精度，实际精度见
+ * result->ts_resolution_ns。
+ *
+ * @param result 返回抓包统计，可以为 NULL
+ * @return 与 custom_tcpdump_capture 相同
+ */
+int custom_tcpdump_capture_ex(const char* iface, const char* custom_filter,
+                              void* buffer, size_t buffer_size,
+                              struct custom_tcpdump_result* result);
+
+/**
+ * @brief 接口上出现过的包数，各后端用它估计 result->filtered
+ * @param rx_only 只统计接收方向（XDP 只能看到接收方向）
+ */
+uint64_t custom_tcpdump_iface_packets(const char* iface, int rx_only);
+
+/**
+ * @brief 由写入的包数与内核计数补全 result 中除 ts_resolution_ns 外的字段
+ * @param passed 通过过滤的包数，含内核丢弃的
+ * @param drops 内核丢弃的包数
+ * @param seen 抓包期间接口上出现过的包数
+ */
+void custom_tcpdump_finish_result(struct custom_tcpdump_result* result,
+                                  const struct pcapng_writer* writer,
+                                  uint64_t truncated, uint64_t passed,
+                                  uint64_t drops, uint64_t seen);
+
+#endif
@@ -0,0 +1,131 @@
+#include "custom_tcpdump_async.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+struct custom_tcpdump_async {
+  struct tpacket_ring* ring;
+  int epfd;     // 对外的 fd，内含环 socket 与 timerfd
+  int timerfd;  // 没有时长上限时为 -1
+  custom_tcpdump_batch_cb cb;
+  void* user;
+  uint64_t max_packets;
+  uint64_t packets;
+  int done;
+  struct tpacket_packet* batch;  // 一块中所有包的视图，按需增长
+  size_t batch_cap;
+};
+
+/**
+ * @brief 开始一次非阻塞抓包
+ *
+ * 对外只暴露一个 epoll fd：环 socket 在有块可读时可读，timerfd 在时长到期
+ * 时可读，epoll fd 本身又可以嵌套进调用者的 epoll/poll。
+ */
+struct custom_tcpdump_async* custom_tcpdump_async_start(
+    const char* iface, const char* custom_filter,
+    const struct custom_tcpdump_limits* limits, custom_tcpdump_batch_cb cb,
+    void* user) {
+  struct custom_tcpdump_async* capture = calloc(1, sizeof(*capture));
+  struct epoll_event ev = {.events = EPOLLIN};
+
+  if (!capture) return NULL;
+  capture->timerfd = -1;
+  capture->cb = cb;
+  capture->user = user;
+  capture->epfd = epoll_create1(EPOLL_CLOEXEC);
+  if (capture->epfd < 0) goto fail;
+
+  capture->ring = tpacket_ring_open(iface, custom_filter, NULL);
+  if (!capture->ring) goto fail;
+  if (epoll_ctl(capture->epfd, EPOLL_CTL_ADD, tpacket_ring_fd(capture->ring),
+                &ev) < 0)
+    goto fail;
+
+  if (limits && limits->duration_ms) {
+    struct itimerspec its = {
+        .it_value = {.tv_sec = limits->duration_ms / 1000,
+                     .tv_nsec = limits->duration_ms % 1000 * 1000000}};
+    capture->timerfd =
+        timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (capture->timerfd < 0 ||
+        timerfd_settime(capture->timerfd, 0, &its, NULL) < 0 ||
+        epoll_ctl(capture->epfd, EPOLL_CTL_ADD, capture->timerfd, &ev) < 0)
+      goto fail;
+  }
+  if (limits) capture->max_packets = limits->max_packets;
+  return capture;
+
+fail:
+  perror("custom_tcpdump_async_start");
+  custom_tcpdump_async_stop(capture);
+  return NULL;
+}
+
+int custom_tcpdump_async_fd(const struct custom_tcpdump_async* capture) {
+  return capture->epfd;
+}
+
+/**
+ * @brief 处理所有已经到达的块，每块调用一次回调
+ *
+ * 达到包数上限时最后一批只交出上限以内的包；时长到期后不再处理新的块。
+ */
+int custom_tcpdump_async_poll(struct custom_tcpdump_async* capture) {
+  struct tpacket_block block;
+  uint64_t expirations;
+  int n;
+
+  if (capture->done) return 0;
+  if (capture->timerfd >= 0 &&
+      read(capture->timerfd, &expirations, sizeof(expirations)) > 0) {
+    capture->done = 1;
+    return 0;
+  }
+
+  while ((n = tpacket_ring_next_block(capture->ring, &block, 0)) > 0) {
+    size_t count = 0;
+
+    if (block.remaining > capture->batch_cap) {
+      struct tpacket_packet* batch =
+          realloc(capture->batch, block.remaining * sizeof(*batch));
+      if (!batch) {
+        tpacket_ring_release_block(capture->ring, &block);
+        return -1;
+      }
+      capture->batch = batch;
+      capture->batch_cap = block.remaining;
+    }
+    while (tpacket_block_next(&block, &capture->batch[count])) ++count;
+    if (capture->max_packets &&
+        count > capture->max_packets - capture->packets)
+      count = capture->max_packets - capture->packets;
+
+    capture->cb(capture->batch, count, capture->user);
+    capture->packets += count;
+    tpacket_ring_release_block(capture->ring, &block);
+
+    if (capture->max_packets && capture->packets >= capture->max_packets) {
+      capture->done = 1;
+      return 0;
+    }
+  }
+  return n < 0 ? -1 : 1;
+}
+
+uint64_t custom_tcpdump_async_stop(struct custom_tcpdump_async* capture) {
+  uint64_t packets;
+
+  if (!capture) return 0;
+  packets = capture->packets;
+  tpacket_ring_close(capture->ring);
+  if (capture->timerfd >= 0) close(capture->timerfd);
+  if (capture->epfd >= 0) close(capture->epfd);
+  free(capture->batch);
+  free(capture);
+  return packets;
+}
@@ -0,0 +1,58 @@
+#ifndef CUSTOM_TCPDUMP_ASYNC_H
+#define CUSTOM_TCPDUMP_ASYNC_H
+#include <stddef.h>
+#include <stdint.h>
+
+#include "custom_tcpdump.h"
+#include "tpacket_ring.h"
+
+// 非阻塞抓包，由调用者的事件循环驱动
+
+/**
+ * @brief 异步抓包的批回调
+ * @param packets 一批包的零拷贝视图，只在回调期间有效
+ * @param count 包数
+ * @param user custom_tcpdump_async_start 传入的用户指针
+ */
+typedef void (*custom_tcpdump_batch_cb)(const struct tpacket_packet* packets,
+                                        size_t count, void* user);
+
+struct custom_tcpdump_async;
+
+/**
+ * @brief 开始一次非阻塞抓包，不创建线程
+ *
+ * 之后由调用者在自己的事件循环里等待 custom_tcpdump_async_fd 可读，再调用
+ * custom_tcpdump_async_poll 处理已经到达的包；每个 TPACKET_V3 块作为一批
+ * 交给回调。一个线程可以同时驱动任意多个接口上的抓包。
+ *
+ * @param iface 需要进行抓包的网络接口名称
+ * @param custom_filter 用户自定义的过滤表达式
+ * @param limits 包数与时长上限，NULL 表示不限，直到 stop
+ * @param cb 批回调
+ * @param user 透传给回调的指针
+ * @return 成功返回句柄，失败返回 NULL
+ */
+struct custom_tcpdump_async* custom_tcpdump_async_start(
+    const char* iface, const char* custom_filter,
+    const struct custom_tcpdump_limits* limits, custom_tcpdump_batch_cb cb,
+    void* user);
+
+/**
+ * @brief 可以放进 poll/epoll 的 fd，有包到达或时长到期时可读
+ */
+int custom_tcpdump_async_fd(const struct custom_tcpdump_async* capture);
+
+/**
+ * @brief 处理所有已经到达的包，不阻塞
+ * @return 仍在抓包返回 1，已达到上限返回 0，出错返回 -1
+ */
+int custom_tcpdump_async_poll(struct custom_tcpdump_async* capture);
+
+/**
+ * @brief 结束抓包并释放句柄，未处理的包被丢弃
+ * @return 交给回调的包总数
+ */
+uint64_t custom_tcpdump_async_stop(struct custom_tcpdump_async* capture);
+
+#endif
@@ -0,0 +1,108 @@
+#include "custom_tcpdump_headers.h"
+
+#include <string.h>
+
+#include "tpacket_ring.h"
+
+/**
+ * @brief 只保留协议头的抓包
+ *
+ * 包在环内存中就地解析，只有定长记录被写进 records，载荷从不复制。
+ * 需要载荷哈希时才抓取完整的包，否则 snaplen 降到 HEADER_RECORD_SNAPLEN，
+ * 内核向环中复制的字节数也随之减少。records 写满后再出现的包无处存放，
+ * 抓包随即结束并返回 1，调用方由此知道记录不完整。
+ *
+ * @param iface 抓包使用的网络接口（如 "eth0", "lo"）
+ * @param custom_filter 用户传入的过滤规则（如 "tcp port 80"）
+ * @param flags HEADER_RECORD_HASH 或 0
+ * @param records 用户传入的记录数组
+ * @param max_records 数组能放下的记录数
+ * @param nr_records 返回实际写入的记录数
+ * @return 抓包成功返回 0，records 放不下全部的包返回 1，失败返回负数
+ */
+int custom_tcpdump_capture_headers(const char* iface,
+                                   const char* custom_filter,
+                                   unsigned int flags,
+                                   struct header_record* records,
+                                   size_t max_records, size_t* nr_records) {
+  struct tpacket_ring* ring;
+  struct tpacket_ring_config config = TPACKET_RING_CONFIG_DEFAULT;
+  struct tpacket_block block;
+  struct tpacket_packet pkt;
+  size_t n = 0;
+  int full = 0;
+
+  *nr_records = 0;
+  if (!(flags & HEADER_RECORD_HASH)) config.snaplen = HEADER_RECORD_SNAPLEN;
+  tpacket_ring_config_size(&config, 0);
+  ring = tpacket_ring_open(iface, custom_filter, &config);
+  if (!ring) return -1;
+
+  while (!full && tpacket_ring_next_block(ring, &block, 1000) > 0) {
+    while (tpacket_block_next(&block, &pkt)) {
+      if (n == max_records) {
+        full = 1;
+        break;
+      }
+      header_record_parse(&records[n++], pkt.data, pkt.caplen, pkt.len,
+                          pkt.ts_ns, flags);
+    }
+    tpacket_ring_release_block(ring, &block);
+  }
+
+  tpacket_ring_close(ring);
+  *nr_records = n;
+  return full;
+}
+
+/**
+ * @brief 抓包并按 5 元组聚合
+ *
+ * 每个包在环内存中解析出协议头后立即计入流表，只需要抓取
+ * HEADER_RECORD_SNAPLEN 字节。结束时把流表整体复制到 flows。流表满了
+ * 以后新流的包被丢弃，已有的流照常计数直到空闲，已有流的计数因此是完整的。
+ *
+ * @param iface 抓包使用的网络接口（如 "eth0", "lo"）
+ * @param custom_filter 用户传入的过滤规则（如 "tcp port 80"）
+ * @param flows 用户传入的流记录数组
+ * @param max_flows 数组能放下的流数
+ * @param nr_flows 返回实际写入的流数
+ * @return 抓包成功返回 0，有新流因 flows 已满被丢弃返回 1，失败返回负数
+ */
+int custom_tcpdump_capture_flows(const char* iface, const char* custom_filter,
+                                 struct flow_record* flows, size_t max_flows,
+                                 size_t* nr_flows) {
+  struct tpacket_ring* ring;
+  struct tpacket_ring_config config = TPACKET_RING_CONFIG_DEFAULT;
+  struct tpacket_block block;
+  struct tpacket_packet pkt;
+  struct header_record rec;
+  struct flow_table* table;
+  const struct flow_record* result;
+  int full = 0;
+
+  *nr_flows = 0;
+  table = flow_table_create(max_flows);
+  if (!table) return -4;
+  config.snaplen = HEADER_RECORD_SNAPLEN;
+  tpacket_ring_config_size(&config, 0);
+  ring = tpacket_ring_open(iface, custom_filter, &config);
+  if (!ring) {
+    flow_table_destroy(table);
+    return -1;
+  }
+
+  while (tpacket_ring_next_block(ring, &block, 1000) > 0) {
+    while (tpacket_block_next(&block, &pkt)) {
+      header_record_parse(&rec, pkt.data, pkt.caplen, pkt.len, pkt.ts_ns, 0);
+      if (flow_table_add(table, &rec) < 0) full = 1;
+    }
+    tpacket_ring_release_block(ring, &block);
+  }
+  tpacket_ring_close(ring);
+
+  result = flow_table_flows(table, nr_flows);
+  memcpy(flows, result, *nr_flows * sizeof(*flows));
+  flow_table_destroy(table);
+  return full;
+}
@@ -0,0 +1,49 @@
+#ifndef CUSTOM_TCPDUMP_HEADERS_H
+#define CUSTOM_TCPDUMP_HEADERS_H
+#include <stddef.h>
+
+#include "flow_table.h"
+#include "header_record.h"
+
+// 只保留协议头的抓包：逐包的 header_record，或按 5 元组聚合的流
+
+/**
+ * @brief 只保留协议头的抓包：每个包写成一条定长的 header_record
+ *
+ * 结束条件与 custom_tcpdump_capture 相同。不算载荷哈希时内核每个包只
+ * 向环中复制 HEADER_RECORD_SNAPLEN 字节。
+ *
+ * @param iface 需要进行抓包的网络接口名称
+ * @param custom_filter 用户自定义的过滤表达式
+ * @param flags HEADER_RECORD_HASH 或 0
+ * @param records 存储记录的数组
+ * @param max_records 数组能放下的记录数
+ * @param nr_records 实际写入的记录数
+ * @return 成功时返回0；records 写满后还有包到达返回1，已写入的记录
+ *         仍然有效；失败返回负数错误码
+ */
+int custom_tcpdump_capture_headers(const char* iface,
+                                   const char* custom_filter,
+                                   unsigned int flags,
+                                   struct header_record* records,
+                                   size_t max_records, size_t* nr_records);
+
+/**
+ * @brief 抓包并按 5 元组聚合，输出流记录而不是包
+ *
+ * 流表直接在环上更新，包不复制。1 秒内没有新的包时结束。flows 放不下
+ * 的新流被丢弃，已有的流继续计数。
+ *
+ * @param iface 需要进行抓包的网络接口名称
+ * @param custom_filter 用户自定义的过滤表达式
+ * @param flows 存储流记录的数组，按流第一次出现的顺序写入
+ * @param max_flows 数组能放下的流数
+ * @param nr_flows 实际写入的流数
+ * @return 成功时返回0；有新流因 flows 已满被丢弃返回1，写入的流及其
+ *         计数仍然完整；失败返回负数错误码
+ */
+int custom_tcpdump_capture_flows(const char* iface, const char* custom_filter,
+                                 struct flow_record* flows, size_t max_flows,
+                                 size_t* nr_flows);
+
+#endif
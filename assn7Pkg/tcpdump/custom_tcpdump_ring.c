@@ -0,0 +1,194 @@
+#include "custom_tcpdump_ring.h"
+
+#include <pcap.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// 按调用者的缓冲区确定环的大小时的上限，环只需吸收两次读取之间的突发
+#define RING_BYTES_MAX (64U << 20)
+
+/**
+ * @brief 从环中取包写进 writer，直到写满或 1 秒内没有新的包
+ * @return 被 snaplen 截断的包数
+ */
+static uint64_t ring_capture_loop(struct tpacket_ring* ring,
+                                  struct pcapng_writer* writer) {
+  struct tpacket_block block;
+  struct tpacket_packet pkt;
+  uint64_t truncated = 0;
+  int full = 0;
+
+  while (!full && tpacket_ring_next_block(ring, &block, 1000) > 0) {
+    while (tpacket_block_next(&block, &pkt)) {
+      if (pcapng_writer_append(writer, pkt.data, pkt.caplen, pkt.len,
+                               pkt.ts_ns) < 0) {
+        full = 1;
+        break;
+      }
+      if (pkt.caplen < pkt.len) ++truncated;
+    }
+    tpacket_ring_release_block(ring, &block);
+  }
+  pcapng_writer_finish(writer);
+  return truncated;
+}
+
+int custom_tcpdump_capture_ring(const char* iface, const char* custom_filter,
+                                void* buffer, size_t buffer_size) {
+  return custom_tcpdump_capture_ring_ex(iface, custom_filter, buffer,
+                                        buffer_size, NULL);
+}
+
+/**
+ * @brief 基于 TPACKET_V3 环的抓包
+ *
+ * 结束条件与 custom_tcpdump_capture 相同：缓冲区放不下下一个包，或者
+ * 1 秒内没有新的包。每次处理一整块，块内的包直接从环内存复制到 buffer，
+ * buffer 的格式与 custom_tcpdump_capture 相同。时间戳是环中 ns 精度的
+ * 内核软件时间戳。
+ *
+ * @param iface 抓包使用的网络接口（如 "eth0", "lo"）
+ * @param custom_filter 用户传入的过滤规则（如 "tcp port 80"）
+ * @param buffer 用户传入的缓冲区，用于保存抓到的数据
+ * @param buffer_size 缓冲区的最大大小（以字节为单位）
+ * @param result 返回抓包统计，可以为 NULL
+ * @return 抓包成功返回 0，失败返回负数
+ */
+int custom_tcpdump_capture_ring_ex(const char* iface, const char* custom_filter,
+                                   void* buffer, size_t buffer_size,
+                                   struct custom_tcpdump_result* result) {
+  struct tpacket_ring* ring;
+  struct tpacket_ring_config config = TPACKET_RING_CONFIG_DEFAULT;
+  struct pcapng_writer writer;
+  uint64_t truncated, seen, passed = 0, drops = 0;
+
+  if (pcapng_writer_init(&writer, buffer, buffer_size, DLT_EN10MB,
+                         config.snaplen) < 0) {
+    fprintf(stderr, "buffer too small for capture headers\n");
+    return -4;
+  }
+  // 环里放不下比 buffer 更多有用的数据
+  tpacket_ring_config_size(
+      &config, buffer_size < RING_BYTES_MAX ? buffer_size : RING_BYTES_MAX);
+  ring = tpacket_ring_open(iface, custom_filter, &config);
+  if (!ring) return -1;
+  seen = custom_tcpdump_iface_packets(iface, 0);
+
+  truncated = ring_capture_loop(ring, &writer);
+  if (result) {
+    tpacket_ring_stats(ring, &passed, &drops);
+    custom_tcpdump_finish_result(result, &writer, truncated, passed, drops,
+                  custom_tcpdump_iface_packets(iface, 0) - seen);
+    result->ts_resolution_ns = 1;
+  }
+  tpacket_ring_close(ring);
+  return 0;
+}
+
+static uint64_t monotonic_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000ULL + ts.tv_nsec / 1000000;
+}
+
+/**
+ * @brief 把环中的包逐个交给 sink，直到 1 秒内没有新的包或达到 limits
+ *
+ * custom_tcpdump_capture_stream 与 custom_tcpdump_capture_shared 共用，
+ * 二者只是包的去处不同。
+ *
+ * @param limits 包数与时长上限，不能为 NULL，0 表示不限
+ */
+void custom_tcpdump_drain_ring(struct tpacket_ring* ring,
+                               const struct custom_tcpdump_limits* limits,
+                               void (*sink)(void* ctx,
+                                            const struct tpacket_packet*),
+                               void* ctx) {
+  struct tpacket_block block;
+  struct tpacket_packet pkt;
+  uint64_t deadline, packets = 0;
+  int done = 0;
+
+  deadline = limits->duration_ms ? monotonic_ms() + limits->duration_ms : 0;
+  while (!done) {
+    int timeout = 1000;
+    if (deadline) {
+      uint64_t now = monotonic_ms();
+      if (now >= deadline) break;
+      if (deadline - now < 1000) timeout = (int)(deadline - now);
+    }
+    int n = tpacket_ring_next_block(ring, &block, timeout);
+    if (n < 0 || (n == 0 && timeout == 1000)) break;
+    if (n == 0) continue;
+    while (tpacket_block_next(&block, &pkt)) {
+      sink(ctx, &pkt);
+      if (limits->max_packets && ++packets == limits->max_packets) {
+        done = 1;
+        break;
+      }
+    }
+    tpacket_ring_release_block(ring, &block);
+  }
+}
+
+struct custom_tcpdump_session {
+  struct tpacket_ring* ring;
+  unsigned int snaplen;
+  unsigned int retire_blk_tov;
+};
+
+/**
+ * @brief 打开一个可重复使用的抓包会话
+ *
+ * 环与 socket 只在这里创建一次，空闲时挂着丢弃所有包的过滤器，不占用环。
+ */
+struct custom_tcpdump_session* custom_tcpdump_session_open(const char* iface) {
+  struct tpacket_ring_config config = TPACKET_RING_CONFIG_DEFAULT;
+  struct custom_tcpdump_session* session = calloc(1, sizeof(*session));
+
+  if (!session) return NULL;
+  session->snaplen = config.snaplen;
+  session->retire_blk_tov = config.retire_blk_tov;
+  session->ring = tpacket_ring_open(iface, NULL, &config);
+  if (!session->ring || tpacket_ring_pause(session->ring) < 0) {
+    custom_tcpdump_session_close(session);
+    return NULL;
+  }
+  // 打开与暂停之间可能进来的包
+  tpacket_ring_flush(session->ring, 2 * session->retire_blk_tov);
+  return session;
+}
+
+/**
+ * @brief 在会话上抓一次包
+ *
+ * 换上（缓存的）过滤器后与 custom_tcpdump_capture_ring 相同；结束后换回
+ * 丢弃过滤器并清空环，下一次抓包不会看到这一次剩下的包。
+ */
+int custom_tcpdump_session_capture(struct custom_tcpdump_session* session,
+                                   const char* custom_filter, void* buffer,
+                                   size_t buffer_size) {
+  struct pcapng_writer writer;
+  int ret;
+
+  if (pcapng_writer_init(&writer, buffer, buffer_size, DLT_EN10MB,
+                         session->snaplen) < 0) {
+    fprintf(stderr, "buffer too small for capture headers\n");
+    return -4;
+  }
+  ret = tpacket_ring_set_filter(session->ring, custom_filter);
+  if (ret < 0) return ret;
+
+  ring_capture_loop(session->ring, &writer);
+
+  tpacket_ring_pause(session->ring);
+  tpacket_ring_flush(session->ring, 2 * session->retire_blk_tov);
+  return 0;
+}
+
+void custom_tcpdump_session_close(struct custom_tcpdump_session* session) {
+  if (!session) return;
+  tpacket_ring_close(session->ring);
+  free(session);
+}
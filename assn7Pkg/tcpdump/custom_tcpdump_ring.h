@@ -0,0 +1,69 @@
+#ifndef CUSTOM_TCPDUMP_RING_H
+#define CUSTOM_TCPDUMP_RING_H
+#include <stddef.h>
+
+#include "custom_tcpdump.h"
+#include "tpacket_ring.h"
+
+// 基于 TPACKET_V3 环的抓包，以及在同一个环上反复抓包的会话
+
+/**
+ * @brief 与 custom_tcpdump_capture 相同，但直接从 TPACKET_V3 mmap 环中
+ *        取包，每个包只复制一次（从环到 buffer）
+ * @param iface 需要进行抓包的网络接口名称
+ * @param custom_filter 用户自定义的过滤表达式
+ * @param buffer 存储抓取到的数据缓冲区
+ * @param buffer_size 存储抓包数据的缓冲区大小
+ * @return 成功时返回0，失败返回非0错误码
+ */
+int custom_tcpdump_capture_ring(const char* iface, const char* custom_filter,
+                                void* buffer, size_t buffer_size);
+
+/**
+ * @brief 与 custom_tcpdump_capture_ring 相同，并返回抓包统计；时间戳总是
+ *        ns 精度
+ */
+int custom_tcpdump_capture_ring_ex(const char* iface, const char* custom_filter,
+                                   void* buffer, size_t buffer_size,
+                                   struct custom_tcpdump_result* result);
+
+struct custom_tcpdump_session;
+
+/**
+ * @brief 打开一个可重复使用的抓包会话，socket 与环在会话内一直保持打开
+ * @param iface 需要进行抓包的网络接口名称
+ * @return 成功返回会话，失败返回 NULL
+ */
+struct custom_tcpdump_session* custom_tcpdump_session_open(const char* iface);
+
+/**
+ * @brief 在会话上抓一次包，语义与 custom_tcpdump_capture 相同
+ *
+ * 不重新打开网卡；过滤表达式的编译结果按字符串缓存，重复使用同一个表达式
+ * 时只需一次 SO_ATTACH_FILTER 原子替换。同一会话不能并发抓包。
+ *
+ * @param custom_filter 用户自定义的过滤表达式
+ * @param buffer 存储抓取到的数据缓冲区
+ * @param buffer_size 存储抓包数据的缓冲区大小
+ * @return 成功时返回0，失败返回非0错误码
+ */
+int custom_tcpdump_session_capture(struct custom_tcpdump_session* session,
+                                   const char* custom_filter, void* buffer,
+                                   size_t buffer_size);
+
+void custom_tcpdump_session_close(struct custom_tcpdump_session* session);
+
+/**
+ * @brief 把环中的包逐个交给 sink，直到 1 秒内没有新的包或达到 limits
+ *
+ * 供 custom_tcpdump_capture_stream 与 custom_tcpdump_capture_shared 使用。
+ *
+ * @param limits 包数与时长上限，不能为 NULL，0 表示不限
+ */
+void custom_tcpdump_drain_ring(struct tpacket_ring* ring,
+                               const struct custom_tcpdump_limits* limits,
+                               void (*sink)(void* ctx,
+                                            const struct tpacket_packet*),
+                               void* ctx);
+
+#endif
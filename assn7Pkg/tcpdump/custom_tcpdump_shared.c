@@ -0,0 +1,54 @@
+#include "custom_tcpdump_shared.h"
+
+#include "custom_tcpdump_ring.h"
+
+static void shared_sink(void* ctx, const struct tpacket_packet* pkt) {
+  shared_ring_publish(ctx, pkt->data, pkt->caplen, pkt->len, pkt->ts_ns);
+}
+
+/**
+ * @brief 抓包并发布到共享内存环
+ *
+ * 内核里只有一个抓包 socket，各分析进程用 shared_ring_attach 随时挂上或
+ * 摘下。内核只抓槽位放得下的部分。结束条件同 custom_tcpdump_capture_stream，
+ * 结束后删除共享内存，已挂上的分析进程读到环结束。
+ *
+ * @param iface 抓包使用的网络接口（如 "eth0", "lo"）
+ * @param custom_filter 用户传入的过滤规则（如 "tcp port 80"）
+ * @param name 共享内存名称，形如 "/capture0"
+ * @param config 环参数，NULL 表示使用 SHARED_RING_CONFIG_DEFAULT
+ * @param limits 包数与时长上限，NULL 表示不限
+ * @param published 返回发布的包数，可以为 NULL
+ * @return 抓包成功返回 0，创建共享内存或打开抓包环失败返回 -1
+ */
+int custom_tcpdump_capture_shared(const char* iface, const char* custom_filter,
+                                  const char* name,
+                                  const struct shared_ring_config* config,
+                                  const struct custom_tcpdump_limits* limits,
+                                  uint64_t* published) {
+  struct tpacket_ring_config ring_config = TPACKET_RING_CONFIG_DEFAULT;
+  struct custom_tcpdump_limits none = {0, 0};
+  struct tpacket_ring* ring;
+  struct shared_ring* shared;
+  uint64_t waits;
+  int consumers;
+
+  if (!limits) limits = &none;
+  shared = shared_ring_create(name, config);
+  if (!shared) return -1;
+  // 槽位放不下的部分不必从内核抓上来
+  ring_config.snaplen = shared_ring_snaplen(shared);
+  tpacket_ring_config_size(&ring_config, 0);
+  ring = tpacket_ring_open(iface, custom_filter, &ring_config);
+  if (!ring) {
+    shared_ring_destroy(shared);
+    return -1;
+  }
+
+  custom_tcpdump_drain_ring(ring, limits, shared_sink, shared);
+  tpacket_ring_close(ring);
+
+  if (published) shared_ring_stats(shared, published, &waits, &consumers);
+  shared_ring_destroy(shared);
+  return 0;
+}
@@ -0,0 +1,31 @@
+#ifndef CUSTOM_TCPDUMP_SHARED_H
+#define CUSTOM_TCPDUMP_SHARED_H
+#include <stdint.h>
+
+#include "custom_tcpdump.h"
+#include "shared_ring.h"
+
+// 发布到共享内存环的抓包，供多个分析进程同时读取
+
+/**
+ * @brief 把抓到的包发布到共享内存环中，供多个分析进程同时读取
+ *
+ * 内核里只有一个抓包 socket；分析进程用 shared_ring_attach(name, ...) 在
+ * 抓包期间随时挂上或摘下，各自按挂上时选择的策略处理背压。1 秒内没有
+ * 新的包，或达到 limits 中的上限时结束，结束后共享内存被删除。
+ *
+ * @param iface 需要进行抓包的网络接口名称
+ * @param custom_filter 用户自定义的过滤表达式
+ * @param name 共享内存名称，形如 "/capture0"
+ * @param config 环参数，NULL 表示使用 SHARED_RING_CONFIG_DEFAULT
+ * @param limits 包数与时长上限，NULL 表示不限
+ * @param published 返回发布的包数，可以为 NULL
+ * @return 成功时返回0，失败返回非0错误码
+ */
+int custom_tcpdump_capture_shared(const char* iface, const char* custom_filter,
+                                  const char* name,
+                                  const struct shared_ring_config* config,
+                                  const struct custom_tcpdump_limits* limits,
+                                  uint64_t* published);
+
+#endif
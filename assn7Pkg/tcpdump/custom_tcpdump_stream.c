@@ -0,0 +1,46 @@
+#include "custom_tcpdump_stream.h"
+
+#include "custom_tcpdump_ring.h"
+
+static void stream_sink(void* ctx, const struct tpacket_packet* pkt) {
+  pcapng_stream_append(ctx, pkt->data, pkt->caplen, pkt->len, pkt->ts_ns);
+}
+
+/**
+ * @brief 抓包并持续写盘
+ *
+ * 抓包线程只把包从环复制进 pcapng_stream 的缓冲区，写盘由它的后台线程
+ * 完成。结束条件：1 秒内没有新的包，或达到 limits。
+ *
+ * @param iface 抓包使用的网络接口（如 "eth0", "lo"）
+ * @param custom_filter 用户传入的过滤规则（如 "tcp port 80"）
+ * @param config 输出文件与缓冲参数
+ * @param limits 包数与时长上限，NULL 表示不限
+ * @param stats 返回计数，可以为 NULL
+ * @return 抓包成功返回 0，打开失败返回 -1，写盘出错返回 -5
+ */
+int custom_tcpdump_capture_stream(const char* iface, const char* custom_filter,
+                                  const struct pcapng_stream_config* config,
+                                  const struct custom_tcpdump_limits* limits,
+                                  struct pcapng_stream_stats* stats) {
+  struct tpacket_ring_config ring_config = TPACKET_RING_CONFIG_DEFAULT;
+  struct custom_tcpdump_limits none = {0, 0};
+  struct tpacket_ring* ring;
+  struct pcapng_stream* stream;
+
+  if (!limits) limits = &none;
+  ring_config.snaplen = config->snaplen;
+  tpacket_ring_config_size(&ring_config, 0);
+  ring = tpacket_ring_open(iface, custom_filter, &ring_config);
+  if (!ring) return -1;
+  stream = pcapng_stream_open(config);
+  if (!stream) {
+    tpacket_ring_close(ring);
+    return -1;
+  }
+
+  custom_tcpdump_drain_ring(ring, limits, stream_sink, stream);
+  tpacket_ring_close(ring);
+
+  return pcapng_stream_close(stream, stats) == 0 ? 0 : -5;
+}
@@ -0,0 +1,26 @@
+#ifndef CUSTOM_TCPDUMP_STREAM_H
+#define CUSTOM_TCPDUMP_STREAM_H
+#include "custom_tcpdump.h"
+#include "pcapng_stream.h"
+
+// 持续写盘的抓包，不受缓冲区大小限制
+
+/**
+ * @brief 不受缓冲区大小限制的抓包：持续写进按大小/时间切分的 pcapng 文件
+ *
+ * 写盘在后台线程中进行，存储跟不上时丢弃的包计入 stats->drops。1 秒内
+ * 没有新的包，或达到 limits 中的上限时结束。
+ *
+ * @param iface 需要进行抓包的网络接口名称
+ * @param custom_filter 用户自定义的过滤表达式
+ * @param config 输出文件与缓冲参数，见 pcapng_stream.h
+ * @param limits 包数与时长上限，NULL 表示不限
+ * @param stats 返回写出的包数、丢弃数与文件数，可以为 NULL
+ * @return 成功时返回0，失败返回非0错误码
+ */
+int custom_tcpdump_capture_stream(const char* iface, const char* custom_filter,
+                                  const struct pcapng_stream_config* config,
+                                  const struct custom_tcpdump_limits* limits,
+                                  struct pcapng_stream_stats* stats);
+
+#endif
@@ -0,0 +1,62 @@
+#include "custom_tcpdump_xdp.h"
+
+#include <pcap.h>
+#include <stdio.h>
+
+#include "xdp_capture.h"
+
+int custom_tcpdump_capture_xdp(const char* iface, const char* custom_filter,
+                               void* buffer, size_t buffer_size) {
+  return custom_tcpdump_capture_xdp_ex(iface, custom_filter, buffer,
+                                       buffer_size, NULL);
+}
+
+/**
+ * @brief 基于 XDP 的抓包
+ *
+ * 结束条件与缓冲区格式都与 custom_tcpdump_capture_ring 相同，包从 BPF
+ * ring buffer 直接复制到 buffer。时间戳由 XDP 程序用 bpf_ktime_get_ns
+ * 取得，并换算到 CLOCK_REALTIME。
+ *
+ * @param iface 抓包使用的网络接口（如 "eth0", "lo"）
+ * @param custom_filter 用户传入的过滤规则（如 "tcp port 80"）
+ * @param buffer 用户传入的缓冲区，用于保存抓到的数据
+ * @param buffer_size 缓冲区的最大大小（以字节为单位）
+ * @param result 返回抓包统计，可以为 NULL
+ * @return 抓包成功返回 0，失败返回负数
+ */
+int custom_tcpdump_capture_xdp_ex(const char* iface, const char* custom_filter,
+                                  void* buffer, size_t buffer_size,
+                                  struct custom_tcpdump_result* result) {
+  struct xdp_capture_config config = XDP_CAPTURE_CONFIG_DEFAULT;
+  struct xdp_capture* capture;
+  struct pcapng_writer writer;
+  struct tpacket_packet pkt;
+  uint64_t truncated = 0, seen, passed = 0, drops = 0;
+
+  if (pcapng_writer_init(&writer, buffer, buffer_size, DLT_EN10MB,
+                         config.snaplen) < 0) {
+    fprintf(stderr, "buffer too small for capture headers\n");
+    return -4;
+  }
+  capture = xdp_capture_open(iface, custom_filter, &config);
+  if (!capture) return -1;
+  seen = custom_tcpdump_iface_packets(iface, 1);
+
+  while (xdp_capture_next(capture, &pkt, 1000) > 0) {
+    if (pcapng_writer_append(&writer, pkt.data, pkt.caplen, pkt.len,
+                             pkt.ts_ns) < 0)
+      break;
+    if (pkt.caplen < pkt.len) ++truncated;
+  }
+
+  pcapng_writer_finish(&writer);
+  if (result) {
+    xdp_capture_stats(capture, &passed, &drops);
+    custom_tcpdump_finish_result(result, &writer, truncated, passed, drops,
+                  custom_tcpdump_iface_packets(iface, 1) - seen);
+    result->ts_resolution_ns = 1;
+  }
+  xdp_capture_close(capture);
+  return 0;
+}
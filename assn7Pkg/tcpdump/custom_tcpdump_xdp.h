@@ -0,0 +1,31 @@
+#ifndef CUSTOM_TCPDUMP_XDP_H
+#define CUSTOM_TCPDUMP_XDP_H
+#include <stddef.h>
+
+#include "custom_tcpdump.h"
+
+// 基于 XDP 的抓包，见 xdp_capture.h
+
+/**
+ * @brief 与 custom_tcpdump_capture 相同，但使用 XDP 后端（见 xdp_capture.h）
+ *
+ * 过滤与截断在 XDP 程序中完成，只能抓到接口收到的包。
+ *
+ * @param iface 需要进行抓包的网络接口名称
+ * @param custom_filter 用户自定义的过滤表达式
+ * @param buffer 存储抓取到的数据缓冲区
+ * @param buffer_size 存储抓包数据的缓冲区大小
+ * @return 成功时返回0，失败返回非0错误码
+ */
+int custom_tcpdump_capture_xdp(const char* iface, const char* custom_filter,
+                               void* buffer, size_t buffer_size);
+
+/**
+ * @brief 与 custom_tcpdump_capture_xdp 相同，并返回抓包统计；时间戳总是
+ *        ns 精度，filtered 只按接收方向估计
+ */
+int custom_tcpdump_capture_xdp_ex(const char* iface, const char* custom_filter,
+                                  void* buffer, size_t buffer_size,
+                                  struct custom_tcpdump_result* result);
+
+#endif
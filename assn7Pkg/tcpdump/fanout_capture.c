@@ -0,0 +1,264 @@
+#define _GNU_SOURCE
+#include "fanout_capture.h"
+
+#include <linux/if_packet.h>
+#include <pcap.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+struct fanout_worker {
+  struct fanout_capture* fc;
+  struct tpacket_ring* ring;
+  pthread_t thread;
+  int cpu;
+  struct pcapng_writer writer;
+  uint64_t kernel_drops;
+
+  // 归并用：该段的索引与当前位置
+  const struct pcapng_index_entry* index;
+  uint32_t count;
+  uint32_t cursor;
+};
+
+struct fanout_capture {
+  int nr_workers;
+  int idle_ms;
+  uint32_t snaplen;
+  int stop;  // 只用 __atomic 访问，不保护其他数据，relaxed 即可
+  struct fanout_worker workers[FANOUT_CAPTURE_MAX_WORKERS];
+
+  int merging;
+  int heap_len;
+  int heap[FANOUT_CAPTURE_MAX_WORKERS];  // 按当前包时间戳排序的最小堆
+};
+
+/**
+ * @brief worker 主循环：整块读取，直接追加进自己的段
+ */
+static void* worker_main(void* arg) {
+  struct fanout_worker* w = arg;
+  struct tpacket_block block;
+  struct tpacket_packet pkt;
+  uint64_t packets;
+  int idle = 0, full = 0;
+
+  if (w->cpu >= 0) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(w->cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  }
+
+  // 每 100ms 检查一次 stop
+  while (!full && !__atomic_load_n(&w->fc->stop, __ATOMIC_RELAXED) &&
+         idle < w->fc->idle_ms) {
+    int n = tpacket_ring_next_block(w->ring, &block, 100);
+    if (n < 0) break;
+    if (n == 0) {
+      idle += 100;
+      continue;
+    }
+    idle = 0;
+    while (tpacket_block_next(&block, &pkt)) {
+      if (pcapng_writer_append(&w->writer, pkt.data, pkt.caplen, pkt.len,
+                               pkt.ts_ns) < 0) {
+        full = 1;
+        break;
+      }
+    }
+    tpacket_ring_release_block(w->ring, &block);
+  }
+
+  tpacket_ring_stats(w->ring, &packets, &w->kernel_drops);
+  pcapng_writer_finish(&w->writer);
+  return NULL;
+}
+
+// 没有指定时，worker i 绑定到进程可用 CPU 中的第 i 个（不够时轮转）
+static int pick_cpu(const cpu_set_t* allowed, int i) {
+  int n = CPU_COUNT(allowed);
+  if (n == 0) return -1;
+  for (int cpu = 0, seen = 0; cpu < CPU_SETSIZE; ++cpu) {
+    if (!CPU_ISSET(cpu, allowed)) continue;
+    if (seen++ == i % n) return cpu;
+  }
+  return -1;
+}
+
+struct fanout_capture* fanout_capture_start(
+    const char* iface, const char* filter,
+    const struct fanout_capture_config* config, void* buffer,
+    size_t buffer_size) {
+  struct fanout_capture_config def = {4, PACKET_FANOUT_HASH, NULL, 1000,
+                                      TPACKET_RING_CONFIG_DEFAULT};
+  struct tpacket_ring_config ring_config;
+  struct fanout_capture* fc;
+  cpu_set_t allowed;
+  size_t seg;
+
+  if (!config) {
+    def.ring.block_nr = 16;
+    config = &def;
+  }
+  if (config->workers < 1 || config->workers > FANOUT_CAPTURE_MAX_WORKERS)
+    return NULL;
+
+  fc = calloc(1, sizeof(*fc));
+  if (!fc) return NULL;
+  fc->idle_ms = config->idle_ms;
+  fc->snaplen = config->ring.snaplen;
+  sched_getaffinity(0, sizeof(allowed), &allowed);
+
+  // 组号由内核为第一个 socket 分配，保证不会误入别的抓包的组；其余 socket
+  // 用读回的组号加入
+  ring_config = config->ring;
+  ring_config.fanout_group = 0;
+  ring_config.fanout_type = config->fanout_type | PACKET_FANOUT_FLAG_UNIQUEID;
+
+  seg = buffer_size / config->workers & ~(size_t)(PCAPNG_BUF_ALIGN - 1);
+  for (int i = 0; i < config->workers; ++i) {
+    struct fanout_worker* w = &fc->workers[i];
+    w->fc = fc;
+    w->cpu = config->cpus ? config->cpus[i] : pick_cpu(&allowed, i);
+    if (pcapng_writer_init(&w->writer, (uint8_t*)buffer + i * seg, seg,
+                           DLT_EN10MB, ring_config.snaplen) < 0) {
+      fprintf(stderr, "buffer too small for %d segments\n", config->workers);
+      goto fail;
+    }
+    w->ring = tpacket_ring_open(iface, filter, &ring_config);
+    if (!w->ring) goto fail;
+    fc->nr_workers++;
+    if (i == 0) {
+      int arg;
+      socklen_t len = sizeof(arg);
+      if (getsockopt(tpacket_ring_fd(w->ring), SOL_PACKET, PACKET_FANOUT, &arg,
+                     &len) < 0) {
+        perror("PACKET_FANOUT");
+        goto fail;
+      }
+      ring_config.fanout_group = arg & 0xffff;
+      ring_config.fanout_type = config->fanout_type;
+    }
+  }
+
+  // 启动失败的 worker 的 socket 仍会分到流量却没人读，只能整体放弃
+  for (int i = 0; i < fc->nr_workers; ++i) {
+    int err = pthread_create(&fc->workers[i].thread, NULL, worker_main,
+                             &fc->workers[i]);
+    if (err) {
+      fprintf(stderr, "pthread_create: %s\n", strerror(err));
+      __atomic_store_n(&fc->stop, 1, __ATOMIC_RELAXED);
+      for (int j = 0; j < i; ++j) pthread_join(fc->workers[j].thread, NULL);
+      goto fail;
+    }
+  }
+  return fc;
+
+fail:
+  for (int i = 0; i < fc->nr_workers; ++i)
+    tpacket_ring_close(fc->workers[i].ring);
+  free(fc);
+  return NULL;
+}
+
+void fanout_capture_stop(struct fanout_capture* fc) {
+  __atomic_store_n(&fc->stop, 1, __ATOMIC_RELAXED);
+}
+
+uint64_t fanout_capture_wait(struct fanout_capture* fc) {
+  uint64_t total = 0;
+
+  for (int i = 0; i < fc->nr_workers; ++i) {
+    struct fanout_worker* w = &fc->workers[i];
+    if (!w->ring) continue;
+    pthread_join(w->thread, NULL);
+    tpacket_ring_close(w->ring);
+    w->ring = NULL;
+    w->index = pcapng_buf_index(w->writer.buf, &w->count);
+    total += w->count;
+  }
+  return total;
+}
+
+void fanout_capture_worker_stats(const struct fanout_capture* fc, int i,
+                                 uint64_t* captured, uint64_t* kernel_drops) {
+  *captured = fc->workers[i].count;
+  *kernel_drops = fc->workers[i].kernel_drops;
+}
+
+static uint64_t head_ts(const struct fanout_capture* fc, int i) {
+  const struct fanout_worker* w = &fc->workers[i];
+  return w->index[w->cursor].ts_ns;
+}
+
+static void sift_down(struct fanout_capture* fc, int pos) {
+  for (;;) {
+    int min = pos, l = 2 * pos + 1, r = l + 1;
+    if (l < fc->heap_len &&
+        head_ts(fc, fc->heap[l]) < head_ts(fc, fc->heap[min]))
+      min = l;
+    if (r < fc->heap_len &&
+        head_ts(fc, fc->heap[r]) < head_ts(fc, fc->heap[min]))
+      min = r;
+    if (min == pos) return;
+    int t = fc->heap[pos];
+    fc->heap[pos] = fc->heap[min];
+    fc->heap[min] = t;
+    pos = min;
+  }
+}
+
+static void merge_begin(struct fanout_capture* fc) {
+  fc->heap_len = 0;
+  for (int i = 0; i < fc->nr_workers; ++i) {
+    fc->workers[i].cursor = 0;
+    if (fc->workers[i].index && fc->workers[i].count)
+      fc->heap[fc->heap_len++] = i;
+  }
+  for (int i = fc->heap_len / 2 - 1; i >= 0; --i) sift_down(fc, i);
+  fc->merging = 1;
+}
+
+int fanout_capture_merge_next(struct fanout_capture* fc,
+                              const struct pcapng_index_entry** entry,
+                              const uint8_t** data) {
+  struct fanout_worker* w;
+
+  if (!fc->merging) merge_begin(fc);
+  if (!fc->heap_len) return 0;
+
+  w = &fc->workers[fc->heap[0]];
+  *entry = &w->index[w->cursor];
+  *data = w->writer.buf + (*entry)->offset;
+  if (++w->cursor == w->count) fc->heap[0] = fc->heap[--fc->heap_len];
+  sift_down(fc, 0);
+  return 1;
+}
+
+size_t fanout_capture_merge(struct fanout_capture* fc, void* out,
+                            size_t out_size) {
+  const struct pcapng_index_entry* e;
+  const uint8_t* data;
+  struct pcapng_writer writer;
+
+  if (pcapng_writer_init(&writer, out, out_size, DLT_EN10MB, fc->snaplen) < 0)
+    return 0;
+  merge_begin(fc);
+  while (fanout_capture_merge_next(fc, &e, &data))
+    if (pcapng_writer_append(&writer, data, e->caplen, e->len, e->ts_ns) < 0)
+      break;
+  fc->merging = 0;
+  return pcapng_writer_finish(&writer);
+}
+
+void fanout_capture_destroy(struct fanout_capture* fc) {
+  if (!fc) return;
+  fanout_capture_stop(fc);
+  fanout_capture_wait(fc);
+  free(fc);
+}
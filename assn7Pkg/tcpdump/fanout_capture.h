@@ -0,0 +1,82 @@
+#ifndef FANOUT_CAPTURE_H
+#define FANOUT_CAPTURE_H
+#include <stddef.h>
+#include <stdint.h>
+
+#include "pcapng_buf.h"
+#include "tpacket_ring.h"
+
+// 多队列并行抓包
+//
+// 打开 N 个加入同一个 PACKET_FANOUT 组的 TPACKET_V3 环，内核按 fanout_type
+// 把包分给各个 socket。每个 socket 由一个绑定到固定 CPU 的 worker 线程
+// 读取，写进调用者缓冲区中属于自己的一段：缓冲区被平均切成 N 段，每段都是
+// 一个独立的带索引 pcapng（见 pcapng_buf.h），worker 之间没有任何共享写。
+// 各段内部按时间有序，需要全局顺序时再按时间戳做 N 路归并。
+
+#define FANOUT_CAPTURE_MAX_WORKERS 64
+
+struct fanout_capture_config {
+  int workers;               // socket 与 worker 数
+  unsigned int fanout_type;  // PACKET_FANOUT_HASH / CPU / ROLLOVER ...
+  const int* cpus;           // worker i 绑定到 cpus[i]，NULL 表示依次取可用 CPU
+  int idle_ms;               // worker 连续这么久没有收到包就结束
+  struct tpacket_ring_config ring;  // 每个 worker 的环
+};
+
+struct fanout_capture;
+
+/**
+ * @brief 打开 fanout 组并启动 worker
+ * @param iface 网络接口名称
+ * @param filter pcap 过滤表达式，NULL 表示不过滤
+ * @param config 参数，NULL 表示 4 个 worker、按流哈希、空闲 1 秒结束
+ * @param buffer 所有 worker 共用的输出缓冲区，按 PCAPNG_BUF_ALIGN 对齐
+ * @param buffer_size 缓冲区大小
+ * @return 成功返回句柄，失败返回 NULL
+ */
+struct fanout_capture* fanout_capture_start(
+    const char* iface, const char* filter,
+    const struct fanout_capture_config* config, void* buffer,
+    size_t buffer_size);
+
+/**
+ * @brief 通知所有 worker 尽快结束，不等待
+ */
+void fanout_capture_stop(struct fanout_capture* fc);
+
+/**
+ * @brief 等待所有 worker 结束（段写满、空闲超时或被 stop），补全各段索引
+ * @return 所有 worker 一共抓到的包数
+ */
+uint64_t fanout_capture_wait(struct fanout_capture* fc);
+
+/**
+ * @brief 读取 worker i 的计数，在 fanout_capture_wait 之后调用
+ * @param captured 写进该段的包数
+ * @param kernel_drops 该 socket 的环已满而被内核丢弃的包数
+ */
+void fanout_capture_worker_stats(const struct fanout_capture* fc, int i,
+                                 uint64_t* captured, uint64_t* kernel_drops);
+
+/**
+ * @brief 按时间戳顺序取出下一个包（零拷贝，指向缓冲区内部）
+ *
+ * 第一次调用时开始 N 路归并，之后每次 O(log N)。
+ * @return 有包返回 1，全部取完返回 0
+ */
+int fanout_capture_merge_next(struct fanout_capture* fc,
+                              const struct pcapng_index_entry** entry,
+                              const uint8_t** data);
+
+/**
+ * @brief 把所有段按时间戳归并成一个带索引的 pcapng
+ * @param out 输出缓冲区，按 PCAPNG_BUF_ALIGN 对齐，不能与抓包缓冲区重叠
+ * @return 写入的字节数，out 放不下全部包时只写入时间上靠前的部分
+ */
+size_t fanout_capture_merge(struct fanout_capture* fc, void* out,
+                            size_t out_size);
+
+void fanout_capture_destroy(struct fanout_capture* fc);
+
+#endif
@@ -0,0 +1,219 @@
+#include "filter_cache.h"
+
+#include <linux/if_packet.h>
+#include <pcap.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FILTER_CACHE_BUCKETS 64
+
+struct filter_entry {
+  struct filter_entry* next;  // 同一个桶中的下一个
+  struct filter_entry* newer;  // LRU 链表，按最近一次使用排序
+  struct filter_entry* older;
+  unsigned int refs;  // 已取出还没归还的次数，非 0 时不淘汰
+  unsigned int snaplen;
+  int loopback;
+  struct sock_fprog prog;
+  char filter[];
+};
+
+struct filter_cache {
+  pthread_mutex_t lock;
+  unsigned int nr_entries;
+  unsigned int max_entries;
+  struct filter_entry* newest;
+  struct filter_entry* oldest;
+  struct filter_entry* buckets[FILTER_CACHE_BUCKETS];
+};
+
+static struct filter_cache* default_cache;
+static pthread_once_t default_once = PTHREAD_ONCE_INIT;
+
+static void default_init(void) {
+  default_cache = filter_cache_create(FILTER_CACHE_DEFAULT_MAX);
+}
+
+struct filter_cache* filter_cache_default(void) {
+  pthread_once(&default_once, default_init);
+  return default_cache;
+}
+
+struct filter_cache* filter_cache_create(unsigned int max_entries) {
+  struct filter_cache* cache = calloc(1, sizeof(*cache));
+  if (cache) {
+    pthread_mutex_init(&cache->lock, NULL);
+    cache->max_entries = max_entries;
+  }
+  return cache;
+}
+
+// FNV-1a
+static unsigned int hash(const char* s, unsigned int snaplen, int loopback) {
+  uint32_t h = 2166136261U ^ snaplen ^ (loopback ? 0x9e3779b9U : 0);
+  for (; *s; ++s) h = (h ^ (unsigned char)*s) * 16777619U;
+  return h % FILTER_CACHE_BUCKETS;
+}
+
+static void lru_unlink(struct filter_cache* cache, struct filter_entry* e) {
+  if (e->newer)
+    e->newer->older = e->older;
+  else
+    cache->newest = e->older;
+  if (e->older)
+    e->older->newer = e->newer;
+  else
+    cache->oldest = e->newer;
+}
+
+static void lru_push(struct filter_cache* cache, struct filter_entry* e) {
+  e->newer = NULL;
+  e->older = cache->newest;
+  if (cache->newest)
+    cache->newest->newer = e;
+  else
+    cache->oldest = e;
+  cache->newest = e;
+}
+
+// 从最久未用的一端淘汰没有被取出的条目，直到不超过上限
+static void evict(struct filter_cache* cache) {
+  struct filter_entry* e = cache->oldest;
+
+  while (cache->max_entries && cache->nr_entries > cache->max_entries && e) {
+    struct filter_entry* newer = e->newer;
+    if (!e->refs) {
+      struct filter_entry** pp = &cache->buckets[hash(e->filter, e->snaplen,
+                                                      e->loopback)];
+      while (*pp != e) pp = &(*pp)->next;
+      *pp = e->next;
+      lru_unlink(cache, e);
+      cache->nr_entries--;
+      free(e);
+    }
+    e = newer;
+  }
+}
+
+/**
+ * @brief 用 libpcap 把过滤表达式编译成经典 BPF
+ *
+ * 只借用 pcap 的编译器（pcap_open_dead 不打开任何设备）。lo 上每个包会以
+ * PACKET_OUTGOING 和 PACKET_HOST 各出现一次，与 libpcap 一样在程序最前面
+ * 丢掉外发的那一份。
+ */
+static struct filter_entry* compile(const char* filter, unsigned int snaplen,
+                                    int loopback) {
+  struct sock_filter prefix[] = {
+      {BPF_LD | BPF_B | BPF_ABS, 0, 0, SKF_AD_OFF + SKF_AD_PKTTYPE},
+      {BPF_JMP | BPF_JEQ | BPF_K, 0, 1, PACKET_OUTGOING},
+      {BPF_RET | BPF_K, 0, 0, 0},
+  };
+  struct sock_filter accept_all = {BPF_RET | BPF_K, 0, 0, snaplen};
+  struct bpf_program fp = {1, (struct bpf_insn*)&accept_all};
+  size_t prefix_len = loopback ? sizeof(prefix) / sizeof(prefix[0]) : 0;
+  struct filter_entry* e;
+  pcap_t* dead = NULL;
+
+  if (*filter) {
+    // 以太网与 lo 的链路层类型都是 DLT_EN10MB
+    dead = pcap_open_dead(DLT_EN10MB, snaplen);
+    if (!dead ||
+        pcap_compile(dead, &fp, filter, 1, PCAP_NETMASK_UNKNOWN) < 0) {
+      fprintf(stderr, "pcap_compile failed: %s\n",
+              dead ? pcap_geterr(dead) : "pcap_open_dead");
+      if (dead) pcap_close(dead);
+      return NULL;
+    }
+  }
+
+  // 表达式、程序与条目放在一次分配里；pcap 的 bpf_insn 与 sock_filter
+  // 布局相同
+  size_t len = prefix_len + fp.bf_len;
+  size_t name_len = strlen(filter) + 1;
+  e = malloc(sizeof(*e) + name_len + len * sizeof(struct sock_filter) + 8);
+  if (e) {
+    e->snaplen = snaplen;
+    e->loopback = loopback;
+    memcpy(e->filter, filter, name_len);
+    e->prog.len = len;
+    e->prog.filter = (struct sock_filter*)(((uintptr_t)e->filter + name_len +
+                                            7) & ~(uintptr_t)7);
+    memcpy(e->prog.filter, prefix, prefix_len * sizeof(struct sock_filter));
+    memcpy(e->prog.filter + prefix_len, fp.bf_insns,
+           fp.bf_len * sizeof(struct sock_filter));
+  }
+  if (dead) {
+    pcap_freecode(&fp);
+    pcap_close(dead);
+  }
+  return e;
+}
+
+const struct sock_fprog* filter_cache_get(struct filter_cache* cache,
+                                          const char* filter,
+                                          unsigned int snaplen, int loopback) {
+  struct filter_entry* e;
+  unsigned int b;
+
+  if (!filter) filter = "";
+  loopback = !!loopback;
+  b = hash(filter, snaplen, loopback);
+
+  // pcap_compile 本身不是线程安全的，编译也放在锁内
+  pthread_mutex_lock(&cache->lock);
+  for (e = cache->buckets[b]; e; e = e->next)
+    if (e->snaplen == snaplen && e->loopback == loopback &&
+        strcmp(e->filter, filter) == 0)
+      break;
+  if (e) {
+    lru_unlink(cache, e);
+  } else if ((e = compile(filter, snaplen, loopback))) {
+    e->next = cache->buckets[b];
+    cache->buckets[b] = e;
+    cache->nr_entries++;
+  }
+  if (e) {
+    e->refs++;
+    lru_push(cache, e);
+    evict(cache);
+  }
+  pthread_mutex_unlock(&cache->lock);
+  return e ? &e->prog : NULL;
+}
+
+void filter_cache_put(struct filter_cache* cache,
+                      const struct sock_fprog* prog) {
+  struct filter_entry* e = (struct filter_entry*)((char*)prog -
+                                                  offsetof(struct filter_entry,
+                                                           prog));
+
+  pthread_mutex_lock(&cache->lock);
+  e->refs--;
+  evict(cache);
+  pthread_mutex_unlock(&cache->lock);
+}
+
+const struct sock_fprog* filter_cache_drop_all(void) {
+  static struct sock_filter drop = {BPF_RET | BPF_K, 0, 0, 0};
+  static const struct sock_fprog prog = {1, &drop};
+  return &prog;
+}
+
+void filter_cache_destroy(struct filter_cache* cache) {
+  if (!cache) return;
+  for (int b = 0; b < FILTER_CACHE_BUCKETS; ++b) {
+    struct filter_entry* e = cache->buckets[b];
+    while (e) {
+      struct filter_entry* next = e->next;
+      free(e);
+      e = next;
+    }
+  }
+  pthread_mutex_destroy(&cache->lock);
+  free(cache);
+}
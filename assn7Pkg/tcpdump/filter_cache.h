@@ -0,0 +1,59 @@
+#ifndef FILTER_CACHE_H
+#define FILTER_CACHE_H
+#include <linux/filter.h>
+
+// 编译后的经典 BPF 过滤程序缓存
+//
+// pcap_compile 的开销远大于把程序挂到 socket 上，按（过滤表达式, snaplen,
+// 是否 lo）缓存编译结果，同一个表达式只编译一次。缓存中的程序一经插入
+// 就不再修改，可以在多个线程间共享。
+//
+// 条目数超过上限时淘汰最久未用的条目。filter_cache_get 返回的程序在
+// filter_cache_put 之前不会被淘汰，用完（挂到 socket 上或翻译完）后
+// 必须归还。
+
+#define FILTER_CACHE_DEFAULT_MAX 256
+
+struct filter_cache;
+
+/**
+ * @brief 进程内默认的缓存，第一次调用时创建，进程退出前不释放
+ *
+ * 最多保留 FILTER_CACHE_DEFAULT_MAX 个程序。
+ *
+ * @return 创建失败（内存不足）时返回 NULL
+ */
+struct filter_cache* filter_cache_default(void);
+
+/**
+ * @brief 创建缓存
+ * @param max_entries 最多保留的程序数，0 表示不限
+ */
+struct filter_cache* filter_cache_create(unsigned int max_entries);
+
+/**
+ * @brief 取出（必要时编译并插入）过滤程序
+ * @param filter pcap 过滤表达式，NULL 或空串表示接收所有包
+ * @param snaplen 每个包最多保留的字节数
+ * @param loopback 是否在 lo 上使用；是则丢弃外发的那一份
+ * @return 成功返回程序，用完后交给 filter_cache_put；编译失败返回 NULL
+ *         并打印原因
+ */
+const struct sock_fprog* filter_cache_get(struct filter_cache* cache,
+                                          const char* filter,
+                                          unsigned int snaplen, int loopback);
+
+/**
+ * @brief 归还 filter_cache_get 取出的程序，之后它可能被淘汰
+ */
+void filter_cache_put(struct filter_cache* cache,
+                      const struct sock_fprog* prog);
+
+/**
+ * @brief 丢弃所有包的程序，用于空闲的 socket
+ */
+const struct sock_fprog* filter_cache_drop_all(void);
+
+void filter_cache_destroy(struct filter_cache* cache);
+
+#endif
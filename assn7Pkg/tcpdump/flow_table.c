@@ -0,0 +1,117 @@
+#include "flow_table.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+_Static_assert(sizeof(struct flow_key) == 40, "flow_key layout");
+
+struct flow_slot {
+  uint32_t hash;   // 0 表示空槽
+  uint32_t index;  // flows 中的下标
+};
+
+struct flow_table {
+  struct flow_slot* slots;
+  uint32_t mask;  // 槽数 - 1
+  struct flow_record* flows;
+  size_t nr_flows;
+  size_t max_flows;
+};
+
+struct flow_table* flow_table_create(size_t max_flows) {
+  struct flow_table* table;
+  size_t nr_slots = 16;
+
+  if (max_flows == 0 || max_flows > UINT32_MAX / 2) return NULL;
+  while (nr_slots < 2 * max_flows) nr_slots <<= 1;
+
+  table = calloc(1, sizeof(*table));
+  if (!table) return NULL;
+  table->slots = aligned_alloc(64, nr_slots * sizeof(struct flow_slot));
+  table->flows = malloc(max_flows * sizeof(struct flow_record));
+  if (!table->slots || !table->flows) {
+    flow_table_destroy(table);
+    return NULL;
+  }
+  memset(table->slots, 0, nr_slots * sizeof(struct flow_slot));
+  table->mask = (uint32_t)(nr_slots - 1);
+  table->max_flows = max_flows;
+  return table;
+}
+
+/**
+ * @brief 键的哈希，按 8 字节混合；结果的最高位置 1，保证不为 0
+ */
+static uint32_t key_hash(const struct flow_key* key) {
+  const uint8_t* p = (const uint8_t*)key;
+  uint64_t h = 0, k;
+
+  for (size_t i = 0; i < sizeof(*key); i += 8) {
+    memcpy(&k, p + i, 8);
+    h = (h ^ k) * 0x9e3779b97f4a7c15ULL;
+    h ^= h >> 32;
+  }
+  return (uint32_t)h | 0x80000000U;
+}
+
+/**
+ * @brief 把一个包计入所属的流
+ *
+ * 线性探测直到遇到哈希值与键都相同的槽（已有的流）或空槽（新流）。
+ */
+int flow_table_add(struct flow_table* table, const struct header_record* rec) {
+  struct flow_key key;
+  struct flow_record* flow;
+  uint32_t hash, pos;
+
+  if (!(rec->layers & HEADER_RECORD_L3)) return 1;
+  memcpy(key.src_addr, rec->src_addr, 16);
+  memcpy(key.dst_addr, rec->dst_addr, 16);
+  key.src_port = rec->src_port;
+  key.dst_port = rec->dst_port;
+  key.proto = rec->proto;
+  key.ip_version = rec->ip_version;
+  key.pad[0] = key.pad[1] = 0;
+
+  hash = key_hash(&key);
+  for (pos = hash & table->mask;; pos = (pos + 1) & table->mask) {
+    struct flow_slot* slot = &table->slots[pos];
+    if (slot->hash == hash) {
+      flow = &table->flows[slot->index];
+      if (memcmp(&flow->key, &key, sizeof(key)) == 0) break;
+    } else if (slot->hash == 0) {
+      if (table->nr_flows == table->max_flows) return -1;
+      slot->hash = hash;
+      slot->index = (uint32_t)table->nr_flows;
+      flow = &table->flows[table->nr_flows++];
+      memset(flow, 0, sizeof(*flow));
+      flow->key = key;
+      flow->first_ns = rec->ts_ns;
+      break;
+    }
+  }
+
+  flow->packets++;
+  flow->bytes += rec->len;
+  flow->last_ns = rec->ts_ns;
+  flow->tcp_flags |= rec->tcp_flags;
+  return 0;
+}
+
+const struct flow_record* flow_table_flows(const struct flow_table* table,
+                                           size_t* count) {
+  *count = table->nr_flows;
+  return table->flows;
+}
+
+void flow_table_clear(struct flow_table* table) {
+  memset(table->slots, 0, ((size_t)table->mask + 1) * sizeof(struct flow_slot));
+  table->nr_flows = 0;
+}
+
+void flow_table_destroy(struct flow_table* table) {
+  if (!table) return;
+  free(table->slots);
+  free(table->flows);
+  free(table);
+}
@@ -0,0 +1,67 @@
+#ifndef FLOW_TABLE_H
+#define FLOW_TABLE_H
+#include <stddef.h>
+#include <stdint.h>
+
+#include "header_record.h"
+
+// 按 5 元组聚合的流表
+//
+// 开放寻址 + 线性探测。探测只访问一个紧凑的槽数组，每槽 8 字节（哈希值与
+// 记录下标），一条缓存行能比较 8 个槽；哈希值相同时才去比较记录本身的键。
+// 流记录按第一次出现的顺序稠密存放，输出时直接顺序遍历。槽数取不小于
+// 2 * max_flows 的 2 的幂，负载因子不超过 1/2。
+//
+// 流是单向的：A->B 与 B->A 是两条流。
+
+struct flow_key {
+  uint8_t src_addr[16];  // IPv4 只用前 4 字节，网络字节序
+  uint8_t dst_addr[16];
+  uint16_t src_port;     // 非 TCP/UDP 为 0
+  uint16_t dst_port;
+  uint8_t proto;
+  uint8_t ip_version;
+  uint8_t pad[2];
+};
+
+struct flow_record {
+  struct flow_key key;
+  uint64_t packets;
+  uint64_t bytes;     // 原始帧长度之和
+  uint64_t first_ns;  // 第一个包的时间戳
+  uint64_t last_ns;   // 最后一个包的时间戳
+  uint8_t tcp_flags;  // 所有包 TCP 标志的按位或
+  uint8_t pad[7];
+};
+
+struct flow_table;
+
+/**
+ * @brief 创建流表
+ * @param max_flows 最多容纳的流数
+ * @return 成功返回流表，失败返回 NULL
+ */
+struct flow_table* flow_table_create(size_t max_flows);
+
+/**
+ * @brief 把一个包计入所属的流
+ * @return 成功返回 0；不是 IP 包返回 1；是新流但表已满返回 -1，
+ *         两种情况都不修改任何流
+ */
+int flow_table_add(struct flow_table* table, const struct header_record* rec);
+
+/**
+ * @brief 所有流记录，按第一次出现的顺序排列
+ * @param count 流数
+ */
+const struct flow_record* flow_table_flows(const struct flow_table* table,
+                                           size_t* count);
+
+/**
+ * @brief 清空所有流，容量不变
+ */
+void flow_table_clear(struct flow_table* table);
+
+void flow_table_destroy(struct flow_table* table);
+
+#endif
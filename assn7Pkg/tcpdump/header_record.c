@@ -0,0 +1,167 @@
+#include "header_record.h"
+
+#include <string.h>
+
+_Static_assert(sizeof(struct header_record) == 96, "header_record layout");
+
+#define HASH_MUL 0x9e3779b97f4a7c15ULL
+
+static uint16_t be16(const uint8_t* p) { return (uint16_t)(p[0] << 8 | p[1]); }
+
+static uint32_t be32(const uint8_t* p) {
+  return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 |
+         p[3];
+}
+
+/**
+ * @brief 载荷哈希，每 8 字节一次乘法与移位混合
+ */
+uint64_t header_record_hash(const void* data, size_t len) {
+  const uint8_t* p = data;
+  uint64_t h = len * HASH_MUL, k;
+
+  for (; len >= 8; p += 8, len -= 8) {
+    memcpy(&k, p, 8);
+    h = (h ^ k) * HASH_MUL;
+    h ^= h >> 29;
+  }
+  if (len) {
+    k = 0;
+    memcpy(&k, p, len);
+    h = (h ^ k) * HASH_MUL;
+    h ^= h >> 29;
+  }
+  return h ^ h >> 32;
+}
+
+/**
+ * @brief 解析 IPv4 头
+ * @return L4 头的偏移，没有可解析的 L4（分片或头部不完整）时返回 0
+ */
+static uint32_t parse_ipv4(struct header_record* rec, const uint8_t* p,
+                           uint32_t off, uint32_t caplen, uint32_t* end) {
+  uint32_t ihl, total;
+
+  if (off + 20 > caplen || p[off] >> 4 != 4) return 0;
+  ihl = (p[off] & 0xf) * 4;
+  total = be16(p + off + 2);
+  if (ihl < 20 || total < ihl) return 0;
+
+  rec->ip_version = 4;
+  rec->tos = p[off + 1];
+  rec->ip_id = be16(p + off + 4);
+  rec->ttl = p[off + 8];
+  rec->proto = p[off + 9];
+  memcpy(rec->src_addr, p + off + 12, 4);
+  memcpy(rec->dst_addr, p + off + 16, 4);
+  rec->layers |= HEADER_RECORD_L3;
+  *end = off + total;
+  rec->payload_len = total - ihl;
+
+  // 非首个分片没有 L4 头
+  if (be16(p + off + 6) & 0x1fff) return 0;
+  return off + ihl;
+}
+
+/**
+ * @brief 解析 IPv6 头，跳过 hop-by-hop/routing/destination/fragment 扩展头
+ * @return L4 头的偏移，没有可解析的 L4 时返回 0
+ */
+static uint32_t parse_ipv6(struct header_record* rec, const uint8_t* p,
+                           uint32_t off, uint32_t caplen, uint32_t* end) {
+  uint32_t l4 = off + 40;
+  uint8_t nh;
+
+  if (off + 40 > caplen || p[off] >> 4 != 6) return 0;
+
+  rec->ip_version = 6;
+  rec->tos = (uint8_t)((p[off] & 0xf) << 4 | p[off + 1] >> 4);
+  rec->ip_id = (uint32_t)(p[off + 1] & 0xf) << 16 | be16(p + off + 2);
+  rec->ttl = p[off + 7];
+  memcpy(rec->src_addr, p + off + 8, 16);
+  memcpy(rec->dst_addr, p + off + 24, 16);
+  rec->layers |= HEADER_RECORD_L3;
+  *end = l4 + be16(p + off + 4);
+  nh = p[off + 6];
+
+  for (;;) {
+    rec->proto = nh;
+    if (nh != 0 && nh != 43 && nh != 44 && nh != 60) break;
+    if (l4 + 8 > caplen) return 0;
+    nh = p[l4];
+    if (rec->proto == 44) {
+      if (be16(p + l4 + 2) & 0xfff8) {
+        rec->proto = nh;
+        return 0;
+      }
+      l4 += 8;
+    } else {
+      l4 += (p[l4 + 1] + 1) * 8;
+    }
+  }
+  rec->payload_len = *end > l4 ? *end - l4 : 0;
+  return l4;
+}
+
+/**
+ * @brief 把一个以太网帧解析成定长记录
+ *
+ * 逐层解析，任何一层的头部不完整就停在上一层。载荷长度取自 IP 头，
+ * 与抓取时是否截断无关；载荷哈希只覆盖实际抓到的部分。
+ */
+void header_record_parse(struct header_record* rec, const uint8_t* frame,
+                         uint32_t caplen, uint32_t len, uint64_t ts_ns,
+                         unsigned int flags) {
+  uint32_t off = 14, l4 = 0, payload, end = 0, stop, avail;
+  int tags = 0;
+  uint16_t type;
+
+  memset(rec, 0, sizeof(*rec));
+  rec->ts_ns = ts_ns;
+  rec->len = len;
+  if (caplen < 14) return;
+
+  memcpy(rec->dst_mac, frame, 6);
+  memcpy(rec->src_mac, frame + 6, 6);
+  type = be16(frame + 12);
+  // 802.1Q / 802.1ad，QinQ 只记录最外层
+  while ((type == 0x8100 || type == 0x88a8) && off + 4 <= caplen) {
+    if (tags++ == 0) rec->vlan = be16(frame + off);
+    type = be16(frame + off + 2);
+    off += 4;
+  }
+  rec->ethertype = type;
+  rec->layers |= HEADER_RECORD_L2;
+
+  if (type == 0x0800)
+    l4 = parse_ipv4(rec, frame, off, caplen, &end);
+  else if (type == 0x86dd)
+    l4 = parse_ipv6(rec, frame, off, caplen, &end);
+  if (!l4) return;
+
+  payload = l4;
+  if (rec->proto == 6 && l4 + 20 <= caplen) {
+    uint32_t doff = (frame[l4 + 12] >> 4) * 4;
+    rec->src_port = be16(frame + l4);
+    rec->dst_port = be16(frame + l4 + 2);
+    rec->seq = be32(frame + l4 + 4);
+    rec->ack = be32(frame + l4 + 8);
+    rec->tcp_flags = frame[l4 + 13];
+    rec->window = be16(frame + l4 + 14);
+    rec->layers |= HEADER_RECORD_L4;
+    payload = l4 + (doff < 20 ? 20 : doff);
+  } else if (rec->proto == 17 && l4 + 8 <= caplen) {
+    rec->src_port = be16(frame + l4);
+    rec->dst_port = be16(frame + l4 + 2);
+    rec->layers |= HEADER_RECORD_L4;
+    payload = l4 + 8;
+  }
+  rec->payload_len = end > payload ? end - payload : 0;
+
+  if (!(flags & HEADER_RECORD_HASH)) return;
+  stop = end < caplen ? end : caplen;
+  avail = stop > payload ? stop - payload : 0;
+  rec->payload_hash = header_record_hash(frame + payload, avail);
+  rec->layers |= HEADER_RECORD_HASHED;
+  if (avail < rec->payload_len) rec->layers |= HEADER_RECORD_PARTIAL;
+}
@@ -0,0 +1,73 @@
+#ifndef HEADER_RECORD_H
+#define HEADER_RECORD_H
+#include <stddef.h>
+#include <stdint.h>
+
+// 只保留协议头的定长抓包记录
+//
+// 做流分析时只需要 L2~L4 的头部字段，整包复制既占内存带宽又占缓冲区。
+// 每个包被解析成一条 96 字节的 header_record：以太网/VLAN、IPv4/IPv6、
+// TCP/UDP 的主要字段，外加载荷长度和可选的载荷哈希。多字节整数字段都是
+// 主机字节序，MAC 与 IP 地址保持网络字节序。
+
+// header_record_parse 的 flags
+#define HEADER_RECORD_HASH 0x1  // 计算载荷哈希，需要抓取完整载荷
+
+// 不算哈希时每个包需要抓取的字节数：以太网 + 两层 VLAN + IPv6 与
+// 扩展头 + 带选项的 TCP 头都放得下
+#define HEADER_RECORD_SNAPLEN 256
+
+// header_record.layers 的位
+#define HEADER_RECORD_L2 0x01       // 以太网头已解析
+#define HEADER_RECORD_L3 0x02       // IPv4/IPv6 头已解析
+#define HEADER_RECORD_L4 0x04       // TCP/UDP 头已解析
+#define HEADER_RECORD_HASHED 0x08   // payload_hash 有效
+#define HEADER_RECORD_PARTIAL 0x10  // 载荷被截断，哈希只覆盖抓到的部分
+
+struct header_record {
+  uint64_t ts_ns;         // 接收时间，CLOCK_REALTIME，ns
+  uint64_t payload_hash;  // 载荷哈希，见 header_record_hash
+  uint32_t len;           // 原始帧长度
+  uint32_t payload_len;   // L4 载荷长度，按 IP 头中的长度计算，不受截断影响
+  uint8_t dst_mac[6];
+  uint8_t src_mac[6];
+  uint16_t ethertype;     // 去掉 VLAN 标签之后的类型
+  uint16_t vlan;          // 最外层 VLAN 的 TCI，0 表示没有
+  uint8_t src_addr[16];   // IPv4 只用前 4 字节
+  uint8_t dst_addr[16];
+  uint8_t ip_version;     // 4 或 6，0 表示不是 IP
+  uint8_t proto;          // IPv4 协议号 / IPv6 扩展头之后的 next header
+  uint8_t ttl;            // TTL / hop limit
+  uint8_t tos;            // TOS / traffic class
+  uint16_t src_port;
+  uint16_t dst_port;
+  uint32_t seq;           // 仅 TCP
+  uint32_t ack;
+  uint16_t window;
+  uint8_t tcp_flags;
+  uint8_t layers;         // HEADER_RECORD_L2 ...
+  uint32_t ip_id;         // IPv4 identification / IPv6 flow label
+};
+
+/**
+ * @brief 把一个以太网帧解析成记录
+ *
+ * 只读取帧的前 caplen 字节；解析到哪一层由 layers 标明，后面的字段为 0。
+ * IPv4/IPv6 的非首个分片不解析 L4。
+ *
+ * @param frame 链路层帧
+ * @param caplen frame 中有效的字节数
+ * @param len 原始帧长度
+ * @param flags HEADER_RECORD_HASH 或 0
+ */
+void header_record_parse(struct header_record* rec, const uint8_t* frame,
+                         uint32_t caplen, uint32_t len, uint64_t ts_ns,
+                         unsigned int flags);
+
+/**
+ * @brief 载荷哈希：64 位，每次处理 8 字节；结果依赖主机字节序，只在同一
+ *        台机器上的记录之间比较
+ */
+uint64_t header_record_hash(const void* data, size_t len);
+
+#endif
@@ -0,0 +1,166 @@
+#include "pcapng_buf.h"
+
+#include <string.h>
+
+#define SHB_TYPE 0x0A0D0D0AU
+#define IDB_TYPE 0x00000001U
+#define EPB_TYPE 0x00000006U
+#define CB_TYPE 0x40000BADU  // Custom Block，编辑后偏移失效，不应被复制
+#define BYTE_ORDER_MAGIC 0x1A2B3C4DU
+#define INDEX_PEN 32473U  // RFC 5612 文档用企业号
+
+#define SHB_LEN 28
+#define IDB_LEN 32
+#define CB_HEADER 16  // type + length + PEN + count
+// 索引块除索引项以外最多占用的字节：头部、对齐填充与尾部长度
+#define CB_OVERHEAD (CB_HEADER + 4 + 4)
+
+_Static_assert(SHB_LEN + IDB_LEN == PCAPNG_HEADER_LEN, "pcapng header");
+
+static size_t pad4(size_t n) { return (n + 3) & ~(size_t)3; }
+
+static void put32(uint8_t* p, uint32_t v) { memcpy(p, &v, 4); }
+
+static uint32_t get32(const uint8_t* p) {
+  uint32_t v;
+  memcpy(&v, p, 4);
+  return v;
+}
+
+static size_t index_entries_offset(size_t block) {
+  return (block + CB_HEADER + PCAPNG_BUF_ALIGN - 1) &
+         ~(size_t)(PCAPNG_BUF_ALIGN - 1);
+}
+
+size_t pcapng_write_header(void* dst, uint16_t linktype, uint32_t snaplen) {
+  uint8_t* p = dst;
+  int64_t unknown = -1;
+
+  // SHB：section length 先写 -1，结束时补上
+  put32(p, SHB_TYPE);
+  put32(p + 4, SHB_LEN);
+  put32(p + 8, BYTE_ORDER_MAGIC);
+  put32(p + 12, 1);  // major 1, minor 0
+  memcpy(p + 16, &unknown, 8);
+  put32(p + 24, SHB_LEN);
+  p += SHB_LEN;
+
+  // IDB：if_tsresol = 9，时间戳单位为 ns
+  put32(p, IDB_TYPE);
+  put32(p + 4, IDB_LEN);
+  put32(p + 8, linktype);
+  put32(p + 12, snaplen);
+  put32(p + 16, 9 | (1 << 16));  // option code 9, length 1
+  put32(p + 20, 9);
+  put32(p + 24, 0);  // opt_endofopt
+  put32(p + 28, IDB_LEN);
+  return PCAPNG_HEADER_LEN;
+}
+
+void pcapng_write_epb_head(void* dst, uint32_t caplen, uint32_t len,
+                           uint64_t ts_ns) {
+  uint8_t* p = dst;
+  size_t epb_len = PCAPNG_EPB_LEN(caplen);
+
+  put32(p, EPB_TYPE);
+  put32(p + 4, epb_len);
+  put32(p + 8, 0);  // interface id
+  put32(p + 12, ts_ns >> 32);
+  put32(p + 16, (uint32_t)ts_ns);
+  put32(p + 20, caplen);
+  put32(p + 24, len);
+}
+
+int pcapng_writer_init(struct pcapng_writer* w, void* buffer,
+                       size_t buffer_size, uint16_t linktype,
+                       uint32_t snaplen) {
+  if (buffer_size < SHB_LEN + IDB_LEN + CB_OVERHEAD) return -1;
+  w->buf = buffer;
+  w->size = buffer_size;
+  w->count = 0;
+  w->index_start = buffer_size & ~(size_t)(PCAPNG_BUF_ALIGN - 1);
+  w->data_end = pcapng_write_header(buffer, linktype, snaplen);
+  return 0;
+}
+
+int pcapng_writer_append(struct pcapng_writer* w, const void* data,
+                         uint32_t caplen, uint32_t len, uint64_t ts_ns) {
+  size_t epb_len = PCAPNG_EPB_LEN(caplen);
+  struct pcapng_index_entry e;
+  uint8_t* p;
+
+  // 预留结束时索引块的头尾，保证 finish 一定放得下
+  if (w->data_end + epb_len + CB_OVERHEAD >
+      w->index_start - sizeof(struct pcapng_index_entry))
+    return -1;
+
+  p = w->buf + w->data_end;
+  pcapng_write_epb_head(p, caplen, len, ts_ns);
+  memcpy(p + 28, data, caplen);
+  memset(p + 28 + caplen, 0, pad4(caplen) - caplen);
+  put32(p + epb_len - 4, epb_len);
+
+  e.ts_ns = ts_ns;
+  e.offset = w->data_end + 28;
+  e.caplen = caplen;
+  e.len = len;
+  w->index_start -= sizeof(e);
+  memcpy(w->buf + w->index_start, &e, sizeof(e));
+
+  w->data_end += epb_len;
+  w->count++;
+  return 0;
+}
+
+size_t pcapng_writer_finish(struct pcapng_writer* w) {
+  struct pcapng_index_entry* idx =
+      (struct pcapng_index_entry*)(w->buf + w->index_start);
+  size_t block = w->data_end;
+  size_t entries = index_entries_offset(block);
+  size_t bytes = (size_t)w->count * sizeof(*idx);
+  size_t block_len = entries - block + bytes + 4;
+  int64_t section;
+
+  // 索引项在末尾是倒序的：先原地翻转，再整体挪到最后一个 EPB 之后
+  for (uint32_t i = 0; i < w->count / 2; ++i) {
+    struct pcapng_index_entry t = idx[i];
+    idx[i] = idx[w->count - 1 - i];
+    idx[w->count - 1 - i] = t;
+  }
+  memmove(w->buf + entries, idx, bytes);
+
+  put32(w->buf + block, CB_TYPE);
+  put32(w->buf + block + 4, block_len);
+  put32(w->buf + block + 8, INDEX_PEN);
+  put32(w->buf + block + 12, w->count);
+  memset(w->buf + block + CB_HEADER, 0, entries - block - CB_HEADER);
+  put32(w->buf + block + block_len - 4, block_len);
+
+  w->data_end = block + block_len;
+  section = w->data_end - SHB_LEN;
+  memcpy(w->buf + 16, &section, 8);
+  return w->data_end;
+}
+
+size_t pcapng_buf_size(const void* buffer) {
+  const uint8_t* p = buffer;
+  int64_t section;
+
+  if (get32(p) != SHB_TYPE || get32(p + 8) != BYTE_ORDER_MAGIC) return 0;
+  memcpy(&section, p + 16, 8);
+  return section < 0 ? 0 : SHB_LEN + (size_t)section;
+}
+
+const struct pcapng_index_entry* pcapng_buf_index(const void* buffer,
+                                                  uint32_t* count) {
+  const uint8_t* p = buffer;
+  size_t size = pcapng_buf_size(buffer);
+  size_t block;
+
+  if (size < SHB_LEN + IDB_LEN + CB_HEADER + 4) return NULL;
+  block = size - get32(p + size - 4);
+  if (get32(p + block) != CB_TYPE || get32(p + block + 8) != INDEX_PEN)
+    return NULL;
+  *count = get32(p + block + 12);
+  return (const struct pcapng_index_entry*)(p + index_entries_offset(block));
+}
@@ -0,0 +1,99 @@
+#ifndef PCAPNG_BUF_H
+#define PCAPNG_BUF_H
+#include <stddef.h>
+#include <stdint.h>
+
+// 抓包缓冲区格式
+//
+// 缓冲区本身就是一个完整的 pcapng 文件，可以原样写盘交给 wireshark/tcpdump：
+//
+//   SHB | IDB(if_tsresol = 9, 纳秒) | EPB ... EPB | 索引块
+//
+// 抓包过程中只追加：EPB 从前往后写，每个包的索引项从缓冲区末尾往前写，
+// 两者相遇即为写满；任意时刻 [0, data_end) 都是合法的 pcapng 前缀。
+// 结束时把索引项按顺序挪到最后一个 EPB 之后，包成一个 pcapng Custom Block
+// （读者不认识会直接跳过），并把总长度写进 SHB 的 section length。
+//
+// 定位不需要扫描：SHB 给出总长度，pcapng 每个块的最后 4 字节是块长，
+// 由此直接找到末尾的索引块；索引项给出每个包数据在缓冲区中的偏移。
+
+#define PCAPNG_BUF_ALIGN 8  // 缓冲区起始地址的对齐要求
+
+#define PCAPNG_HEADER_LEN 60    // SHB + IDB
+#define PCAPNG_EPB_HEAD_LEN 28  // EPB 中包数据之前的部分
+// 一个 EPB 的总长度：头部、按 4 字节填充的包数据与末尾的块长
+#define PCAPNG_EPB_LEN(caplen) \
+  (PCAPNG_EPB_HEAD_LEN + (((caplen) + 3) & ~3U) + 4)
+
+/**
+ * @brief 一个包的索引项
+ */
+struct pcapng_index_entry {
+  uint64_t ts_ns;   // 接收时间，CLOCK_REALTIME，ns
+  uint64_t offset;  // 包数据在缓冲区中的偏移
+  uint32_t caplen;  // 缓冲区中保存的字节数
+  uint32_t len;     // 原始长度，caplen < len 表示被截断
+};
+
+struct pcapng_writer {
+  uint8_t* buf;
+  size_t size;
+  size_t data_end;     // 下一个 EPB 写入的位置
+  size_t index_start;  // 最早写入的索引项在末尾，往前增长
+  uint32_t count;
+};
+
+/**
+ * @brief 写入 SHB（section length 为 -1，即未知）与 IDB（if_tsresol = 9）
+ * @param dst 至少 PCAPNG_HEADER_LEN 字节
+ * @return 写入的字节数，即 PCAPNG_HEADER_LEN
+ */
+size_t pcapng_write_header(void* dst, uint16_t linktype, uint32_t snaplen);
+
+/**
+ * @brief 写入 EPB 的前 PCAPNG_EPB_HEAD_LEN 字节
+ *
+ * 之后由调用者依次写入 caplen 字节包数据、填充到 4 字节对齐的 0，以及
+ * 4 字节的块长 PCAPNG_EPB_LEN(caplen)。用于不能一次写完整个块的场合。
+ */
+void pcapng_write_epb_head(void* dst, uint32_t caplen, uint32_t len,
+                           uint64_t ts_ns);
+
+/**
+ * @brief 在 buffer 上开始一个新的抓包文件，写入 SHB 与 IDB
+ * @param linktype pcap 链路层类型，如 DLT_EN10MB
+ * @param snaplen 每个包最多保存的字节数
+ * @return 成功返回 0，buffer 太小返回 -1
+ */
+int pcapng_writer_init(struct pcapng_writer* w, void* buffer,
+                       size_t buffer_size, uint16_t linktype,
+                       uint32_t snaplen);
+
+/**
+ * @brief 追加一个包：写一个 EPB 和一条索引项
+ * @param data 包数据，caplen 字节
+ * @return 成功返回 0，缓冲区剩余空间不足返回 -1（不写入任何内容）
+ */
+int pcapng_writer_append(struct pcapng_writer* w, const void* data,
+                         uint32_t caplen, uint32_t len, uint64_t ts_ns);
+
+/**
+ * @brief 结束抓包：写入索引块并补全 SHB
+ * @return 整个 pcapng 文件的字节数
+ */
+size_t pcapng_writer_finish(struct pcapng_writer* w);
+
+/**
+ * @brief 已结束的抓包缓冲区的总字节数，格式不对返回 0
+ */
+size_t pcapng_buf_size(const void* buffer);
+
+/**
+ * @brief 取出已结束的抓包缓冲区的索引
+ * @param count 输出索引项个数
+ * @return 索引项数组，指向 buffer 内部；格式不对返回 NULL
+ */
+const struct pcapng_index_entry* pcapng_buf_index(const void* buffer,
+                                                  uint32_t* count);
+
+#endif
@@ -0,0 +1,311 @@
+#define _GNU_SOURCE
+#include "pcapng_stream.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "pcapng_buf.h"
+
+#define LINKTYPE_ETHERNET 1
+
+enum { BUF_FREE, BUF_FILLING, BUF_FULL };
+
+struct stream_buf {
+  uint8_t* data;
+  size_t used;
+  uint32_t segment;  // 所属文件的序号
+  int seal;          // 所属文件的最后一块，写完后关闭文件
+  int state;         // BUF_*，抓包线程与写盘线程之间的交接
+};
+
+struct pcapng_stream {
+  struct pcapng_stream_config config;
+  size_t buf_size;
+  int nr_bufs;
+  struct stream_buf* bufs;
+
+  // 只由抓包线程访问（计数除外）
+  struct stream_buf* cur;  // 正在填的缓冲区，NULL 表示还没有开始
+  int fill;                // 下一个要取的缓冲区，各缓冲区按顺序轮流使用
+  int new_segment;         // 下一个包从新文件开始
+  uint32_t segment;
+  uint64_t seg_bytes;
+  uint64_t seg_packets;
+  uint64_t seg_start_ns;
+  uint64_t packets;
+  uint64_t drops;
+  uint64_t bytes;
+
+  // 写盘线程
+  pthread_t writer;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  int stop;
+  int fd;  // -1 表示没有打开的文件，-2 表示打开失败，丢弃到本文件结束
+  int fd_direct;
+  uint64_t file_pos;
+  uint32_t segments;
+  int err;
+};
+
+static void count(uint64_t* counter, uint64_t n) {
+  __atomic_store_n(counter, *counter + n, __ATOMIC_RELAXED);
+}
+
+static int write_all(int fd, const uint8_t* p, size_t n) {
+  while (n) {
+    ssize_t r = write(fd, p, n);
+    if (r < 0) {
+      if (errno == EINTR) continue;
+      return -errno;
+    }
+    p += r;
+    n -= r;
+  }
+  return 0;
+}
+
+static void set_error(struct pcapng_stream* s, int err) {
+  if (!s->err) s->err = err;
+}
+
+static void open_segment(struct pcapng_stream* s, uint32_t segment) {
+  char path[4096];
+  int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+
+  snprintf(path, sizeof(path), "%s.%06u.pcapng", s->config.prefix, segment);
+  s->fd_direct = s->config.direct;
+  s->fd = open(path, flags | (s->fd_direct ? O_DIRECT : 0), 0644);
+  if (s->fd < 0 && errno == EINVAL && s->fd_direct) {
+    s->fd_direct = 0;
+    s->fd = open(path, flags, 0644);
+  }
+  if (s->fd < 0) {
+    fprintf(stderr, "open %s: %s\n", path, strerror(errno));
+    set_error(s, -errno);
+    s->fd = -2;
+  }
+  s->file_pos = 0;
+}
+
+/**
+ * @brief 把一个缓冲区写进它所属的文件
+ *
+ * 除文件的最后一块以外，缓冲区都是写满的，长度与对齐都满足 O_DIRECT；
+ * 最后一块补 0 到 PCAPNG_STREAM_ALIGN 的倍数写入，再截断到实际长度。
+ */
+static void write_buf(struct pcapng_stream* s, struct stream_buf* b) {
+  size_t len = b->used;
+  int ret;
+
+  if (s->fd == -1) open_segment(s, b->segment);
+  if (s->fd >= 0) {
+    if (s->fd_direct && len % PCAPNG_STREAM_ALIGN) {
+      size_t padded = (len + PCAPNG_STREAM_ALIGN - 1) &
+                      ~(size_t)(PCAPNG_STREAM_ALIGN - 1);
+      memset(b->data + len, 0, padded - len);
+      len = padded;
+    }
+    ret = write_all(s->fd, b->data, len);
+    if (ret < 0) set_error(s, ret);
+    s->file_pos += b->used;
+  }
+  if (!b->seal) return;
+
+  if (s->fd >= 0) {
+    if (len != b->used && ftruncate(s->fd, s->file_pos) != 0)
+      set_error(s, -errno);
+    close(s->fd);
+    __atomic_store_n(&s->segments, s->segments + 1, __ATOMIC_RELAXED);
+  }
+  s->fd = -1;
+}
+
+static void* writer_main(void* arg) {
+  struct pcapng_stream* s = arg;
+
+  for (int w = 0;; w = (w + 1) % s->nr_bufs) {
+    struct stream_buf* b = &s->bufs[w];
+
+    // 缓冲区按交出的顺序写；stop 之后遇到第一个没交出的就结束
+    pthread_mutex_lock(&s->lock);
+    while (__atomic_load_n(&b->state, __ATOMIC_ACQUIRE) != BUF_FULL &&
+           !s->stop)
+      pthread_cond_wait(&s->cond, &s->lock);
+    pthread_mutex_unlock(&s->lock);
+    if (__atomic_load_n(&b->state, __ATOMIC_ACQUIRE) != BUF_FULL) break;
+
+    write_buf(s, b);
+    __atomic_store_n(&b->state, BUF_FREE, __ATOMIC_RELEASE);
+  }
+  return NULL;
+}
+
+struct pcapng_stream* pcapng_stream_open(
+    const struct pcapng_stream_config* config) {
+  struct pcapng_stream* s;
+
+  if (!config->prefix || config->nr_buffers < 2) return NULL;
+  s = calloc(1, sizeof(*s));
+  if (!s) return NULL;
+  s->config = *config;
+  s->nr_bufs = config->nr_buffers;
+  // 至少能放下文件头与一个最大的包
+  s->buf_size = config->buffer_bytes;
+  if (s->buf_size < PCAPNG_HEADER_LEN + PCAPNG_EPB_LEN(config->snaplen))
+    s->buf_size = PCAPNG_HEADER_LEN + PCAPNG_EPB_LEN(config->snaplen);
+  s->buf_size = (s->buf_size + PCAPNG_STREAM_ALIGN - 1) &
+                ~(size_t)(PCAPNG_STREAM_ALIGN - 1);
+  s->new_segment = 1;
+  s->fd = -1;
+  pthread_mutex_init(&s->lock, NULL);
+  pthread_cond_init(&s->cond, NULL);
+
+  s->bufs = calloc(s->nr_bufs, sizeof(*s->bufs));
+  if (!s->bufs) goto fail;
+  for (int i = 0; i < s->nr_bufs; ++i) {
+    s->bufs[i].data = aligned_alloc(PCAPNG_STREAM_ALIGN, s->buf_size);
+    if (!s->bufs[i].data) goto fail;
+  }
+  if (pthread_create(&s->writer, NULL, writer_main, s) != 0) goto fail;
+  return s;
+
+fail:
+  for (int i = 0; s->bufs && i < s->nr_bufs; ++i) free(s->bufs[i].data);
+  free(s->bufs);
+  free(s);
+  return NULL;
+}
+
+static void hand_off(struct pcapng_stream* s, int seal) {
+  s->cur->seal = seal;
+  __atomic_store_n(&s->cur->state, BUF_FULL, __ATOMIC_RELEASE);
+  pthread_mutex_lock(&s->lock);
+  pthread_cond_signal(&s->cond);
+  pthread_mutex_unlock(&s->lock);
+  s->cur = NULL;
+}
+
+// 取下一个缓冲区，调用者已确认它是空闲的
+static void take(struct pcapng_stream* s) {
+  s->cur = &s->bufs[s->fill];
+  s->fill = (s->fill + 1) % s->nr_bufs;
+  s->cur->used = 0;
+  s->cur->seal = 0;
+  s->cur->segment = s->segment;
+  __atomic_store_n(&s->cur->state, BUF_FILLING, __ATOMIC_RELAXED);
+}
+
+// 写入 n 字节，当前缓冲区写满时换下一个
+static void put(struct pcapng_stream* s, const void* data, size_t n) {
+  const uint8_t* p = data;
+
+  while (n) {
+    size_t room = s->buf_size - s->cur->used;
+    if (room == 0) {
+      hand_off(s, 0);
+      take(s);
+      room = s->buf_size;
+    }
+    if (room > n) room = n;
+    memcpy(s->cur->data + s->cur->used, p, room);
+    s->cur->used += room;
+    p += room;
+    n -= room;
+  }
+}
+
+/**
+ * @brief 追加一个包
+ *
+ * 先判断是否需要切换文件，再确认放得下：当前缓冲区剩余的空间不够时，
+ * 下一个缓冲区必须已经被写盘线程释放，否则丢弃这个包。
+ */
+int pcapng_stream_append(struct pcapng_stream* s, const void* data,
+                         uint32_t caplen, uint32_t len, uint64_t ts_ns) {
+  static const uint8_t zero[4];
+  uint8_t head[PCAPNG_EPB_HEAD_LEN];
+  size_t epb, need, room;
+  uint32_t trailer;
+
+  // 缓冲区大小按 snaplen 计算，更长的包必须截断
+  if (caplen > s->config.snaplen) caplen = s->config.snaplen;
+  epb = PCAPNG_EPB_LEN(caplen);
+  trailer = (uint32_t)epb;
+
+  if (s->cur && s->seg_packets &&
+      ((s->config.segment_bytes &&
+        s->seg_bytes + epb > s->config.segment_bytes) ||
+       (s->config.segment_ms &&
+        ts_ns - s->seg_start_ns >= s->config.segment_ms * 1000000ULL))) {
+    hand_off(s, 1);
+    s->new_segment = 1;
+  }
+
+  need = epb + (s->new_segment ? PCAPNG_HEADER_LEN : 0);
+  room = s->cur ? s->buf_size - s->cur->used : 0;
+  if (need > room &&
+      __atomic_load_n(&s->bufs[s->fill].state, __ATOMIC_ACQUIRE) != BUF_FREE) {
+    count(&s->drops, 1);
+    return -1;
+  }
+
+  if (s->new_segment) {
+    // 新文件总是从一个新的缓冲区开始
+    s->segment++;
+    take(s);
+    s->cur->used = pcapng_write_header(s->cur->data, LINKTYPE_ETHERNET,
+                                       s->config.snaplen);
+    s->seg_bytes = PCAPNG_HEADER_LEN;
+    s->seg_packets = 0;
+    s->seg_start_ns = ts_ns;
+    s->new_segment = 0;
+    count(&s->bytes, PCAPNG_HEADER_LEN);
+  }
+
+  pcapng_write_epb_head(head, caplen, len, ts_ns);
+  put(s, head, sizeof(head));
+  put(s, data, caplen);
+  put(s, zero, epb - PCAPNG_EPB_HEAD_LEN - 4 - caplen);
+  put(s, &trailer, 4);
+
+  s->seg_bytes += epb;
+  s->seg_packets++;
+  count(&s->packets, 1);
+  count(&s->bytes, epb);
+  return 0;
+}
+
+void pcapng_stream_stats(const struct pcapng_stream* s,
+                         struct pcapng_stream_stats* stats) {
+  stats->packets = __atomic_load_n(&s->packets, __ATOMIC_RELAXED);
+  stats->drops = __atomic_load_n(&s->drops, __ATOMIC_RELAXED);
+  stats->bytes = __atomic_load_n(&s->bytes, __ATOMIC_RELAXED);
+  stats->segments = __atomic_load_n(&s->segments, __ATOMIC_RELAXED);
+}
+
+int pcapng_stream_close(struct pcapng_stream* s,
+                        struct pcapng_stream_stats* stats) {
+  int err;
+
+  if (s->cur) hand_off(s, 1);
+  pthread_mutex_lock(&s->lock);
+  s->stop = 1;
+  pthread_cond_signal(&s->cond);
+  pthread_mutex_unlock(&s->lock);
+  pthread_join(s->writer, NULL);
+
+  if (stats) pcapng_stream_stats(s, stats);
+  err = s->err;
+  for (int i = 0; i < s->nr_bufs; ++i) free(s->bufs[i].data);
+  free(s->bufs);
+  pthread_mutex_destroy(&s->lock);
+  pthread_cond_destroy(&s->cond);
+  free(s);
+  return err;
+}
@@ -0,0 +1,70 @@
+#ifndef PCAPNG_STREAM_H
+#define PCAPNG_STREAM_H
+#include <stddef.h>
+#include <stdint.h>
+
+// 流式写盘的 pcapng 输出
+//
+// 抓包线程把 EPB 追加进一组对齐的大缓冲区，写满一个就交给后台写盘线程，
+// 自己换下一个继续写；写盘线程按顺序把缓冲区整块写进文件。所有缓冲区都
+// 在等待写盘时，新来的包被丢弃并计数，抓包线程从不因为存储变慢而阻塞。
+//
+// 输出按大小或时间切分成多个文件 <prefix>.<序号>.pcapng，每个文件都是完整的
+// pcapng（SHB + IDB + EPB...，section length 为未知）。一个 EPB 可以跨两个
+// 缓冲区，因此除每个文件的最后一块以外，写盘的长度都是缓冲区大小，可以
+// 直接使用 O_DIRECT；最后一块补齐到 4KiB 写入后再截断到实际长度。
+
+#define PCAPNG_STREAM_ALIGN 4096  // O_DIRECT 写入的对齐与粒度
+
+struct pcapng_stream_config {
+  const char* prefix;       // 输出文件名前缀，可以带目录
+  uint64_t segment_bytes;   // 文件超过这么大就切换，0 表示不按大小切分
+  uint64_t segment_ms;      // 文件的第一个包之后这么久就切换，0 表示不按时间
+  size_t buffer_bytes;      // 每个缓冲区的大小，按 PCAPNG_STREAM_ALIGN 向上取整
+  int nr_buffers;           // 缓冲区个数，至少 2
+  int direct;               // 是否使用 O_DIRECT，文件系统不支持时自动退回
+  uint32_t snaplen;         // 写进 IDB 的 snaplen
+};
+
+// 默认：每 1GiB 切换，4 个 8MiB 缓冲区，O_DIRECT
+#define PCAPNG_STREAM_CONFIG_DEFAULT(prefix) \
+  { (prefix), 1ULL << 30, 0, 8U << 20, 4, 1, 65535 }
+
+struct pcapng_stream_stats {
+  uint64_t packets;   // 写进缓冲区的包数
+  uint64_t drops;     // 没有空闲缓冲区而丢弃的包数
+  uint64_t bytes;     // 写进缓冲区的字节数，含文件头
+  uint32_t segments;  // 已经完整写盘并关闭的文件数
+};
+
+struct pcapng_stream;
+
+/**
+ * @brief 分配缓冲区并启动写盘线程，第一个文件在第一个包到来时才创建
+ * @return 成功返回句柄，参数不合法或分配失败返回 NULL
+ */
+struct pcapng_stream* pcapng_stream_open(
+    const struct pcapng_stream_config* config);
+
+/**
+ * @brief 追加一个包，只能在一个线程中调用
+ * @return 成功返回 0，没有空闲缓冲区而丢弃返回 -1
+ */
+int pcapng_stream_append(struct pcapng_stream* stream, const void* data,
+                         uint32_t caplen, uint32_t len, uint64_t ts_ns);
+
+/**
+ * @brief 读取计数，可以在抓包过程中调用
+ */
+void pcapng_stream_stats(const struct pcapng_stream* stream,
+                         struct pcapng_stream_stats* stats);
+
+/**
+ * @brief 写出剩余数据，关闭当前文件并等待写盘线程结束
+ * @param stats 返回最终的计数，可以为 NULL
+ * @return 成功返回 0，写盘出错返回第一次出错的 -errno
+ */
+int pcapng_stream_close(struct pcapng_stream* stream,
+                        struct pcapng_stream_stats* stats);
+
+#endif
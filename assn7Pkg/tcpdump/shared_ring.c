@@ -0,0 +1,437 @@
+#define _GNU_SOURCE
+#include "shared_ring.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#define RING_MAGIC 0x52485350  // "PSHR"
+#define SLOT_HEAD_LEN 24
+#define WAIT_SLICE_MS 100  // 等待对方时每隔这么久检查一次对方是否还活着
+
+enum { CONSUMER_FREE, CONSUMER_ATTACHING, CONSUMER_ACTIVE };
+
+// 每个消费者独占一个 cache line，游标的更新不会互相干扰
+struct ring_consumer {
+  uint32_t state;   // CONSUMER_*
+  uint32_t policy;  // enum shared_ring_policy
+  int32_t pid;
+  uint32_t pad;
+  uint64_t cursor;  // 下一个要读的包的序号
+  uint64_t packets;
+  uint64_t drops;
+} __attribute__((aligned(64)));
+
+struct ring_header {
+  uint32_t magic;
+  uint32_t slots;
+  uint32_t slot_bytes;
+  uint32_t closed;
+  uint64_t size;  // 整个映射的字节数
+  int32_t producer_pid;
+  uint32_t attach_gen;  // 每挂上一个消费者加 1，生产者据此重新检查游标
+
+  // 生产者写
+  uint64_t head __attribute__((aligned(64)));  // 已发布的包数
+  uint64_t waits;
+  uint32_t data_seq;  // 新数据的 futex
+
+  // 消费者写
+  uint32_t data_waiters __attribute__((aligned(64)));
+  uint32_t space_seq;  // 空间的 futex
+  uint32_t producer_waiting;
+
+  struct ring_consumer consumers[SHARED_RING_MAX_CONSUMERS];
+};
+
+// 槽位：seq 为 0 表示正在写，否则为包的序号加 1
+struct ring_slot {
+  uint64_t seq;
+  uint32_t caplen;
+  uint32_t len;
+  uint64_t ts_ns;
+  uint8_t data[];
+};
+
+_Static_assert(sizeof(struct ring_slot) == SLOT_HEAD_LEN, "ring_slot layout");
+
+struct shared_ring {
+  char name[NAME_MAX];
+  struct ring_header* hdr;
+  uint8_t* slots;
+  uint32_t gen;        // 上次检查游标时的 attach_gen
+  uint64_t block_min;  // SHARED_RING_BLOCK 消费者游标最小值的下界
+};
+
+struct shared_ring_consumer {
+  struct ring_header* hdr;
+  struct ring_consumer* self;
+  uint8_t* slots;
+  uint8_t* buf;  // 包被复制到这里
+};
+
+static long futex(uint32_t* addr, int op, uint32_t val, int timeout_ms) {
+  struct timespec ts = {timeout_ms / 1000, (timeout_ms % 1000) * 1000000L};
+  return syscall(SYS_futex, addr, op, val, timeout_ms < 0 ? NULL : &ts, NULL,
+                 0);
+}
+
+static uint64_t monotonic_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static struct ring_slot* slot_at(uint8_t* slots, const struct ring_header* hdr,
+                                 uint64_t seq) {
+  return (struct ring_slot*)(slots +
+                             (seq & (hdr->slots - 1)) * hdr->slot_bytes);
+}
+
+static int process_gone(int32_t pid) {
+  return kill(pid, 0) < 0 && errno == ESRCH;
+}
+
+struct shared_ring* shared_ring_create(const char* name,
+                                       const struct shared_ring_config* config) {
+  struct shared_ring_config def = SHARED_RING_CONFIG_DEFAULT;
+  struct shared_ring* ring;
+  struct ring_header* hdr;
+  size_t head_len, size;
+  int fd;
+
+  if (!config) config = &def;
+  if (!config->slots || (config->slots & (config->slots - 1)) ||
+      config->slot_bytes <= SLOT_HEAD_LEN || config->slot_bytes % 8 ||
+      strlen(name) >= NAME_MAX)
+    return NULL;
+  head_len = (sizeof(struct ring_header) + 4095) & ~(size_t)4095;
+  size = head_len + (size_t)config->slots * config->slot_bytes;
+
+  // 替换同名的旧环：已挂在旧环上的消费者不受影响，直到它们摘下
+  shm_unlink(name);
+  fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+  if (fd < 0) return NULL;
+  if (ftruncate(fd, size) < 0) {
+    close(fd);
+    shm_unlink(name);
+    return NULL;
+  }
+  hdr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (hdr == MAP_FAILED) {
+    shm_unlink(name);
+    return NULL;
+  }
+
+  ring = calloc(1, sizeof(*ring));
+  if (!ring) {
+    munmap(hdr, size);
+    shm_unlink(name);
+    return NULL;
+  }
+  strcpy(ring->name, name);
+  ring->hdr = hdr;
+  ring->slots = (uint8_t*)hdr + head_len;
+  ring->block_min = UINT64_MAX;
+  // ftruncate 出来的内存全是 0，所有槽位的 seq 都表示还没写过
+  hdr->slots = config->slots;
+  hdr->slot_bytes = config->slot_bytes;
+  hdr->size = size;
+  hdr->producer_pid = getpid();
+  __atomic_store_n(&hdr->magic, RING_MAGIC, __ATOMIC_RELEASE);
+  return ring;
+}
+
+uint32_t shared_ring_snaplen(const struct shared_ring* ring) {
+  return ring->hdr->slot_bytes - SLOT_HEAD_LEN;
+}
+
+// SHARED_RING_BLOCK 消费者中最小的游标，没有这样的消费者时为 UINT64_MAX
+static uint64_t scan_block_min(struct ring_header* hdr, int reap) {
+  uint64_t min = UINT64_MAX;
+
+  for (int i = 0; i < SHARED_RING_MAX_CONSUMERS; ++i) {
+    struct ring_consumer* c = &hdr->consumers[i];
+    if (__atomic_load_n(&c->state, __ATOMIC_ACQUIRE) != CONSUMER_ACTIVE ||
+        c->policy != SHARED_RING_BLOCK)
+      continue;
+    // 没有摘下就退出的进程，由生产者替它摘下
+    if (reap && process_gone(c->pid)) {
+      uint32_t active = CONSUMER_ACTIVE;
+      __atomic_compare_exchange_n(&c->state, &active, CONSUMER_FREE, 0,
+                                  __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+      continue;
+    }
+    uint64_t cursor = __atomic_load_n(&c->cursor, __ATOMIC_ACQUIRE);
+    if (cursor < min) min = cursor;
+  }
+  return min;
+}
+
+/**
+ * @brief 等到序号为 seq 的包可以覆盖它所在的槽位
+ *
+ * 槽位里原来是 seq - slots 号包，所有 SHARED_RING_BLOCK 消费者的游标都
+ * 越过它之后才能写。
+ */
+static void wait_for_space(struct shared_ring* ring, uint64_t seq) {
+  struct ring_header* hdr = ring->hdr;
+  uint64_t oldest = seq - hdr->slots;
+  int reap = 0, waited = 0;
+
+  for (;;) {
+    ring->block_min = scan_block_min(hdr, reap);
+    if (oldest < ring->block_min) break;
+    if (!waited) {
+      __atomic_store_n(&hdr->waits, hdr->waits + 1, __ATOMIC_RELAXED);
+      waited = 1;
+    }
+    __atomic_store_n(&hdr->producer_waiting, 1, __ATOMIC_SEQ_CST);
+    uint32_t v = __atomic_load_n(&hdr->space_seq, __ATOMIC_SEQ_CST);
+    // 置位之后再看一次，消费者可能在置位之前已经前进
+    if (oldest < scan_block_min(hdr, 0)) continue;
+    reap = futex(&hdr->space_seq, FUTEX_WAIT, v, WAIT_SLICE_MS) < 0 &&
+           errno == ETIMEDOUT;
+  }
+  __atomic_store_n(&hdr->producer_waiting, 0, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief 发布一个包
+ *
+ * 槽位按 seqlock 的方式写：先把 seq 清零，写完数据再填上序号，最后推进
+ * head。只有在可能覆盖 SHARED_RING_BLOCK 消费者未读的包时才去看它们的
+ * 游标，平时每个包只多读一次 attach_gen。
+ */
+void shared_ring_publish(struct shared_ring* ring, const void* data,
+                         uint32_t caplen, uint32_t len, uint64_t ts_ns) {
+  struct ring_header* hdr = ring->hdr;
+  uint64_t seq = hdr->head;
+  uint32_t gen = __atomic_load_n(&hdr->attach_gen, __ATOMIC_ACQUIRE);
+  struct ring_slot* slot;
+
+  if (seq >= hdr->slots &&
+      (gen != ring->gen || seq - hdr->slots >= ring->block_min)) {
+    ring->gen = gen;
+    wait_for_space(ring, seq);
+  }
+
+  if (caplen > hdr->slot_bytes - SLOT_HEAD_LEN)
+    caplen = hdr->slot_bytes - SLOT_HEAD_LEN;
+  slot = slot_at(ring->slots, hdr, seq);
+  __atomic_store_n(&slot->seq, 0, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  slot->caplen = caplen;
+  slot->len = len;
+  slot->ts_ns = ts_ns;
+  memcpy(slot->data, data, caplen);
+  __atomic_store_n(&slot->seq, seq + 1, __ATOMIC_RELEASE);
+  __atomic_store_n(&hdr->head, seq + 1, __ATOMIC_SEQ_CST);
+
+  // 与消费者的 data_waiters 构成 Dekker 式的握手，没人等时不进内核
+  if (__atomic_load_n(&hdr->data_waiters, __ATOMIC_SEQ_CST)) {
+    __atomic_add_fetch(&hdr->data_seq, 1, __ATOMIC_SEQ_CST);
+    futex(&hdr->data_seq, FUTEX_WAKE, INT_MAX, -1);
+  }
+}
+
+void shared_ring_stats(const struct shared_ring* ring, uint64_t* published,
+                       uint64_t* waits, int* consumers) {
+  const struct ring_header* hdr = ring->hdr;
+
+  *published = hdr->head;
+  *waits = __atomic_load_n(&hdr->waits, __ATOMIC_RELAXED);
+  *consumers = 0;
+  for (int i = 0; i < SHARED_RING_MAX_CONSUMERS; ++i)
+    if (__atomic_load_n(&hdr->consumers[i].state, __ATOMIC_RELAXED) ==
+        CONSUMER_ACTIVE)
+      ++*consumers;
+}
+
+void shared_ring_destroy(struct shared_ring* ring) {
+  struct ring_header* hdr;
+
+  if (!ring) return;
+  hdr = ring->hdr;
+  __atomic_store_n(&hdr->closed, 1, __ATOMIC_SEQ_CST);
+  __atomic_add_fetch(&hdr->data_seq, 1, __ATOMIC_SEQ_CST);
+  futex(&hdr->data_seq, FUTEX_WAKE, INT_MAX, -1);
+  munmap(hdr, hdr->size);
+  shm_unlink(ring->name);
+  free(ring);
+}
+
+struct shared_ring_consumer* shared_ring_attach(const char* name,
+                                                enum shared_ring_policy policy) {
+  struct shared_ring_consumer* consumer;
+  struct ring_header* hdr;
+  struct stat st;
+  int fd = shm_open(name, O_RDWR | O_CLOEXEC, 0);
+
+  if (fd < 0) return NULL;
+  if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(*hdr)) {
+    close(fd);
+    return NULL;
+  }
+  hdr = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (hdr == MAP_FAILED) return NULL;
+  if (__atomic_load_n(&hdr->magic, __ATOMIC_ACQUIRE) != RING_MAGIC ||
+      hdr->size != (uint64_t)st.st_size)
+    goto fail;
+
+  consumer = calloc(1, sizeof(*consumer));
+  if (!consumer) goto fail;
+  consumer->hdr = hdr;
+  consumer->slots = (uint8_t*)hdr + (hdr->size - (uint64_t)hdr->slots *
+                                                     hdr->slot_bytes);
+  consumer->buf = malloc(hdr->slot_bytes);
+  if (!consumer->buf) {
+    free(consumer);
+    goto fail;
+  }
+
+  // 占一个空位；没有空位时回收已经退出的进程留下的位置
+  for (int reap = 0; reap < 2 && !consumer->self; ++reap) {
+    for (int i = 0; i < SHARED_RING_MAX_CONSUMERS; ++i) {
+      struct ring_consumer* c = &hdr->consumers[i];
+      uint32_t expect = CONSUMER_FREE;
+      if (reap) {
+        if (__atomic_load_n(&c->state, __ATOMIC_ACQUIRE) != CONSUMER_ACTIVE ||
+            !process_gone(c->pid))
+          continue;
+        expect = CONSUMER_ACTIVE;
+      }
+      if (__atomic_compare_exchange_n(&c->state, &expect, CONSUMER_ATTACHING,
+                                      0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+        consumer->self = c;
+        break;
+      }
+    }
+  }
+  if (!consumer->self) {
+    free(consumer->buf);
+    free(consumer);
+    goto fail;
+  }
+
+  struct ring_consumer* c = consumer->self;
+  c->policy = policy;
+  c->pid = getpid();
+  c->packets = 0;
+  c->drops = 0;
+  c->cursor = __atomic_load_n(&hdr->head, __ATOMIC_ACQUIRE);
+  __atomic_store_n(&c->state, CONSUMER_ACTIVE, __ATOMIC_RELEASE);
+  __atomic_add_fetch(&hdr->attach_gen, 1, __ATOMIC_SEQ_CST);
+  return consumer;
+
+fail:
+  munmap(hdr, st.st_size);
+  return NULL;
+}
+
+// 游标前进后，如果生产者在等空间就叫醒它
+static void advance(struct shared_ring_consumer* consumer, uint64_t cursor) {
+  struct ring_header* hdr = consumer->hdr;
+
+  __atomic_store_n(&consumer->self->cursor, cursor, __ATOMIC_SEQ_CST);
+  if (consumer->self->policy == SHARED_RING_BLOCK &&
+      __atomic_load_n(&hdr->producer_waiting, __ATOMIC_SEQ_CST)) {
+    __atomic_add_fetch(&hdr->space_seq, 1, __ATOMIC_SEQ_CST);
+    futex(&hdr->space_seq, FUTEX_WAKE, 1, -1);
+  }
+}
+
+/**
+ * @brief 取出下一个包
+ *
+ * 复制前后各读一次槽位的 seq，两次都等于期望的序号才说明复制期间没有被
+ * 生产者覆盖；落后超过一整圈时直接跳到最旧的有效包，跳过的计入 drops。
+ */
+int shared_ring_read(struct shared_ring_consumer* consumer,
+                     struct tpacket_packet* packet, int timeout_ms) {
+  struct ring_header* hdr = consumer->hdr;
+  struct ring_consumer* self = consumer->self;
+  uint64_t deadline = timeout_ms > 0 ? monotonic_ms() + timeout_ms : 0;
+  uint64_t cursor = self->cursor;
+
+  for (;;) {
+    uint64_t head = __atomic_load_n(&hdr->head, __ATOMIC_ACQUIRE);
+
+    if (cursor < head) {
+      if (head - cursor > hdr->slots) {
+        self->drops += head - hdr->slots - cursor;
+        cursor = head - hdr->slots;
+        advance(consumer, cursor);
+      }
+      struct ring_slot* slot = slot_at(consumer->slots, hdr, cursor);
+      uint64_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+      // 正在被覆盖，重新读 head 后会按落后一整圈处理
+      if (seq != cursor + 1) continue;
+      uint32_t caplen = slot->caplen;
+      if (caplen > hdr->slot_bytes - SLOT_HEAD_LEN)
+        caplen = hdr->slot_bytes - SLOT_HEAD_LEN;
+      packet->caplen = caplen;
+      packet->len = slot->len;
+      packet->ts_ns = slot->ts_ns;
+      memcpy(consumer->buf, slot->data, caplen);
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+      if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != seq) continue;
+
+      packet->data = consumer->buf;
+      self->packets++;
+      advance(consumer, cursor + 1);
+      return 1;
+    }
+
+    // 生产者没有 destroy 就退出时，也当作结束
+    if (__atomic_load_n(&hdr->closed, __ATOMIC_ACQUIRE) ||
+        process_gone(hdr->producer_pid))
+      return -1;
+    int wait = WAIT_SLICE_MS;
+    if (timeout_ms == 0) return 0;
+    if (timeout_ms > 0) {
+      uint64_t now = monotonic_ms();
+      if (now >= deadline) return 0;
+      if (deadline - now < WAIT_SLICE_MS) wait = (int)(deadline - now);
+    }
+    __atomic_add_fetch(&hdr->data_waiters, 1, __ATOMIC_SEQ_CST);
+    uint32_t v = __atomic_load_n(&hdr->data_seq, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&hdr->head, __ATOMIC_SEQ_CST) == cursor &&
+        !__atomic_load_n(&hdr->closed, __ATOMIC_SEQ_CST))
+      futex(&hdr->data_seq, FUTEX_WAIT, v, wait);
+    __atomic_sub_fetch(&hdr->data_waiters, 1, __ATOMIC_SEQ_CST);
+  }
+}
+
+void shared_ring_consumer_stats(const struct shared_ring_consumer* consumer,
+                                uint64_t* packets, uint64_t* drops) {
+  *packets = consumer->self->packets;
+  *drops = consumer->self->drops;
+}
+
+void shared_ring_detach(struct shared_ring_consumer* consumer) {
+  struct ring_header* hdr;
+
+  if (!consumer) return;
+  hdr = consumer->hdr;
+  __atomic_store_n(&consumer->self->state, CONSUMER_FREE, __ATOMIC_SEQ_CST);
+  // 生产者可能正在等这个消费者
+  if (__atomic_load_n(&hdr->producer_waiting, __ATOMIC_SEQ_CST)) {
+    __atomic_add_fetch(&hdr->space_seq, 1, __ATOMIC_SEQ_CST);
+    futex(&hdr->space_seq, FUTEX_WAKE, 1, -1);
+  }
+  munmap(hdr, hdr->size);
+  free(consumer->buf);
+  free(consumer);
+}
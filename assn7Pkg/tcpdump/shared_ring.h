@@ -0,0 +1,111 @@
+#ifndef SHARED_RING_H
+#define SHARED_RING_H
+#include <stdint.h>
+
+#include "tpacket_ring.h"
+
+// 共享内存中的单生产者/多消费者包环
+//
+// 抓包进程作为唯一的生产者，把包依次写进 POSIX 共享内存（/dev/shm/<name>）
+// 中的定长槽位；多个分析进程按名字挂上来，各自维护自己的读游标，互不影响，
+// 内核里的抓包只做一次。生产者与消费者之间只通过原子变量交接，不加锁；
+// 等待新数据或等待空间时使用进程间共享的 futex，只有真正有人在等时才唤醒。
+//
+// 每个消费者挂上时选择背压策略：
+//   SHARED_RING_DROP_OLDEST  生产者从不等它；它落后超过一整圈时，被覆盖的
+//                            包计入它的 drops，游标跳到仍然有效的最旧的包
+//   SHARED_RING_BLOCK        生产者在覆盖它还没读的槽位之前等待；进程退出
+//                            而没有摘下时，生产者会发现并替它摘下
+//
+// 消费者可以在运行中随时挂上与摘下，挂上后从当时最新的包开始读。
+
+#define SHARED_RING_MAX_CONSUMERS 16
+
+enum shared_ring_policy {
+  SHARED_RING_DROP_OLDEST,
+  SHARED_RING_BLOCK,
+};
+
+struct shared_ring_config {
+  unsigned int slots;       // 槽位数，2 的幂
+  unsigned int slot_bytes;  // 每个槽位的字节数，含 24 字节的槽位头
+};
+
+// 默认：64K 个 2KiB 的槽位，每包最多保留 2024 字节
+#define SHARED_RING_CONFIG_DEFAULT \
+  { 1U << 16, 2048 }
+
+struct shared_ring;
+struct shared_ring_consumer;
+
+/**
+ * @brief 创建共享内存并作为生产者打开，同名的旧环会被替换
+ * @param name 共享内存名称，形如 "/capture0"
+ * @param config 参数，NULL 表示使用 SHARED_RING_CONFIG_DEFAULT
+ * @return 成功返回句柄，失败返回 NULL
+ */
+struct shared_ring* shared_ring_create(const char* name,
+                                       const struct shared_ring_config* config);
+
+/**
+ * @brief 每个包最多能放下的字节数，更长的包在 publish 时被截断
+ */
+uint32_t shared_ring_snaplen(const struct shared_ring* ring);
+
+/**
+ * @brief 发布一个包，只能在一个线程中调用
+ *
+ * 有 SHARED_RING_BLOCK 的消费者还没读完要覆盖的槽位时，在这里等待。
+ */
+void shared_ring_publish(struct shared_ring* ring, const void* data,
+                         uint32_t caplen, uint32_t len, uint64_t ts_ns);
+
+/**
+ * @brief 读取生产者的计数
+ * @param published 发布过的包数
+ * @param waits 因 SHARED_RING_BLOCK 的消费者而等待的次数
+ * @param consumers 当前挂着的消费者数
+ */
+void shared_ring_stats(const struct shared_ring* ring, uint64_t* published,
+                       uint64_t* waits, int* consumers);
+
+/**
+ * @brief 标记环已结束并唤醒所有消费者，然后删除共享内存的名字
+ *
+ * 已经挂着的消费者读完剩余的包后得到结束，映射在它们摘下之前一直有效。
+ */
+void shared_ring_destroy(struct shared_ring* ring);
+
+/**
+ * @brief 作为消费者挂到一个已有的环上
+ * @return 成功返回句柄，环不存在或消费者已满返回 NULL
+ */
+struct shared_ring_consumer* shared_ring_attach(const char* name,
+                                                enum shared_ring_policy policy);
+
+/**
+ * @brief 取出下一个包
+ *
+ * 包被复制到消费者私有的缓冲区，packet->data 在下一次调用 shared_ring_read
+ * 或 shared_ring_detach 之前有效。
+ *
+ * @param timeout_ms 最长等待时间，-1 表示一直等待
+ * @return 有包返回 1，超时返回 0，生产者已结束且没有剩余的包返回 -1
+ */
+int shared_ring_read(struct shared_ring_consumer* consumer,
+                     struct tpacket_packet* packet, int timeout_ms);
+
+/**
+ * @brief 读取消费者的计数
+ * @param packets 读到的包数
+ * @param drops 落后太多而被覆盖的包数
+ */
+void shared_ring_consumer_stats(const struct shared_ring_consumer* consumer,
+                                uint64_t* packets, uint64_t* drops);
+
+/**
+ * @brief 摘下消费者，唤醒可能在等它的生产者
+ */
+void shared_ring_detach(struct shared_ring_consumer* consumer);
+
+#endif
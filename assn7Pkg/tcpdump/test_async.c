@@ -0,0 +1,138 @@
+// Async capture test: two captures on lo driven by one epoll loop in one
+// thread. One stops at a packet count, the other at a deadline, while a
+// generator thread keeps sending to both ports. Needs root.
+//
+// build: cc -O2 test_async.c custom_tcpdump_async.c tpacket_ring.c
+//        filter_cache.c -lpcap -lpthread
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "custom_tcpdump_async.h"
+
+#define COUNT_LIMIT 1000
+#define DURATION_MS 500
+
+struct counter {
+  uint64_t packets;
+  uint64_t batches;
+};
+
+static volatile int sending = 1;
+static int ports[2];
+
+static double now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static void on_batch(const struct tpacket_packet* packets, size_t count,
+                     void* user) {
+  struct counter* c = user;
+  (void)packets;
+  c->packets += count;
+  c->batches++;
+}
+
+// 两个端口上各有一个不读取的接收端，避免 ICMP 端口不可达
+static int bind_port(int* port) {
+  struct sockaddr_in addr = {.sin_family = AF_INET,
+                             .sin_addr.s_addr = htonl(INADDR_LOOPBACK)};
+  socklen_t len = sizeof(addr);
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  bind(fd, (struct sockaddr*)&addr, sizeof(addr));
+  getsockname(fd, (struct sockaddr*)&addr, &len);
+  *port = ntohs(addr.sin_port);
+  return fd;
+}
+
+static void* generate(void* arg) {
+  struct sockaddr_in dst = {.sin_family = AF_INET,
+                            .sin_addr.s_addr = htonl(INADDR_LOOPBACK)};
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  char payload[64] = {0};
+  (void)arg;
+  while (sending) {
+    for (int i = 0; i < 2; ++i) {
+      dst.sin_port = htons(ports[i]);
+      sendto(fd, payload, sizeof(payload), 0, (struct sockaddr*)&dst,
+             sizeof(dst));
+    }
+    usleep(100);
+  }
+  close(fd);
+  return NULL;
+}
+
+int main(void) {
+  int sinks[2] = {bind_port(&ports[0]), bind_port(&ports[1])};
+  struct custom_tcpdump_limits by_count = {.max_packets = COUNT_LIMIT};
+  struct custom_tcpdump_limits by_time = {.duration_ms = DURATION_MS};
+  struct counter counters[2] = {{0, 0}, {0, 0}};
+  struct custom_tcpdump_async* captures[2];
+  char filter[2][64];
+  double stopped_at[2] = {0, 0};
+
+  for (int i = 0; i < 2; ++i)
+    snprintf(filter[i], sizeof(filter[i]), "udp dst port %d", ports[i]);
+  double start = now_ms();
+  captures[0] = custom_tcpdump_async_start("lo", filter[0], &by_count,
+                                           on_batch, &counters[0]);
+  // 计时从 start 返回时开始，不含打开环的时间
+  double timed_start = now_ms() - start;
+  captures[1] = custom_tcpdump_async_start("lo", filter[1], &by_time,
+                                           on_batch, &counters[1]);
+  double timed_ready = now_ms() - start;
+  if (!captures[0] || !captures[1]) return 1;
+
+  int epfd = epoll_create1(0);
+  for (int i = 0; i < 2; ++i) {
+    struct epoll_event ev = {.events = EPOLLIN, .data.u32 = i};
+    epoll_ctl(epfd, EPOLL_CTL_ADD, custom_tcpdump_async_fd(captures[i]), &ev);
+  }
+
+  pthread_t gen;
+  pthread_create(&gen, NULL, generate, NULL);
+  int running = 2;
+  while (running && now_ms() - start < 10000) {
+    struct epoll_event evs[2];
+    int n = epoll_wait(epfd, evs, 2, 100);
+    for (int i = 0; i < n; ++i) {
+      int id = evs[i].data.u32;
+      if (stopped_at[id]) continue;
+      if (custom_tcpdump_async_poll(captures[id]) <= 0) {
+        stopped_at[id] = now_ms() - start;
+        epoll_ctl(epfd, EPOLL_CTL_DEL, custom_tcpdump_async_fd(captures[id]),
+                  NULL);
+        --running;
+      }
+    }
+  }
+  sending = 0;
+  pthread_join(gen, NULL);
+
+  for (int i = 0; i < 2; ++i) {
+    printf("capture %d: %llu packets in %llu batches, stopped at %.0f ms\n",
+           i, (unsigned long long)counters[i].packets,
+           (unsigned long long)counters[i].batches, stopped_at[i]);
+    custom_tcpdump_async_stop(captures[i]);
+    close(sinks[i]);
+  }
+  if (running || counters[0].packets != COUNT_LIMIT ||
+      stopped_at[1] - timed_start < DURATION_MS ||
+      stopped_at[1] - timed_ready > DURATION_MS + 200 ||
+      counters[1].packets == 0) {
+    fprintf(stderr, "async capture limits not honoured\n");
+    return 1;
+  }
+  printf("Async capture limits honoured\n");
+  return 0;
+}
@@ -0,0 +1,187 @@
+// Capture result test on lo: a generator sends a known number of packets to a
+// filtered port, some packets to another port and one datagram larger than
+// the snaplen. With a large buffer every matching packet is received, the big
+// one is counted as truncated, the other port shows up as filtered and the
+// timestamps are in ns. With a small buffer the packets that arrived after it
+// filled are reported as buffer_drops. The header and flow captures return 1
+// when their arrays overflow, and the flow that fit keeps its full count.
+// Needs root.
+//
+// build: cc -O2 test_capture_result.c custom_tcpdump.c custom_tcpdump_ring.c
+//        custom_tcpdump_xdp.c custom_tcpdump_headers.c tpacket_ring.c
+//        xdp_capture.c filter_cache.c pcapng_buf.c header_record.c
+//        flow_table.c -lpcap -lpthread
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "custom_tcpdump.h"
+#include "custom_tcpdump_headers.h"
+#include "custom_tcpdump_ring.h"
+#include "custom_tcpdump_xdp.h"
+
+#define MATCHING 2000
+#define OTHER 500
+#define BIG 65507  // 最大的 UDP 载荷，帧长超过 65535
+
+static int ports[2];
+
+static int bind_port(int* port) {
+  struct sockaddr_in addr = {.sin_family = AF_INET,
+                             .sin_addr.s_addr = htonl(INADDR_LOOPBACK)};
+  socklen_t len = sizeof(addr);
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  bind(fd, (struct sockaddr*)&addr, sizeof(addr));
+  getsockname(fd, (struct sockaddr*)&addr, &len);
+  *port = ntohs(addr.sin_port);
+  return fd;
+}
+
+static void* generate(void* arg) {
+  struct sockaddr_in dst = {.sin_family = AF_INET,
+                            .sin_addr.s_addr = htonl(INADDR_LOOPBACK)};
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  char* payload = calloc(1, BIG);
+  (void)arg;
+
+  usleep(300000);  // 等抓包端就绪
+  for (int i = 0; i < MATCHING; ++i) {
+    dst.sin_port = htons(ports[0]);
+    sendto(fd, payload, 200, 0, (struct sockaddr*)&dst, sizeof(dst));
+    if (i < OTHER) {
+      dst.sin_port = htons(ports[1]);
+      sendto(fd, payload, 200, 0, (struct sockaddr*)&dst, sizeof(dst));
+    }
+    if (i % 100 == 0) usleep(1000);
+  }
+  dst.sin_port = htons(ports[0]);
+  sendto(fd, payload, BIG, 0, (struct sockaddr*)&dst, sizeof(dst));
+  close(fd);
+  free(payload);
+  return NULL;
+}
+
+typedef int (*capture_fn)(const char*, const char*, void*, size_t,
+                          struct custom_tcpdump_result*);
+
+static int run(const char* name, capture_fn fn, size_t size,
+               struct custom_tcpdump_result* r) {
+  void* buf = aligned_alloc(PCAPNG_BUF_ALIGN, size);
+  char filter[64];
+  pthread_t gen;
+  int ret;
+
+  snprintf(filter, sizeof(filter), "udp dst port %d", ports[0]);
+  memset(r, 0, sizeof(*r));
+  pthread_create(&gen, NULL, generate, NULL);
+  ret = fn("lo", filter, buf, size, r);
+  pthread_join(gen, NULL);
+  printf("%s: received %llu kernel_drops %llu buffer_drops %llu truncated "
+         "%llu filtered %llu ts_resolution_ns %u\n",
+         name, (unsigned long long)r->received,
+         (unsigned long long)r->kernel_drops,
+         (unsigned long long)r->buffer_drops,
+         (unsigned long long)r->truncated, (unsigned long long)r->filtered,
+         r->ts_resolution_ns);
+  if (ret != 0) {
+    free(buf);
+    return ret;
+  }
+
+  // 时间戳不减，且确实带有 µs 以下的部分
+  uint32_t count = 0, sub_us = 0;
+  const struct pcapng_index_entry* idx = pcapng_buf_index(buf, &count);
+  for (uint32_t i = 0; idx && i < count; ++i) {
+    if (i && idx[i].ts_ns < idx[i - 1].ts_ns) ret = 1;
+    if (idx[i].ts_ns % 1000) ++sub_us;
+  }
+  if (!idx || count != r->received) ret = 1;
+  if (r->ts_resolution_ns == 1 && count > 10 && sub_us == 0) ret = 1;
+  free(buf);
+  return ret;
+}
+
+static int check_full(const char* name, capture_fn fn) {
+  struct custom_tcpdump_result r;
+  int ret = run(name, fn, 64U << 20, &r);
+
+  if (ret == -1 && fn == custom_tcpdump_capture_ex) {
+    printf("%s: skipped, libpcap could not open lo\n", name);
+    return 0;
+  }
+  return ret != 0 || r.received != MATCHING + 1 || r.kernel_drops ||
+         r.buffer_drops || r.truncated != 1 || r.filtered < OTHER;
+}
+
+// 只能放下一半的记录：写满后返回 1，已写入的记录仍然有效
+static int check_headers_full(void) {
+  struct header_record* records = calloc(MATCHING / 2, sizeof(*records));
+  char filter[64];
+  pthread_t gen;
+  size_t n = 0;
+  int ret;
+
+  snprintf(filter, sizeof(filter), "udp dst port %d", ports[0]);
+  pthread_create(&gen, NULL, generate, NULL);
+  ret = custom_tcpdump_capture_headers("lo", filter, 0, records, MATCHING / 2,
+                                       &n);
+  pthread_join(gen, NULL);
+  printf("headers_small: ret %d records %zu\n", ret, n);
+  ret = ret != 1 || n != MATCHING / 2 || records[n - 1].dst_port != ports[0];
+  free(records);
+  return ret;
+}
+
+// 只能放下一条流：另一个端口的流被丢弃并返回 1，先出现的流照常计数到最后
+static int check_flows_full(void) {
+  struct flow_record flow;
+  char filter[64];
+  pthread_t gen;
+  size_t n = 0;
+  int ret;
+
+  snprintf(filter, sizeof(filter), "udp dst port %d or udp dst port %d",
+           ports[0], ports[1]);
+  pthread_create(&gen, NULL, generate, NULL);
+  ret = custom_tcpdump_capture_flows("lo", filter, &flow, 1, &n);
+  pthread_join(gen, NULL);
+  printf("flows_small: ret %d flows %zu packets %llu\n", ret, n,
+         n ? (unsigned long long)flow.packets : 0ULL);
+  return ret != 1 || n != 1 || flow.key.dst_port != ports[0] ||
+         flow.packets != MATCHING + 1;
+}
+
+int main(void) {
+  int sinks[2] = {bind_port(&ports[0]), bind_port(&ports[1])};
+  struct custom_tcpdump_result r;
+  int failed = 0;
+
+  failed |= check_full("pcap", custom_tcpdump_capture_ex);
+  failed |= check_full("ring", custom_tcpdump_capture_ring_ex) << 1;
+  failed |= check_full("xdp", custom_tcpdump_capture_xdp_ex) << 2;
+
+  // 约能放下一半的包：buffer 满时已经到达的包计入 buffer_drops，之后到达
+  // 的包不会再被看到
+  if (run("ring_small", custom_tcpdump_capture_ring_ex,
+          MATCHING / 2 * (32 + 14 + 20 + 8 + 200 + 24), &r) != 0 ||
+      r.received + r.kernel_drops + r.buffer_drops > MATCHING + 1 ||
+      r.received >= MATCHING || r.buffer_drops == 0)
+    failed |= 8;
+  failed |= check_headers_full() << 4;
+  failed |= check_flows_full() << 5;
+
+  close(sinks[0]);
+  close(sinks[1]);
+  if (failed) {
+    fprintf(stderr, "capture result checks failed: %#x\n", failed);
+    return 1;
+  }
+  printf("capture results ok\n");
+  return 0;
+}
@@ -0,0 +1,88 @@
+// filter_cache: a cache capped at a few entries keeps serving correct programs
+// while many more filters pass through it. A program that is still held is
+// never evicted (getting it again returns the same pointer), and a filter
+// that was evicted compiles to the same instructions when it comes back.
+//
+// build: cc -O2 test_filter_cache.c filter_cache.c -lpcap -lpthread
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "filter_cache.h"
+
+#define MAX_ENTRIES 4
+#define FILTERS 64
+
+#define CHECK(cond)                                              \
+  do {                                                           \
+    if (!(cond)) {                                               \
+      fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #cond); \
+      return 1;                                                  \
+    }                                                            \
+  } while (0)
+
+static void filter_name(char* buf, size_t size, int i) {
+  snprintf(buf, size, "udp dst port %d", 1000 + i);
+}
+
+int main(void) {
+  struct filter_cache* cache = filter_cache_create(MAX_ENTRIES);
+  const struct sock_fprog *held, *prog;
+  struct sock_filter* first;
+  unsigned short first_len;
+  char name[64];
+
+  CHECK(cache);
+  filter_name(name, sizeof(name), 0);
+  held = filter_cache_get(cache, name, 65535, 0);
+  CHECK(held && held->len > 0);
+  first_len = held->len;
+  first = malloc(first_len * sizeof(*first));
+  memcpy(first, held->filter, first_len * sizeof(*first));
+
+  // 远多于上限的过滤器流过缓存，被取出的那个始终留着
+  for (int i = 1; i < FILTERS; ++i) {
+    filter_name(name, sizeof(name), i);
+    prog = filter_cache_get(cache, name, 65535, i % 2);
+    CHECK(prog && prog->len > 0);
+    filter_cache_put(cache, prog);
+    filter_name(name, sizeof(name), 0);
+    prog = filter_cache_get(cache, name, 65535, 0);
+    CHECK(prog == held);
+    filter_cache_put(cache, prog);
+  }
+  CHECK(memcmp(held->filter, first, first_len * sizeof(*first)) == 0);
+  filter_cache_put(cache, held);
+
+  // 归还之后可以被淘汰，再次取出时重新编译，内容不变
+  for (int i = 1; i < FILTERS; ++i) {
+    filter_name(name, sizeof(name), i);
+    prog = filter_cache_get(cache, name, 65535, 0);
+    CHECK(prog);
+    filter_cache_put(cache, prog);
+  }
+  filter_name(name, sizeof(name), 0);
+  prog = filter_cache_get(cache, name, 65535, 0);
+  CHECK(prog && prog->len == first_len &&
+        memcmp(prog->filter, first, first_len * sizeof(*first)) == 0);
+  filter_cache_put(cache, prog);
+
+  // 同时取出的条目超过上限时都保留，归还后再回落到上限以内
+  const struct sock_fprog* many[MAX_ENTRIES * 2];
+  for (int i = 0; i < MAX_ENTRIES * 2; ++i) {
+    filter_name(name, sizeof(name), 100 + i);
+    many[i] = filter_cache_get(cache, name, 96, 0);
+    CHECK(many[i]);
+  }
+  for (int i = 0; i < MAX_ENTRIES * 2; ++i) {
+    filter_name(name, sizeof(name), 100 + i);
+    CHECK(filter_cache_get(cache, name, 96, 0) == many[i]);
+    filter_cache_put(cache, many[i]);
+    filter_cache_put(cache, many[i]);
+  }
+
+  free(first);
+  filter_cache_destroy(cache);
+  printf("filter cache ok\n");
+  return 0;
+}
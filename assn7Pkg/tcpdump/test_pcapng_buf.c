@@ -0,0 +1,74 @@
+// pcapng_buf round trip: append packets (some truncated) until the buffer is
+// full, then check the trailing index, the SHB length and a linear walk over
+// the blocks against each other.
+//
+// build: cc -O2 test_pcapng_buf.c pcapng_buf.c
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pcapng_buf.h"
+
+static uint32_t get32(const uint8_t* p) {
+  uint32_t v;
+  memcpy(&v, p, 4);
+  return v;
+}
+
+int main(void) {
+  size_t size = 1 << 16;
+  uint8_t* buf = aligned_alloc(PCAPNG_BUF_ALIGN, size);
+  uint8_t pkt[1500];
+  struct pcapng_writer w;
+  uint32_t appended = 0;
+
+  for (size_t i = 0; i < sizeof(pkt); ++i) pkt[i] = (uint8_t)i;
+  if (pcapng_writer_init(&w, buf, size, 1, 1500) != 0) return 1;
+  // caplen 依次为 1..，每三个包中有一个被截断
+  while (pcapng_writer_append(&w, pkt, appended % 97 + 1,
+                              appended % 97 + 1 + (appended % 3 == 0) * 100,
+                              1000000000ULL * appended + appended) == 0)
+    ++appended;
+  size_t total = pcapng_writer_finish(&w);
+
+  uint32_t count = 0;
+  const struct pcapng_index_entry* idx = pcapng_buf_index(buf, &count);
+  if (pcapng_buf_size(buf) != total || total > size || !idx ||
+      count != appended) {
+    fprintf(stderr, "bad index: size %zu/%zu count %u/%u\n",
+            pcapng_buf_size(buf), total, count, appended);
+    return 1;
+  }
+
+  // 顺序遍历所有块，EPB 的内容应与索引一致，最后一个块是索引块
+  size_t off = 0;
+  uint32_t n = 0;
+  while (off < total) {
+    uint32_t type = get32(buf + off), len = get32(buf + off + 4);
+    if (len < 12 || len % 4 || get32(buf + off + len - 4) != len) {
+      fprintf(stderr, "bad block at %zu\n", off);
+      return 1;
+    }
+    if (type == 6) {
+      uint64_t ts = (uint64_t)get32(buf + off + 12) << 32 |
+                    get32(buf + off + 16);
+      if (n >= count || idx[n].offset != off + 28 || idx[n].ts_ns != ts ||
+          idx[n].caplen != get32(buf + off + 20) ||
+          idx[n].len != get32(buf + off + 24) ||
+          memcmp(buf + idx[n].offset, pkt, idx[n].caplen) != 0) {
+        fprintf(stderr, "packet %u does not match its index entry\n", n);
+        return 1;
+      }
+      ++n;
+    }
+    off += len;
+  }
+  if (n != count || off != total) {
+    fprintf(stderr, "walked %u packets, %zu bytes\n", n, off);
+    return 1;
+  }
+  printf("pcapng buffer: %u packets, %zu of %zu bytes\n", count, total, size);
+  free(buf);
+  return 0;
+}
@@ -0,0 +1,161 @@
+// shared_ring: one producer process and several consumer processes. A
+// blocking consumer sees every packet in order; a slow drop-oldest consumer
+// sees an increasing sequence whose gaps match its drop count; a blocking
+// consumer that exits without detaching does not stall the producer; a
+// consumer that attaches and detaches repeatedly mid-run always reads in
+// order; packets longer than a slot are truncated, and every consumer sees
+// the end of the ring.
+//
+// build: cc -O2 test_shared_ring.c shared_ring.c
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "shared_ring.h"
+
+#define PACKETS 200000
+#define SLOTS 256
+#define SLOT_BYTES 128
+#define SNAPLEN (SLOT_BYTES - 24)
+
+static char name[64];
+static int ready[2];
+
+static uint64_t seq_of(const struct tpacket_packet* pkt) {
+  uint64_t seq;
+  memcpy(&seq, pkt->data, 8);
+  return seq;
+}
+
+static struct shared_ring_consumer* attach(enum shared_ring_policy policy) {
+  struct shared_ring_consumer* c = shared_ring_attach(name, policy);
+  if (!c) _exit(10);
+  if (write(ready[1], "x", 1) != 1) _exit(11);
+  return c;
+}
+
+// 读到每一个包，按顺序，长度与截断都正确
+static int run_block(void) {
+  struct shared_ring_consumer* c = attach(SHARED_RING_BLOCK);
+  struct tpacket_packet pkt;
+  uint64_t expect = 0, packets, drops;
+  int r;
+
+  while ((r = shared_ring_read(c, &pkt, -1)) == 1) {
+    uint32_t caplen = expect == PACKETS - 1 ? SNAPLEN : 8 + expect % 64;
+    if (seq_of(&pkt) != expect || pkt.caplen != caplen ||
+        pkt.len != 1000 + expect)
+      return 1;
+    ++expect;
+  }
+  shared_ring_consumer_stats(c, &packets, &drops);
+  shared_ring_detach(c);
+  return r == -1 && expect == PACKETS && packets == PACKETS && drops == 0 ? 0
+                                                                         : 2;
+}
+
+// 读得慢，跳过的包数必须与 drops 一致
+static int run_drop_oldest(void) {
+  struct shared_ring_consumer* c = attach(SHARED_RING_DROP_OLDEST);
+  struct tpacket_packet pkt;
+  uint64_t next = 0, skipped = 0, packets, drops, n = 0;
+
+  while (shared_ring_read(c, &pkt, -1) == 1) {
+    uint64_t seq = seq_of(&pkt);
+    if (seq < next) return 1;
+    skipped += seq - next;
+    next = seq + 1;
+    if (++n % 512 == 0) usleep(2000);
+  }
+  shared_ring_consumer_stats(c, &packets, &drops);
+  shared_ring_detach(c);
+  if (drops != skipped || packets + drops != PACKETS || drops == 0) {
+    fprintf(stderr, "drop_oldest: packets %llu drops %llu skipped %llu\n",
+            (unsigned long long)packets, (unsigned long long)drops,
+            (unsigned long long)skipped);
+    return 2;
+  }
+  return 0;
+}
+
+// 挂上后读几个包就退出，不摘下；由两次 fork 让 init 回收，进程真正消失
+static int run_dead(void) {
+  struct tpacket_packet pkt;
+
+  if (fork() != 0) return 0;
+  struct shared_ring_consumer* c = attach(SHARED_RING_BLOCK);
+  for (int i = 0; i < 10; ++i) shared_ring_read(c, &pkt, -1);
+  _exit(0);
+}
+
+// 反复挂上、读一些、摘下
+static int run_churn(void) {
+  struct tpacket_packet pkt;
+  int r = 1;
+
+  for (int round = 0; r != -1; ++round) {
+    struct shared_ring_consumer* c = shared_ring_attach(
+        name, round % 2 ? SHARED_RING_BLOCK : SHARED_RING_DROP_OLDEST);
+    // 环结束后名字被删除，之后挂不上
+    if (!c) return round == 0;
+    if (round == 0 && write(ready[1], "x", 1) != 1) return 1;
+    uint64_t last = 0;
+    for (int i = 0; i < 100 && (r = shared_ring_read(c, &pkt, -1)) == 1; ++i) {
+      if (i && seq_of(&pkt) <= last) return 2;
+      last = seq_of(&pkt);
+    }
+    shared_ring_detach(c);
+  }
+  return 0;
+}
+
+int main(void) {
+  struct shared_ring_config config = {SLOTS, SLOT_BYTES};
+  int (*consumers[])(void) = {run_block, run_drop_oldest, run_dead, run_churn};
+  const int nr = sizeof(consumers) / sizeof(consumers[0]);
+  pid_t pids[nr];
+  uint8_t payload[256];
+  uint64_t published, waits;
+  int attached, status, failed = 0;
+  char c;
+
+  snprintf(name, sizeof(name), "/test_shared_ring.%d", getpid());
+  struct shared_ring* ring = shared_ring_create(name, &config);
+  if (!ring || shared_ring_snaplen(ring) != SNAPLEN || pipe(ready) < 0)
+    return 1;
+
+  for (int i = 0; i < nr; ++i) {
+    pids[i] = fork();
+    if (pids[i] == 0) _exit(consumers[i]());
+  }
+  for (int i = 0; i < nr; ++i)
+    if (read(ready[0], &c, 1) != 1) return 1;
+  // run_dead 的中间进程已经退出，只剩挂在环上的孙进程
+  waitpid(pids[2], &status, 0);
+
+  memset(payload, 0xab, sizeof(payload));
+  for (uint64_t seq = 0; seq < PACKETS; ++seq) {
+    uint32_t caplen = seq == PACKETS - 1 ? sizeof(payload) : 8 + seq % 64;
+    memcpy(payload, &seq, 8);
+    shared_ring_publish(ring, payload, caplen, 1000 + seq, seq);
+  }
+  shared_ring_stats(ring, &published, &waits, &attached);
+  shared_ring_destroy(ring);
+
+  for (int i = 0; i < nr; ++i) {
+    if (i == 2) continue;
+    waitpid(pids[i], &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      fprintf(stderr, "consumer %d failed: status %d\n", i, status);
+      failed = 1;
+    }
+  }
+  if (published != PACKETS) return 1;
+  if (failed) return 1;
+  printf("shared_ring ok (%llu producer waits)\n", (unsigned long long)waits);
+  return 0;
+}
@@ -0,0 +1,321 @@
+#include "tpacket_ring.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include <net/if.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "filter_cache.h"
+
+struct tpacket_ring {
+  int fd;
+  int loopback;
+  unsigned int snaplen;
+  uint8_t* map;
+  size_t map_len;
+  unsigned int block_size;
+  unsigned int block_nr;
+  unsigned int next_block;  // 下一个要交给用户的块
+};
+
+#define TPACKET_RING_BLOCK_FRAMES 8
+#define TPACKET_RING_BLOCK_MIN (64U << 10)
+#define TPACKET_RING_BLOCK_MAX (4U << 20)
+// tpacket3_hdr、sockaddr_ll 与对齐填充，按上限估计
+#define TPACKET_RING_FRAME_OVERHEAD 128
+
+void tpacket_ring_config_size(struct tpacket_ring_config* config,
+                              size_t bytes) {
+  size_t frame = (size_t)config->snaplen + TPACKET_RING_FRAME_OVERHEAD;
+  unsigned int block = TPACKET_RING_BLOCK_MIN;
+  size_t nr;
+
+  if (!bytes) bytes = (size_t)config->block_size * config->block_nr;
+  while (block < TPACKET_RING_BLOCK_MAX &&
+         block < frame * TPACKET_RING_BLOCK_FRAMES)
+    block <<= 1;
+  nr = (bytes + block - 1) / block;
+  config->block_size = block;
+  config->block_nr = nr < 2 ? 2 : nr;
+}
+
+static int attach(int fd, const struct sock_fprog* prog) {
+  if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER, prog, sizeof(*prog)) < 0) {
+    perror("SO_ATTACH_FILTER");
+    return -1;
+  }
+  return 0;
+}
+
+static int is_loopback(int fd, const char* iface) {
+  struct ifreq ifr;
+  memset(&ifr, 0, sizeof(ifr));
+  strncpy(ifr.ifr_name, iface, IFNAMSIZ - 1);
+  if (ioctl(fd, SIOCGIFFLAGS, &ifr) < 0) return 0;
+  return (ifr.ifr_flags & IFF_LOOPBACK) != 0;
+}
+
+/**
+ * @brief 打开网卡上的抓包环
+ *
+ * socket 以协议 0 创建，在过滤器和环都就绪之后才 bind 到 ETH_P_ALL，
+ * 之前不会收到任何包，环里不会混进未经过滤的包。lo 上每个包会以
+ * PACKET_OUTGOING 和 PACKET_HOST 各出现一次，过滤器会丢掉外发的那一份。
+ */
+struct tpacket_ring* tpacket_ring_open(
+    const char* iface, const char* filter,
+    const struct tpacket_ring_config* config) {
+  struct tpacket_ring_config def = TPACKET_RING_CONFIG_DEFAULT;
+  struct tpacket_ring* ring;
+  int version = TPACKET_V3;
+
+  if (!config) config = &def;
+  unsigned int ifindex = if_nametoindex(iface);
+  if (!ifindex) {
+    fprintf(stderr, "unknown interface %s\n", iface);
+    return NULL;
+  }
+
+  ring = calloc(1, sizeof(*ring));
+  if (!ring) return NULL;
+  ring->map = MAP_FAILED;
+  ring->block_size = config->block_size;
+  ring->block_nr = config->block_nr;
+  ring->snaplen = config->snaplen;
+
+  ring->fd = socket(AF_PACKET, SOCK_RAW, 0);
+  if (ring->fd < 0) {
+    perror("socket(AF_PACKET)");
+    goto fail;
+  }
+  if (setsockopt(ring->fd, SOL_PACKET, PACKET_VERSION, &version,
+                 sizeof(version)) < 0) {
+    perror("PACKET_VERSION");
+    goto fail;
+  }
+  ring->loopback = is_loopback(ring->fd, iface);
+  if (tpacket_ring_set_filter(ring, filter) < 0) goto fail;
+
+  // V3 的帧大小只用来计算 tp_frame_nr，包在块内按实际长度紧密排列
+  struct tpacket_req3 req;
+  memset(&req, 0, sizeof(req));
+  req.tp_block_size = config->block_size;
+  req.tp_block_nr = config->block_nr;
+  req.tp_frame_size = 2048;
+  req.tp_frame_nr = req.tp_block_size / req.tp_frame_size * req.tp_block_nr;
+  req.tp_retire_blk_tov = config->retire_blk_tov;
+  if (setsockopt(ring->fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) <
+      0) {
+    perror("PACKET_RX_RING");
+    goto fail;
+  }
+
+  ring->map_len = (size_t)req.tp_block_size * req.tp_block_nr;
+  ring->map = mmap(NULL, ring->map_len, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, ring->fd, 0);
+  if (ring->map == MAP_FAILED) {
+    perror("mmap");
+    goto fail;
+  }
+
+  struct sockaddr_ll addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sll_family = AF_PACKET;
+  addr.sll_protocol = htons(ETH_P_ALL);
+  addr.sll_ifindex = ifindex;
+  if (bind(ring->fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+    perror("bind");
+    goto fail;
+  }
+
+  // 必须在 bind 之后加入，组内所有 socket 的协议与网卡要一致
+  if (config->fanout_group ||
+      (config->fanout_type & PACKET_FANOUT_FLAG_UNIQUEID)) {
+    int arg = (config->fanout_group & 0xffff) | (config->fanout_type << 16);
+    if (setsockopt(ring->fd, SOL_PACKET, PACKET_FANOUT, &arg, sizeof(arg)) <
+        0) {
+      perror("PACKET_FANOUT");
+      goto fail;
+    }
+  }
+
+  if (config->promisc) {
+    struct packet_mreq mreq;
+    memset(&mreq, 0, sizeof(mreq));
+    mreq.mr_ifindex = ifindex;
+    mreq.mr_type = PACKET_MR_PROMISC;
+    if (setsockopt(ring->fd, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &mreq,
+                   sizeof(mreq)) < 0)
+      perror("PACKET_MR_PROMISC");
+  }
+  return ring;
+
+fail:
+  tpacket_ring_close(ring);
+  return NULL;
+}
+
+static struct tpacket_block_desc* block_at(struct tpacket_ring* ring,
+                                           unsigned int i) {
+  return (struct tpacket_block_desc*)(ring->map +
+                                      (size_t)i * ring->block_size);
+}
+
+static int block_ready(const struct tpacket_block_desc* desc) {
+  return (__atomic_load_n(&desc->hdr.bh1.block_status, __ATOMIC_ACQUIRE) &
+          TP_STATUS_USER) != 0;
+}
+
+static int64_t monotonic_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+/**
+ * @brief 等待下一个可读的块
+ *
+ * 块按顺序交给用户，只需检查 next_block 的状态；块头的状态字由内核最后
+ * 写入，用 acquire 读取保证看到完整的块内容。timeout_ms 是整个调用的
+ * 期限，被信号打断或醒来后块仍未就绪时只等剩下的时间。socket 出错时
+ * poll 会一直报告 POLLERR，必须用 SO_ERROR 取出错误并返回，否则会空转。
+ */
+int tpacket_ring_next_block(struct tpacket_ring* ring,
+                            struct tpacket_block* block, int timeout_ms) {
+  struct tpacket_block_desc* desc = block_at(ring, ring->next_block);
+  int64_t deadline = timeout_ms > 0 ? monotonic_ms() + timeout_ms : 0;
+
+  while (!block_ready(desc)) {
+    struct pollfd pfd = {.fd = ring->fd, .events = POLLIN};
+    int wait = timeout_ms;
+
+    if (timeout_ms > 0) {
+      int64_t left = deadline - monotonic_ms();
+      if (left <= 0) return 0;
+      wait = (int)left;
+    }
+    int n = poll(&pfd, 1, wait);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return -1;
+    }
+    if (n == 0) return 0;
+    if ((pfd.revents & (POLLERR | POLLHUP | POLLNVAL)) && !block_ready(desc)) {
+      int err = 0;
+      socklen_t len = sizeof(err);
+      if (getsockopt(ring->fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0 || !err)
+        err = EIO;
+      errno = err;
+      return -1;
+    }
+  }
+
+  block->desc = desc;
+  block->next = (const uint8_t*)desc + desc->hdr.bh1.offset_to_first_pkt;
+  block->remaining = desc->hdr.bh1.num_pkts;
+  return 1;
+}
+
+int tpacket_block_next(struct tpacket_block* block,
+                       struct tpacket_packet* packet) {
+  const struct tpacket3_hdr* hdr;
+
+  if (!block->remaining) return 0;
+  hdr = (const struct tpacket3_hdr*)block->next;
+  packet->data = block->next + hdr->tp_mac;
+  packet->caplen = hdr->tp_snaplen;
+  packet->len = hdr->tp_len;
+  packet->ts_ns = hdr->tp_sec * 1000000000ULL + hdr->tp_nsec;
+  block->next += hdr->tp_next_offset;
+  block->remaining--;
+  return 1;
+}
+
+void tpacket_ring_release_block(struct tpacket_ring* ring,
+                                struct tpacket_block* block) {
+  struct tpacket_block_desc* desc = block->desc;
+
+  __atomic_store_n(&desc->hdr.bh1.block_status, TP_STATUS_KERNEL,
+                   __ATOMIC_RELEASE);
+  block->desc = NULL;
+  block->remaining = 0;
+  ring->next_block = (ring->next_block + 1) % ring->block_nr;
+}
+
+/**
+ * @brief 替换过滤器
+ *
+ * 编译结果取自进程内的缓存；SO_ATTACH_FILTER 在内核中以 RCU 整体替换
+ * socket 上的程序，任何一个包都只会经过旧程序或新程序之一。内核保留的
+ * 是程序的副本，挂上之后就可以归还缓存。
+ */
+int tpacket_ring_set_filter(struct tpacket_ring* ring, const char* filter) {
+  struct filter_cache* cache = filter_cache_default();
+  const struct sock_fprog* prog;
+  int ret;
+
+  if (!cache) {
+    fprintf(stderr, "filter cache: out of memory\n");
+    return -2;
+  }
+  prog = filter_cache_get(cache, filter, ring->snaplen, ring->loopback);
+  if (!prog) return -2;
+  ret = attach(ring->fd, prog) < 0 ? -3 : 0;
+  filter_cache_put(cache, prog);
+  return ret;
+}
+
+int tpacket_ring_pause(struct tpacket_ring* ring) {
+  return attach(ring->fd, filter_cache_drop_all());
+}
+
+/**
+ * @brief 归还环中所有已交给用户的块
+ *
+ * 内核每写入一个包就增加当前块的 num_pkts，当前块为空时不必等待；否则等它
+ * 超时交出后一并归还。
+ */
+void tpacket_ring_flush(struct tpacket_ring* ring, int wait_ms) {
+  struct tpacket_block block;
+
+  for (;;) {
+    struct tpacket_block_desc* desc = block_at(ring, ring->next_block);
+    uint32_t pending =
+        __atomic_load_n(&desc->hdr.bh1.num_pkts, __ATOMIC_RELAXED);
+    if (tpacket_ring_next_block(ring, &block, pending ? wait_ms : 0) <= 0)
+      return;
+    tpacket_ring_release_block(ring, &block);
+  }
+}
+
+int tpacket_ring_stats(struct tpacket_ring* ring, uint64_t* packets,
+                       uint64_t* drops) {
+  struct tpacket_stats_v3 st;
+  socklen_t len = sizeof(st);
+
+  if (getsockopt(ring->fd, SOL_PACKET, PACKET_STATISTICS, &st, &len) < 0)
+    return -1;
+  // tp_packets 包含被丢弃的包
+  *packets = st.tp_packets;
+  *drops = st.tp_drops;
+  return 0;
+}
+
+int tpacket_ring_fd(const struct tpacket_ring* ring) { return ring->fd; }
+
+void tpacket_ring_close(struct tpacket_ring* ring) {
+  if (!ring) return;
+  if (ring->map != MAP_FAILED) munmap(ring->map, ring->map_len);
+  if (ring->fd >= 0) close(ring->fd);
+  free(ring);
+}
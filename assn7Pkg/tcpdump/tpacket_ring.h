@@ -0,0 +1,135 @@
+#ifndef TPACKET_RING_H
+#define TPACKET_RING_H
+#include <stddef.h>
+#include <stdint.h>
+
+// 基于 AF_PACKET TPACKET_V3 mmap 环的抓包引擎
+//
+// 内核把数据包直接写进与用户共享的环形内存，以块为单位交给用户：一个块
+// 装满或超时（retire_blk_tov）后才置为用户可读，用户一次处理整块里的所有
+// 包，再把整块归还给内核。包数据不经过任何复制，tpacket_packet 只是指向
+// 环内存的视图，在所在的块被归还之前有效。
+
+struct tpacket_ring_config {
+  unsigned int block_size;     // 每块字节数，页大小的 2 的幂倍
+  unsigned int block_nr;       // 块数
+  unsigned int snaplen;        // 每个包最多保留的字节数
+  unsigned int retire_blk_tov; // 块未满时最多等待的毫秒数
+  int promisc;                 // 是否开启混杂模式
+  // PACKET_FANOUT：fanout_group 非 0 时加入该组，组内各 socket 按
+  // fanout_type（PACKET_FANOUT_HASH/CPU/ROLLOVER 等）分摊流量；fanout_type
+  // 带 PACKET_FANOUT_FLAG_UNIQUEID 时 fanout_group 应为 0，由内核分配一个
+  // 未被占用的组号，之后用 getsockopt(PACKET_FANOUT) 读回
+  unsigned int fanout_group;
+  unsigned int fanout_type;
+};
+
+// 默认：4 个 1MiB 的块，每包最多 65535 字节，块最多等待 10ms，不加入 fanout
+#define TPACKET_RING_CONFIG_DEFAULT \
+  { 1U << 20, 4, 65535, 10, 1, 0, 0 }
+
+// 大环：64 个 4MiB 的块，共 256MiB 且在打开时全部预先映射，只给需要吸收
+// 长时间突发的压测与长时间抓包显式选用
+#define TPACKET_RING_CONFIG_LARGE \
+  { 1U << 22, 64, 65535, 10, 1, 0, 0 }
+
+/**
+ * @brief 按 config->snaplen 重新选择块大小，块数按 bytes 取整
+ *
+ * 块取能放下 TPACKET_RING_BLOCK_FRAMES 个满长包的页大小 2 的幂倍，
+ * 限制在 [64KiB, 4MiB]；块数至少为 2，一块交给用户时内核还能写另一块。
+ *
+ * @param bytes 希望环能缓冲的总字节数，0 表示保持 config 原来的总字节数
+ */
+void tpacket_ring_config_size(struct tpacket_ring_config* config, size_t bytes);
+
+/**
+ * @brief 环中一个数据包的零拷贝视图
+ */
+struct tpacket_packet {
+  const uint8_t* data;  // 链路层帧的起始位置
+  uint32_t caplen;      // data 中有效的字节数
+  uint32_t len;         // 原始帧长度，caplen < len 表示被截断
+  uint64_t ts_ns;       // 内核接收时间戳，CLOCK_REALTIME，ns
+};
+
+/**
+ * @brief 一个交给用户的块，用 tpacket_block_next 逐个取出其中的包
+ */
+struct tpacket_block {
+  void* desc;
+  const uint8_t* next;
+  uint32_t remaining;  // 还未取出的包数
+};
+
+struct tpacket_ring;
+
+/**
+ * @brief 打开网卡上的抓包环
+ * @param iface 网络接口名称
+ * @param filter pcap 过滤表达式，NULL 或空串表示不过滤
+ * @param config 环参数，NULL 表示使用 TPACKET_RING_CONFIG_DEFAULT
+ * @return 成功返回环句柄，失败返回 NULL 并打印原因
+ */
+struct tpacket_ring* tpacket_ring_open(
+    const char* iface, const char* filter,
+    const struct tpacket_ring_config* config);
+
+/**
+ * @brief 等待下一个可读的块
+ * @param timeout_ms 最长等待时间，-1 表示一直等待，被信号打断时继续等待
+ * @return 拿到块返回 1，超时返回 0，出错返回 -1 并设置 errno（socket
+ *         上的错误取自 SO_ERROR）
+ */
+int tpacket_ring_next_block(struct tpacket_ring* ring,
+                            struct tpacket_block* block, int timeout_ms);
+
+/**
+ * @brief 取出块中的下一个包
+ * @return 有包返回 1，块已读完返回 0
+ */
+int tpacket_block_next(struct tpacket_block* block,
+                       struct tpacket_packet* packet);
+
+/**
+ * @brief 把块归还给内核，此后该块中所有包的视图失效
+ */
+void tpacket_ring_release_block(struct tpacket_ring* ring,
+                                struct tpacket_block* block);
+
+/**
+ * @brief 原子地替换 socket 上的过滤器，编译结果按表达式缓存
+ * @param filter pcap 过滤表达式，NULL 或空串表示不过滤
+ * @return 成功返回 0，编译失败返回 -2，挂载失败返回 -3
+ */
+int tpacket_ring_set_filter(struct tpacket_ring* ring, const char* filter);
+
+/**
+ * @brief 换上丢弃所有包的过滤器，socket 保持打开但不再占用环
+ * @return 成功返回 0，失败返回 -1
+ */
+int tpacket_ring_pause(struct tpacket_ring* ring);
+
+/**
+ * @brief 归还环中所有已交给用户的块
+ * @param wait_ms 等待正在填充的块超时交出的时间，应大于 retire_blk_tov
+ */
+void tpacket_ring_flush(struct tpacket_ring* ring, int wait_ms);
+
+/**
+ * @brief 读取并清零内核的计数
+ * @param packets 自上次读取以来通过过滤的包数
+ * @param drops 其中因环已满而丢弃的包数
+ * @return 成功返回 0，失败返回 -1
+ */
+int tpacket_ring_stats(struct tpacket_ring* ring, uint64_t* packets,
+                       uint64_t* drops);
+
+/**
+ * @brief 环对应的 AF_PACKET socket，可以放进 poll/epoll
+ */
+int tpacket_ring_fd(const struct tpacket_ring* ring);
+
+void tpacket_ring_close(struct tpacket_ring* ring);
+
+#endif
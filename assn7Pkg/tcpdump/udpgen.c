@@ -0,0 +1,110 @@
+// UDP traffic generator for the capture benchmarks. Each thread is pinned to
+// its own CPU and cycles through several source sockets, so the traffic
+// spreads over flows (for PACKET_FANOUT_HASH) and over CPUs (for
+// PACKET_FANOUT_CPU, since veth receives on the sending CPU). A total rate
+// in packets per second may be given; it is split evenly over the threads
+// and each thread paces its batches against the clock. 0 means unlimited.
+//
+// build: cc -O2 udpgen.c -lpthread
+// usage: udpgen dst_ip dst_port [threads] [seconds] [payload] [flows/thread]
+//               [pps]
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BATCH 64
+
+static struct sockaddr_in dst;
+static int payload = 64, flows = 16;
+static double seconds = 5;
+static double rate;  // 每个线程每秒的包数，0 表示不限速
+static atomic_long total_sent;
+
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void* sender(void* arg) {
+  long id = (long)arg;
+  struct mmsghdr msgs[BATCH];
+  struct iovec iov;
+  char* buf = calloc(1, payload);
+  int fds[flows];
+  long sent = 0;
+
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(id % sysconf(_SC_NPROCESSORS_ONLN), &set);
+  pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+
+  // 每个 socket 一个源端口，即一条流
+  for (int i = 0; i < flows; ++i) fds[i] = socket(AF_INET, SOCK_DGRAM, 0);
+  iov.iov_base = buf;
+  iov.iov_len = payload;
+  memset(msgs, 0, sizeof(msgs));
+  for (int i = 0; i < BATCH; ++i) {
+    msgs[i].msg_hdr.msg_name = &dst;
+    msgs[i].msg_hdr.msg_namelen = sizeof(dst);
+    msgs[i].msg_hdr.msg_iov = &iov;
+    msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  // 限速时每批的包数按速率缩小，让每批之间的间隔不超过约 1ms
+  int batch = BATCH;
+  if (rate > 0 && rate / 1000 < batch) batch = rate >= 2000 ? rate / 1000 : 1;
+
+  double start = now_sec(), end = start + seconds;
+  for (int f = 0;; f = (f + 1) % flows) {
+    double t = now_sec();
+    if (t >= end) break;
+    // 提前了就等到这一批应当发出的时刻
+    if (rate > 0 && sent > (t - start) * rate) {
+      double wait = sent / rate - (t - start);
+      struct timespec ts = {(time_t)wait, (long)((wait - (time_t)wait) * 1e9)};
+      nanosleep(&ts, NULL);
+      continue;
+    }
+    int n = sendmmsg(fds[f], msgs, batch, 0);
+    if (n > 0) sent += n;
+  }
+  atomic_fetch_add(&total_sent, sent);
+  for (int i = 0; i < flows; ++i) close(fds[i]);
+  free(buf);
+  return NULL;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    fprintf(stderr,
+            "usage: %s dst_ip dst_port [threads] [seconds] [payload] "
+            "[flows/thread] [pps]\n",
+            argv[0]);
+    return 1;
+  }
+  dst.sin_family = AF_INET;
+  inet_pton(AF_INET, argv[1], &dst.sin_addr);
+  dst.sin_port = htons(atoi(argv[2]));
+  int threads = argc > 3 ? atoi(argv[3]) : 4;
+  if (argc > 4) seconds = atof(argv[4]);
+  if (argc > 5) payload = atoi(argv[5]);
+  if (argc > 6) flows = atoi(argv[6]);
+  if (argc > 7) rate = atof(argv[7]) / threads;
+
+  pthread_t tids[threads];
+  for (long i = 0; i < threads; ++i)
+    pthread_create(&tids[i], NULL, sender, (void*)i);
+  for (int i = 0; i < threads; ++i) pthread_join(tids[i], NULL);
+  printf("udpgen.sent_pps %.0f\n", atomic_load(&total_sent) / seconds);
+  return 0;
+}
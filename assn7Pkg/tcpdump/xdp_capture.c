@@ -0,0 +1,549 @@
+#define _GNU_SOURCE
+#include "xdp_capture.h"
+
+#include <errno.h>
+#include <linux/bpf.h>
+#include <linux/filter.h>
+#include <linux/if_link.h>
+#include <net/if.h>
+#include <poll.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "filter_cache.h"
+
+// 暂存区中每个包的头部，紧跟包数据，原样写进 ring buffer
+struct xdp_sample {
+  uint64_t ts_ns;  // CLOCK_MONOTONIC
+  uint32_t len;
+  uint32_t caplen;
+};
+
+struct xdp_stats {
+  uint64_t packets;
+  uint64_t drops;
+};
+
+struct xdp_capture {
+  int scratch_map;  // PERCPU_ARRAY：一个 xdp_sample + snaplen 字节
+  int stats_map;    // ARRAY：一个 xdp_stats
+  int ring_map;     // RINGBUF
+  int prog;
+  int link;         // bpf_link，关闭即从网卡卸下
+
+  unsigned long* consumer;        // 消费者位置页，可写
+  const unsigned long* producer;  // 生产者位置页 + 两份数据映射，只读
+  const uint8_t* data;
+  size_t ring_bytes;
+  size_t page_size;
+  uint64_t cons;     // 本地消费位置，下一次调用时才提交给内核
+  uint64_t mono_to_real;  // CLOCK_REALTIME - CLOCK_MONOTONIC
+  struct xdp_stats last;  // 上次 xdp_capture_stats 时的累计值
+};
+
+// 手写 eBPF 指令，与 sockfair/reuseport_fair.c 相同，不依赖 libbpf 与 clang
+#define INSN(c, d, s, o, i) \
+  ((struct bpf_insn){.code = (c), .dst_reg = (d), .src_reg = (s), \
+                     .off = (o), .imm = (i)})
+#define MOV64_REG(d, s) INSN(BPF_ALU64 | BPF_MOV | BPF_X, d, s, 0, 0)
+#define MOV64_IMM(d, i) INSN(BPF_ALU64 | BPF_MOV | BPF_K, d, 0, 0, i)
+#define MOV32_REG(d, s) INSN(BPF_ALU | BPF_MOV | BPF_X, d, s, 0, 0)
+#define MOV32_IMM(d, i) INSN(BPF_ALU | BPF_MOV | BPF_K, d, 0, 0, i)
+#define ALU64_IMM(op, d, i) INSN(BPF_ALU64 | (op) | BPF_K, d, 0, 0, i)
+#define ALU32_IMM(op, d, i) INSN(BPF_ALU | (op) | BPF_K, d, 0, 0, i)
+#define LDX_MEM(sz, d, s, o) INSN(BPF_LDX | BPF_MEM | (sz), d, s, o, 0)
+#define STX_MEM(sz, d, s, o) INSN(BPF_STX | BPF_MEM | (sz), d, s, o, 0)
+#define ST_MEM(sz, d, o, i) INSN(BPF_ST | BPF_MEM | (sz), d, 0, o, i)
+#define XADD_DW(d, s, o) INSN(BPF_STX | BPF_ATOMIC | BPF_DW, d, s, o, BPF_ADD)
+#define LD_MAP_FD(d, fd)                                         \
+  INSN(BPF_LD | BPF_DW | BPF_IMM, d, BPF_PSEUDO_MAP_FD, 0, fd), \
+      INSN(0, 0, 0, 0, 0)
+#define JMP_IMM(op, d, i, o) INSN(BPF_JMP | (op) | BPF_K, d, 0, o, i)
+#define JMP_REG(op, d, s, o) INSN(BPF_JMP | (op) | BPF_X, d, s, o, 0)
+#define JA(o) INSN(BPF_JMP | BPF_JA, 0, 0, o, 0)
+#define CALL(f) INSN(BPF_JMP | BPF_CALL, 0, 0, 0, f)
+#define EXIT() INSN(BPF_JMP | BPF_EXIT, 0, 0, 0, 0)
+
+// 经典 BPF 的 A、X 与 eBPF 寄存器的对应；r6~r9 在 helper 调用间保持不变
+#define R_A BPF_REG_6
+#define R_X BPF_REG_7
+#define R_CTX BPF_REG_8
+#define R_LEN BPF_REG_9
+// 栈布局：M[0..15] 在 fp-64 起，helper 读出的字节在 fp-72，map 的 key 在 fp-76
+#define STACK_MEM(k) (-64 + 4 * (k))
+#define STACK_TMP (-72)
+#define STACK_KEY (-76)
+
+// 跳转目标：非负数为经典 BPF 指令下标
+#define LABEL_EPILOGUE (-1)  // r0 为经典 BPF 的返回值
+#define LABEL_PASS (-2)      // 不抓这个包
+
+struct fixup {
+  int at;      // 需要回填 off 的 eBPF 指令
+  int target;  // 经典 BPF 指令下标或 LABEL_*
+};
+
+struct translator {
+  struct bpf_insn* insns;
+  int len;
+  int cap;
+  struct fixup* fixups;
+  int nr_fixups;
+  int fixups_cap;
+};
+
+static long bpf(int cmd, union bpf_attr* attr) {
+  return syscall(SYS_bpf, cmd, attr, sizeof(*attr));
+}
+
+static int map_create(enum bpf_map_type type, uint32_t key_size,
+                      uint32_t value_size, uint32_t max_entries) {
+  union bpf_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.map_type = type;
+  attr.key_size = key_size;
+  attr.value_size = value_size;
+  attr.max_entries = max_entries;
+  return bpf(BPF_MAP_CREATE, &attr);
+}
+
+static void emit(struct translator* t, struct bpf_insn insn) {
+  if (t->len == t->cap) {
+    t->cap = t->cap ? 2 * t->cap : 256;
+    t->insns = realloc(t->insns, t->cap * sizeof(*t->insns));
+  }
+  t->insns[t->len++] = insn;
+}
+
+// LD_MAP_FD 占两条指令
+static void emit_map_fd(struct translator* t, int dst, int fd) {
+  struct bpf_insn pair[] = {LD_MAP_FD(dst, fd)};
+  emit(t, pair[0]);
+  emit(t, pair[1]);
+}
+
+// 发出一条跳转，off 在所有指令都发出后回填
+static void emit_jump(struct translator* t, struct bpf_insn insn, int target) {
+  if (t->nr_fixups == t->fixups_cap) {
+    t->fixups_cap = t->fixups_cap ? 2 * t->fixups_cap : 256;
+    t->fixups = realloc(t->fixups, t->fixups_cap * sizeof(*t->fixups));
+  }
+  t->fixups[t->nr_fixups++] = (struct fixup){t->len, target};
+  emit(t, insn);
+}
+
+/**
+ * @brief 从包的 r2 偏移处读 size 字节，按网络字节序放进 dst
+ *
+ * 越界时与经典 BPF 一样不接收这个包。
+ */
+static void emit_load(struct translator* t, int dst, int size) {
+  static const int width[] = {[1] = BPF_B, [2] = BPF_H, [4] = BPF_W};
+
+  emit(t, MOV64_REG(BPF_REG_1, R_CTX));
+  emit(t, MOV64_REG(BPF_REG_3, BPF_REG_10));
+  emit(t, ALU64_IMM(BPF_ADD, BPF_REG_3, STACK_TMP));
+  emit(t, MOV64_IMM(BPF_REG_4, size));
+  emit(t, CALL(BPF_FUNC_xdp_load_bytes));
+  emit_jump(t, JMP_IMM(BPF_JNE, BPF_REG_0, 0, 0), LABEL_PASS);
+  emit(t, LDX_MEM(width[size], dst, BPF_REG_10, STACK_TMP));
+  if (size > 1)
+    emit(t, INSN(BPF_ALU | BPF_END | BPF_TO_BE, dst, 0, 0, size * 8));
+}
+
+/**
+ * @brief 把一条经典 BPF 指令翻译成 eBPF
+ * @param i 指令下标，用于计算跳转目标
+ * @return 成功返回 0，遇到不支持的指令返回 -1
+ */
+static int translate_one(struct translator* t, const struct sock_filter* f,
+                         int i) {
+  static const int sizes[] = {[BPF_W] = 4, [BPF_H] = 2, [BPF_B] = 1};
+  int next = i + 1;
+
+  switch (BPF_CLASS(f->code)) {
+    case BPF_LD:
+    case BPF_LDX: {
+      int dst = BPF_CLASS(f->code) == BPF_LD ? R_A : R_X;
+      switch (BPF_MODE(f->code)) {
+        case BPF_ABS:
+        case BPF_IND:
+          // 负偏移是 SKF_AD_* 辅助数据，XDP 中没有对应物
+          if ((int32_t)f->k < 0 || BPF_SIZE(f->code) == BPF_DW) return -1;
+          if (BPF_MODE(f->code) == BPF_IND) {
+            emit(t, MOV32_REG(BPF_REG_2, R_X));
+            emit(t, ALU32_IMM(BPF_ADD, BPF_REG_2, f->k));
+          } else {
+            emit(t, MOV32_IMM(BPF_REG_2, f->k));
+          }
+          emit_load(t, dst, sizes[BPF_SIZE(f->code)]);
+          return 0;
+        case BPF_MSH:  // X = 4 * (P[k] & 0xf)
+          if ((int32_t)f->k < 0) return -1;
+          emit(t, MOV32_IMM(BPF_REG_2, f->k));
+          emit_load(t, R_X, 1);
+          emit(t, ALU32_IMM(BPF_AND, R_X, 0xf));
+          emit(t, ALU32_IMM(BPF_LSH, R_X, 2));
+          return 0;
+        case BPF_IMM:
+          emit(t, MOV32_IMM(dst, f->k));
+          return 0;
+        case BPF_LEN:
+          emit(t, MOV32_REG(dst, R_LEN));
+          return 0;
+        case BPF_MEM:
+          if (f->k >= BPF_MEMWORDS) return -1;
+          emit(t, LDX_MEM(BPF_W, dst, BPF_REG_10, STACK_MEM(f->k)));
+          return 0;
+      }
+      return -1;
+    }
+    case BPF_ST:
+    case BPF_STX:
+      if (f->k >= BPF_MEMWORDS) return -1;
+      emit(t, STX_MEM(BPF_W, BPF_REG_10,
+                      BPF_CLASS(f->code) == BPF_ST ? R_A : R_X,
+                      STACK_MEM(f->k)));
+      return 0;
+    case BPF_ALU:
+      if (BPF_OP(f->code) == BPF_NEG) {
+        emit(t, INSN(BPF_ALU | BPF_NEG, R_A, 0, 0, 0));
+        return 0;
+      }
+      if (BPF_SRC(f->code) == BPF_X) {
+        // 经典 BPF 除以 0 时不接收包，eBPF 则得到 0
+        if (BPF_OP(f->code) == BPF_DIV || BPF_OP(f->code) == BPF_MOD)
+          emit_jump(t, JMP_IMM(BPF_JEQ, R_X, 0, 0), LABEL_PASS);
+        emit(t, INSN(BPF_ALU | BPF_OP(f->code) | BPF_X, R_A, R_X, 0, 0));
+      } else {
+        emit(t, INSN(BPF_ALU | BPF_OP(f->code) | BPF_K, R_A, 0, 0, f->k));
+      }
+      return 0;
+    case BPF_JMP:
+      if (BPF_OP(f->code) == BPF_JA) {
+        emit_jump(t, JA(0), next + (int)f->k);
+        return 0;
+      }
+      // 32 位比较；条件成立跳到 jt，否则跳到 jf
+      emit_jump(t,
+                INSN(BPF_JMP32 | BPF_OP(f->code) | BPF_SRC(f->code), R_A,
+                     BPF_SRC(f->code) == BPF_X ? R_X : 0, 0,
+                     BPF_SRC(f->code) == BPF_X ? 0 : f->k),
+                next + f->jt);
+      if (f->jf) emit_jump(t, JA(0), next + f->jf);
+      return 0;
+    case BPF_RET:
+      if (BPF_RVAL(f->code) == BPF_A)
+        emit(t, MOV32_REG(BPF_REG_0, R_A));
+      else
+        emit(t, MOV32_IMM(BPF_REG_0, f->k));
+      emit_jump(t, JA(0), LABEL_EPILOGUE);
+      return 0;
+    case BPF_MISC:
+      if (BPF_MISCOP(f->code) == BPF_TAX)
+        emit(t, MOV32_REG(R_X, R_A));
+      else
+        emit(t, MOV32_REG(R_A, R_X));
+      return 0;
+  }
+  return -1;
+}
+
+/**
+ * @brief 生成完整的 XDP 程序：序言、翻译后的过滤器、采样与输出
+ * @return 成功返回 0，过滤器中有无法翻译的指令返回 -1
+ */
+static int build_prog(struct translator* t, const struct sock_fprog* filter,
+                      const struct xdp_capture* c, unsigned int snaplen,
+                      unsigned int sample) {
+  int* start = calloc(filter->len + 1, sizeof(int));
+  int epilogue, pass;
+
+  // 序言：A = X = 0，M[] 清零，R_LEN 为包的总长度
+  emit(t, MOV64_REG(R_CTX, BPF_REG_1));
+  emit(t, CALL(BPF_FUNC_xdp_get_buff_len));
+  emit(t, MOV64_REG(R_LEN, BPF_REG_0));
+  emit(t, MOV64_IMM(R_A, 0));
+  emit(t, MOV64_IMM(R_X, 0));
+  for (int k = 0; k < BPF_MEMWORDS; k += 2)
+    emit(t, ST_MEM(BPF_DW, BPF_REG_10, STACK_MEM(k), 0));
+
+  for (int i = 0; i < filter->len; ++i) {
+    start[i] = t->len;
+    if (translate_one(t, &filter->filter[i], i) < 0) {
+      fprintf(stderr, "xdp: cannot translate filter insn %d (code 0x%x)\n", i,
+              filter->filter[i].code);
+      free(start);
+      return -1;
+    }
+  }
+
+  // 收尾：caplen = min(返回值, 包长, snaplen)，为 0 则不抓
+  epilogue = t->len;
+  emit_jump(t, JMP_IMM(BPF_JEQ, BPF_REG_0, 0, 0), LABEL_PASS);
+  emit(t, JMP_REG(BPF_JLE, BPF_REG_0, R_LEN, 1));
+  emit(t, MOV64_REG(BPF_REG_0, R_LEN));
+  emit(t, JMP_IMM(BPF_JLE, BPF_REG_0, snaplen, 1));
+  emit(t, MOV64_IMM(BPF_REG_0, snaplen));
+  emit_jump(t, JMP_IMM(BPF_JEQ, BPF_REG_0, 0, 0), LABEL_PASS);
+  emit(t, MOV64_REG(R_X, BPF_REG_0));  // 此后 R_X 为 caplen
+
+  if (sample > 1) {
+    emit(t, CALL(BPF_FUNC_get_prandom_u32));
+    emit(t, ALU32_IMM(BPF_MOD, BPF_REG_0, sample));
+    emit_jump(t, JMP_IMM(BPF_JNE, BPF_REG_0, 0, 0), LABEL_PASS);
+  }
+
+  // 在 per-CPU 暂存区拼出 xdp_sample + 包数据，R_A 指向暂存区
+  emit(t, ST_MEM(BPF_W, BPF_REG_10, STACK_KEY, 0));
+  emit_map_fd(t, BPF_REG_1, c->scratch_map);
+  emit(t, MOV64_REG(BPF_REG_2, BPF_REG_10));
+  emit(t, ALU64_IMM(BPF_ADD, BPF_REG_2, STACK_KEY));
+  emit(t, CALL(BPF_FUNC_map_lookup_elem));
+  emit_jump(t, JMP_IMM(BPF_JEQ, BPF_REG_0, 0, 0), LABEL_PASS);
+  emit(t, MOV64_REG(R_A, BPF_REG_0));
+  emit(t, CALL(BPF_FUNC_ktime_get_ns));
+  emit(t, STX_MEM(BPF_DW, R_A, BPF_REG_0, offsetof(struct xdp_sample, ts_ns)));
+  emit(t, STX_MEM(BPF_W, R_A, R_LEN, offsetof(struct xdp_sample, len)));
+  emit(t, STX_MEM(BPF_W, R_A, R_X, offsetof(struct xdp_sample, caplen)));
+  emit(t, MOV64_REG(BPF_REG_1, R_CTX));
+  emit(t, MOV64_IMM(BPF_REG_2, 0));
+  emit(t, MOV64_REG(BPF_REG_3, R_A));
+  emit(t, ALU64_IMM(BPF_ADD, BPF_REG_3, sizeof(struct xdp_sample)));
+  emit(t, MOV64_REG(BPF_REG_4, R_X));
+  emit(t, CALL(BPF_FUNC_xdp_load_bytes));
+  emit_jump(t, JMP_IMM(BPF_JNE, BPF_REG_0, 0, 0), LABEL_PASS);
+
+  // 一次复制进 ring buffer；结果留在 R_A 中，用于计数
+  emit_map_fd(t, BPF_REG_1, c->ring_map);
+  emit(t, MOV64_REG(BPF_REG_2, R_A));
+  emit(t, MOV64_REG(BPF_REG_3, R_X));
+  emit(t, ALU64_IMM(BPF_ADD, BPF_REG_3, sizeof(struct xdp_sample)));
+  emit(t, MOV64_IMM(BPF_REG_4, 0));
+  emit(t, CALL(BPF_FUNC_ringbuf_output));
+  emit(t, MOV64_REG(R_A, BPF_REG_0));
+
+  emit(t, ST_MEM(BPF_W, BPF_REG_10, STACK_KEY, 0));
+  emit_map_fd(t, BPF_REG_1, c->stats_map);
+  emit(t, MOV64_REG(BPF_REG_2, BPF_REG_10));
+  emit(t, ALU64_IMM(BPF_ADD, BPF_REG_2, STACK_KEY));
+  emit(t, CALL(BPF_FUNC_map_lookup_elem));
+  emit_jump(t, JMP_IMM(BPF_JEQ, BPF_REG_0, 0, 0), LABEL_PASS);
+  emit(t, MOV64_IMM(BPF_REG_1, 1));
+  emit(t, XADD_DW(BPF_REG_0, BPF_REG_1, offsetof(struct xdp_stats, packets)));
+  emit_jump(t, JMP_IMM(BPF_JEQ, R_A, 0, 0), LABEL_PASS);
+  emit(t, XADD_DW(BPF_REG_0, BPF_REG_1, offsetof(struct xdp_stats, drops)));
+
+  pass = t->len;
+  emit(t, MOV64_IMM(BPF_REG_0, XDP_PASS));
+  emit(t, EXIT());
+
+  for (int i = 0; i < t->nr_fixups; ++i) {
+    const struct fixup* fx = &t->fixups[i];
+    int target = fx->target == LABEL_EPILOGUE ? epilogue
+                 : fx->target == LABEL_PASS   ? pass
+                                              : start[fx->target];
+    t->insns[fx->at].off = (int16_t)(target - fx->at - 1);
+  }
+  free(start);
+  return 0;
+}
+
+static int prog_load(const struct bpf_insn* insns, int len) {
+  static char log[1 << 16];
+  union bpf_attr attr;
+  int fd;
+
+  memset(&attr, 0, sizeof(attr));
+  attr.prog_type = BPF_PROG_TYPE_XDP;
+  attr.insns = (uintptr_t)insns;
+  attr.insn_cnt = len;
+  attr.license = (uintptr_t) "GPL";
+  fd = bpf(BPF_PROG_LOAD, &attr);
+  if (fd >= 0) return fd;
+
+  // 失败时带日志重新加载一次，只为打印原因
+  attr.log_buf = (uintptr_t)log;
+  attr.log_size = sizeof(log);
+  attr.log_level = 1;
+  log[0] = 0;
+  fd = bpf(BPF_PROG_LOAD, &attr);
+  if (fd >= 0) return fd;
+  fprintf(stderr, "xdp: BPF_PROG_LOAD failed: %s\n%s\n", strerror(errno), log);
+  return -1;
+}
+
+struct xdp_capture* xdp_capture_open(const char* iface, const char* filter,
+                                     const struct xdp_capture_config* config) {
+  struct xdp_capture_config def = XDP_CAPTURE_CONFIG_DEFAULT;
+  struct translator t = {0};
+  struct filter_cache* cache = filter_cache_default();
+  const struct sock_fprog* fprog;
+  struct xdp_capture* c;
+  struct timespec real, mono;
+  unsigned int ifindex, snaplen;
+  union bpf_attr attr;
+  int ret;
+
+  if (!config) config = &def;
+  snaplen = config->snaplen;
+  if (snaplen == 0 || snaplen > XDP_CAPTURE_MAX_SNAPLEN)
+    snaplen = XDP_CAPTURE_MAX_SNAPLEN;
+  ifindex = if_nametoindex(iface);
+  if (!ifindex) {
+    fprintf(stderr, "xdp: no interface %s\n", iface);
+    return NULL;
+  }
+  if (!cache) {
+    fprintf(stderr, "xdp: filter cache: out of memory\n");
+    return NULL;
+  }
+  // lo 上同样只看收到的那一份，不需要去掉外发的副本
+  fprog = filter_cache_get(cache, filter, snaplen, 0);
+  if (!fprog) return NULL;
+
+  c = calloc(1, sizeof(*c));
+  if (!c) {
+    filter_cache_put(cache, fprog);
+    return NULL;
+  }
+  c->scratch_map = c->stats_map = c->ring_map = c->prog = c->link = -1;
+  c->consumer = MAP_FAILED;
+  c->producer = MAP_FAILED;
+  c->page_size = sysconf(_SC_PAGESIZE);
+  c->ring_bytes = config->ring_bytes;
+
+  c->scratch_map = map_create(BPF_MAP_TYPE_PERCPU_ARRAY, sizeof(uint32_t),
+                              sizeof(struct xdp_sample) + snaplen, 1);
+  c->stats_map = map_create(BPF_MAP_TYPE_ARRAY, sizeof(uint32_t),
+                            sizeof(struct xdp_stats), 1);
+  c->ring_map = map_create(BPF_MAP_TYPE_RINGBUF, 0, 0, config->ring_bytes);
+  if (c->scratch_map < 0 || c->stats_map < 0 || c->ring_map < 0) {
+    perror("xdp: BPF_MAP_CREATE");
+    goto fail;
+  }
+
+  // 消费者位置页可写；生产者位置页之后数据区被映射两次，跨过末尾的记录
+  // 也能连续读取
+  c->consumer = mmap(NULL, c->page_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                     c->ring_map, 0);
+  c->producer = mmap(NULL, c->page_size + 2 * c->ring_bytes, PROT_READ,
+                     MAP_SHARED, c->ring_map, c->page_size);
+  if (c->consumer == MAP_FAILED || c->producer == MAP_FAILED) {
+    perror("xdp: mmap ringbuf");
+    goto fail;
+  }
+  c->data = (const uint8_t*)c->producer + c->page_size;
+  c->cons = __atomic_load_n(c->consumer, __ATOMIC_ACQUIRE);
+
+  // 经典 BPF 翻译完之后就不再需要，尽早归还缓存
+  ret = build_prog(&t, fprog, c, snaplen, config->sample);
+  filter_cache_put(cache, fprog);
+  fprog = NULL;
+  if (ret < 0) goto fail;
+  c->prog = prog_load(t.insns, t.len);
+  if (c->prog < 0) goto fail;
+
+  memset(&attr, 0, sizeof(attr));
+  attr.link_create.prog_fd = c->prog;
+  attr.link_create.target_ifindex = ifindex;
+  attr.link_create.attach_type = BPF_XDP;
+  attr.link_create.flags =
+      config->native ? XDP_FLAGS_DRV_MODE : XDP_FLAGS_SKB_MODE;
+  c->link = bpf(BPF_LINK_CREATE, &attr);
+  if (c->link < 0) {
+    fprintf(stderr, "xdp: attach to %s failed: %s\n", iface, strerror(errno));
+    goto fail;
+  }
+
+  clock_gettime(CLOCK_REALTIME, &real);
+  clock_gettime(CLOCK_MONOTONIC, &mono);
+  c->mono_to_real = (real.tv_sec - mono.tv_sec) * 1000000000ULL +
+                    real.tv_nsec - mono.tv_nsec;
+  free(t.insns);
+  free(t.fixups);
+  return c;
+
+fail:
+  if (fprog) filter_cache_put(cache, fprog);
+  free(t.insns);
+  free(t.fixups);
+  xdp_capture_close(c);
+  return NULL;
+}
+
+/**
+ * @brief 取出下一个包
+ *
+ * 上一个包占用的空间在这里才交还内核。记录头的 BUSY 位表示生产者还在写，
+ * DISCARD 位表示被丢弃的记录，跳过即可。
+ */
+int xdp_capture_next(struct xdp_capture* c, struct tpacket_packet* packet,
+                     int timeout_ms) {
+  size_t mask = c->ring_bytes - 1;
+
+  __atomic_store_n(c->consumer, c->cons, __ATOMIC_RELEASE);
+  for (;;) {
+    uint64_t prod = __atomic_load_n(c->producer, __ATOMIC_ACQUIRE);
+    while (c->cons < prod) {
+      const uint32_t* hdr = (const uint32_t*)(c->data + (c->cons & mask));
+      uint32_t len = __atomic_load_n(hdr, __ATOMIC_ACQUIRE);
+      if (len & BPF_RINGBUF_BUSY_BIT) break;
+      c->cons += (BPF_RINGBUF_HDR_SZ + (len & ~BPF_RINGBUF_DISCARD_BIT) + 7) &
+                 ~7ULL;
+      if (len & BPF_RINGBUF_DISCARD_BIT) continue;
+
+      const struct xdp_sample* s =
+          (const void*)((const uint8_t*)hdr + BPF_RINGBUF_HDR_SZ);
+      packet->data = (const uint8_t*)(s + 1);
+      packet->caplen = s->caplen;
+      packet->len = s->len;
+      packet->ts_ns = s->ts_ns + c->mono_to_real;
+      return 1;
+    }
+    __atomic_store_n(c->consumer, c->cons, __ATOMIC_RELEASE);
+
+    struct pollfd pfd = {.fd = c->ring_map, .events = POLLIN};
+    int ret = poll(&pfd, 1, timeout_ms);
+    if (ret < 0 && errno != EINTR) return -1;
+    if (ret == 0) return 0;
+  }
+}
+
+int xdp_capture_stats(struct xdp_capture* c, uint64_t* packets,
+                      uint64_t* drops) {
+  struct xdp_stats now;
+  uint32_t key = 0;
+  union bpf_attr attr;
+
+  memset(&attr, 0, sizeof(attr));
+  attr.map_fd = c->stats_map;
+  attr.key = (uintptr_t)&key;
+  attr.value = (uintptr_t)&now;
+  if (bpf(BPF_MAP_LOOKUP_ELEM, &attr) != 0) return -1;
+  *packets = now.packets - c->last.packets;
+  *drops = now.drops - c->last.drops;
+  c->last = now;
+  return 0;
+}
+
+int xdp_capture_fd(const struct xdp_capture* c) { return c->ring_map; }
+
+void xdp_capture_close(struct xdp_capture* c) {
+  if (!c) return;
+  if (c->link >= 0) close(c->link);
+  if (c->prog >= 0) close(c->prog);
+  if (c->consumer != MAP_FAILED) munmap(c->consumer, c->page_size);
+  if (c->producer != MAP_FAILED)
+    munmap((void*)c->producer, c->page_size + 2 * c->ring_bytes);
+  if (c->ring_map >= 0) close(c->ring_map);
+  if (c->stats_map >= 0) close(c->stats_map);
+  if (c->scratch_map >= 0) close(c->scratch_map);
+  free(c);
+}
@@ -0,0 +1,74 @@
+#ifndef XDP_CAPTURE_H
+#define XDP_CAPTURE_H
+#include <stdint.h>
+
+#include "tpacket_ring.h"
+
+// 基于 XDP 与 BPF ring buffer 的抓包后端
+//
+// 在网卡上以 generic 模式（XDP_FLAGS_SKB_MODE，不需要网卡驱动支持，veth 与
+// lo 上都能用）或驱动模式挂一个 XDP 程序。pcap 过滤表达式先由 libpcap 编译
+// 成经典 BPF，再翻译成 eBPF 并入 XDP 程序，在内核里完成过滤、采样与截断；
+// 通过的包连同时间戳与原始长度写进 BPF_MAP_TYPE_RINGBUF，用户态从 mmap 的
+// ring buffer 中直接读取。程序对所有包都返回 XDP_PASS，不影响正常收包。
+//
+// XDP 只能看到接口收到的包，看不到本机发出的包。
+
+// 每个包在内核中先拷进一个 per-CPU 暂存区，它的大小限制了 snaplen
+#define XDP_CAPTURE_MAX_SNAPLEN 32752
+
+struct xdp_capture_config {
+  unsigned int snaplen;     // 每个包最多保留的字节数，超过上限按上限处理
+  unsigned int sample;      // 通过过滤的包每 sample 个随机保留一个，0/1 不采样
+  unsigned int ring_bytes;  // ring buffer 大小，页大小的 2 的幂倍
+  int native;               // 非 0 时以驱动模式挂载（veth 等驱动支持）
+};
+
+// 默认：最大 snaplen，不采样，64MiB ring buffer，generic 模式
+#define XDP_CAPTURE_CONFIG_DEFAULT \
+  { XDP_CAPTURE_MAX_SNAPLEN, 1, 1U << 26, 0 }
+
+struct xdp_capture;
+
+/**
+ * @brief 加载 XDP 程序并挂到网卡上
+ * @param iface 网络接口名称
+ * @param filter pcap 过滤表达式，NULL 或空串表示不过滤
+ * @param config 参数，NULL 表示使用 XDP_CAPTURE_CONFIG_DEFAULT
+ * @return 成功返回句柄，失败返回 NULL 并打印原因（包括校验器日志）
+ */
+struct xdp_capture* xdp_capture_open(const char* iface, const char* filter,
+                                     const struct xdp_capture_config* config);
+
+/**
+ * @brief 取出下一个包
+ *
+ * 返回的视图指向 ring buffer 内部，在下一次调用 xdp_capture_next 或
+ * xdp_capture_close 之前有效；之后这段空间交还给内核。
+ *
+ * @param timeout_ms 最长等待时间，-1 表示一直等待
+ * @return 有包返回 1，超时返回 0，出错返回 -1
+ */
+int xdp_capture_next(struct xdp_capture* capture,
+                     struct tpacket_packet* packet, int timeout_ms);
+
+/**
+ * @brief 读取并清零计数
+ * @param packets 自上次读取以来通过过滤与采样的包数
+ * @param drops 其中因 ring buffer 已满而丢弃的包数
+ * @return 成功返回 0，失败返回 -1
+ */
+int xdp_capture_stats(struct xdp_capture* capture, uint64_t* packets,
+                      uint64_t* drops);
+
+/**
+ * @brief ring buffer 的 fd，有数据时可读，可以放进 poll/epoll
+ */
+int xdp_capture_fd(const struct xdp_capture* capture);
+
+/**
+ * @brief 从网卡上卸下 XDP 程序并释放所有资源
+ */
+void xdp_capture_close(struct xdp_capture* capture);
+
+#endif
@@ -1,9 +1,18 @@
+#include <asm/segment.h>
 #include <linux/compiler.h>
+#include <linux/minmax.h>
+#include <linux/mm.h>
 #include <linux/sched.h>
+#include <linux/sched/signal.h>
 #include <linux/vgettask.h>
 
-notrace int __vdso_get_task_info(struct task_info __user *info) {
+notrace int __vdso_get_task_info(struct task_info __user *info, size_t size) {
   struct task_info tmp = {0};
+  unsigned int cpu, node;
+
+  // 不认识的旧版本结构体直接拒绝
+  if (size < TASK_INFO_SIZE_VER0) return -1;
+  size = min(size, sizeof(tmp));
 
   // 通过 x86 的 gs 寄存器获取当前 task_struct
   struct task_struct *current;
@@ -11,10 +20,25 @@ notrace int __vdso_get_task_info(struct task_info __user *info) {
 
   // 填充用户态可见数据（避免暴露内核指针）
   tmp.pid = task_pid_nr(current);
-  tmp.task_struct_ptr = (void __user *)current;
+  tmp.task_token = current->task_token;
+
+  // CPU/节点号与 __vdso_getcpu 一样从 RDPID/LSL 读取，
+  // 不依赖 task_struct 中可能已经过时的 cpu 字段
+  vdso_read_cpunode(&cpu, &node);
+  tmp.cpu = cpu;
+  tmp.node = node;
+  tmp.nvcsw = READ_ONCE(current->nvcsw);
+  tmp.nivcsw = READ_ONCE(current->nivcsw);
+  tmp.sum_exec_runtime = READ_ONCE(current->se.sum_exec_runtime);
+  tmp.state = 0;  // 'R'：能执行到这里说明正在运行
+  if (current->mm) tmp.rss = get_mm_rss(current->mm);
+  tmp.vpid = READ_ONCE(current->vdso_vpid);
+  // 非组长线程 exec 时会在 de_thread() 中接管组长的 pid，此后 tid == pid
+  tmp.vtid = thread_group_leader(current) ? tmp.vpid
+                                          : READ_ONCE(current->vdso_vtid);
 
   // 将数据复制到用户态缓冲区
-  if (copy_to_user(info, &tmp, sizeof(tmp))) return -1;
+  if (copy_to_user(info, &tmp, size)) return -1;
 
-  return 0;
-}
\ No newline at end of file
+  return size;
+}
@@ -62,6 +62,8 @@ struct root_domain;
 struct rq;
 struct sched_attr;
 struct sched_param;
+struct sched_ring;
+struct sock_fair;
 struct seq_file;
 struct sighand_struct;
 struct signal_struct;
@@ -1511,9 +1513,12 @@ struct task_struct {
 
   struct hlist_head kv_store[1024];
   spinlock_t kv_lock[1024];
-  int socket_limit;
-  int socket_count;
-  int socket_priority;
+  struct sock_fair *sock_fair;  // socket 配额，见 sockfair.h
+  u64 task_token;  // clone 时生成，经 vDSO 代替 task_struct 指针暴露给用户态
+  struct sched_ring *sched_ring;  // 用户注册的调度事件环，见 sched_ring.h
+  // 所在 pid 命名空间内的 pid/tid，clone 时算好供 vDSO 直接读取
+  pid_t vdso_vpid;
+  pid_t vdso_vtid;
 
   randomized_struct_fields_end
 
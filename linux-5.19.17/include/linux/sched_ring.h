@@ -0,0 +1,57 @@
+#ifndef _LINUX_SCHED_RING_H
+#define _LINUX_SCHED_RING_H
+
+#include <linux/types.h>
+
+// 用户态可见的调度事件环形缓冲区布局
+//
+// 用户为每个线程准备一块页对齐的内存（头部 + 2^n 条记录），通过
+// register_sched_ring 注册。之后调度器在该线程每次被换出/换入时追加一条
+// 记录：内核是唯一的生产者，只写 records[head & mask] 再以 release 语义
+// 推进 head；用户是唯一的消费者，自己维护 tail，不需要任何系统调用。
+// 用户落后超过 mask + 1 条时最旧的记录被覆盖。内核在 head 等于 i + mask + 1
+// 时就开始往第 i 条的槽里写下一条，因此读完一条记录后（acquire 栅栏之后）
+// 重新读 head，若 head - i >= mask + 1 则第 i 条可能已被覆盖，应当丢弃。
+// execve 与线程退出时环自动注销。
+enum {
+  SCHED_RING_OUT = 1,  // 线程被换出，state 为换出时的状态
+  SCHED_RING_IN = 2,   // 线程被换入，state 为换出前记录的状态
+};
+
+struct sched_ring_record {
+  __u64 timestamp;  // CLOCK_MONOTONIC，ns
+  __u32 cpu;
+  __u8 event;  // SCHED_RING_OUT / SCHED_RING_IN
+  __u8 state;  // task_state_index()：0=R（被抢占）1=S 2=D ...
+  __u16 __reserved;
+};
+
+struct sched_ring_header {
+  __u64 head;  // 已写入的记录总数，只由内核修改
+  __u32 mask;  // 记录条数 - 1，注册时由内核填写
+  __u32 __reserved;
+  struct sched_ring_record records[];
+};
+
+// 单个线程最多注册的记录条数
+#define SCHED_RING_MAX_RECORDS (1U << 16)
+
+#ifdef __KERNEL__
+struct mm_struct;
+struct page;
+struct task_struct;
+
+struct sched_ring {
+  struct sched_ring_header *hdr;  // 内核侧 vmap 映射
+  struct page **pages;            // 长期 pin 住的用户页
+  struct mm_struct *mm;           // pin 的页计入它的 locked_vm，持有引用
+  unsigned int nr_pages;
+  u64 head;  // 内核侧的写入位置
+  u32 mask;
+  u8 last_state;  // 最近一次换出时的状态，换入记录沿用
+};
+
+void sched_ring_release(struct task_struct *t);
+#endif
+
+#endif
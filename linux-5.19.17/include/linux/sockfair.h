@@ -0,0 +1,88 @@
+#ifndef _LINUX_SOCKFAIR_H
+#define _LINUX_SOCKFAIR_H
+
+#include <linux/atomic.h>
+#include <linux/percpu_counter.h>
+#include <linux/refcount.h>
+#include <linux/spinlock.h>
+#include <linux/types.h>
+
+struct socket;
+struct task_struct;
+
+// socket 配额节点，组成一棵树：
+//  - 分组节点由 configure_socket_group 创建，线程间共享，随 clone/fork
+//    继承，相当于一个只管 socket 的 cgroup；
+//  - 线程节点由 configure_socket_fairness 创建，只属于一个线程，挂在该线程
+//    当时所在的分组下面。
+// task->sock_fair 指向线程最具体的那个节点。新建 socket 时从该节点逐级向上
+// 计数，socket 在 inode 的 i_private 里记下并引用这个节点，关闭时原路退回，
+// 与由哪个线程关闭、创建者是否已退出都无关。分组节点的 parent 创建后不再
+// 改变；线程节点进入新分组时被挂到新分组下（见 sock_fair_group_enter），
+// 此时持有 lock，与关闭 socket 时的逐级退回互斥。
+// accept 得到的 socket 只计入该节点的 accepted，不占用任何一级的 limit。
+struct sock_fair {
+  refcount_t ref;
+  struct sock_fair *parent;  // 上一级分组，持有其引用
+  spinlock_t lock;           // 线程节点：保护 parent 的更换
+  bool group;
+  union {
+    atomic_t count;                // 线程节点：当前仍打开的 socket 数
+    struct percpu_counter pcount;  // 分组节点：大量线程并发更新，按 CPU 计数
+  };
+  atomic_t accepted;  // accept 得到、仍打开的 socket 数，只计本节点
+  int limit;          // 0 表示不限，只约束 count
+  int priority;       // 发送权重，0 表示不干预；只对线程节点有意义
+
+  // 创建速率的令牌桶（GCRA），rate_interval 为 0 表示不限速
+  u64 rate_interval;        // 每个令牌的间隔，ns
+  unsigned int rate_burst;  // 最多攒下的令牌数
+  atomic64_t tat;           // 理论到达时间，ns
+
+  // 被拒绝的创建次数，包括下级节点的
+  atomic64_t rejected_limit;  // 超过上限，-EMFILE
+  atomic64_t rejected_rate;   // 超过速率，-EAGAIN
+};
+
+#define SOCK_FAIR_BATCH 32
+
+// configure_socket_group 的 flags
+#define SOCK_FAIR_GROUP_NEW 1  // 新建子分组并让调用线程加入
+
+// configure_socket_rate 的 flags
+#define SOCK_FAIR_RATE_GROUP 1  // 作用于线程所在分组而不是线程本身
+
+// priority > 0 的线程新建的 socket 把 sk_priority 设成 tc 类 10:<priority>，
+// 出口 qdisc（例如 handle 10: 的 drr，类的 quantum 与权重成正比）据此直接
+// 分类，各线程按权重分享带宽。
+#define SOCK_FAIR_TC_MAJOR 0x10U
+#define SOCK_FAIR_PRIO_MAX 0xffff
+
+// get_socket_fairness 返回给用户态的快照，只允许在末尾追加字段
+struct sock_fair_info {
+  __s32 limit;     // 线程自己的上限
+  __s32 count;     // 线程自己创建、仍打开的 socket 数，受 limit 约束
+  __s32 priority;  // 线程的发送权重
+  __s32 group_limit;
+  __s64 group_count;  // 线程所在分组（含子分组）持有的 socket 数
+  __s64 rejected_limit;  // 线程被拒绝的次数（超过任一级上限）
+  __s64 rejected_rate;   // 线程被拒绝的次数（超过任一级速率）
+  __s64 group_rejected;  // 分组内所有线程被拒绝的总次数
+  __s32 accepted;        // 线程 accept 得到、仍打开的连接数，不受 limit 约束
+  __s32 __reserved;
+};
+
+int sock_fair_charge(struct socket *sock);
+void sock_fair_charge_accepted(struct socket *sock);
+void sock_fair_uncharge(struct socket *sock);
+void sock_fair_put(struct sock_fair *sf);
+void sock_fair_exit(struct task_struct *t);
+struct sock_fair *sock_fair_fork(void);
+int sock_fair_configure(struct task_struct *t, int limit, int priority);
+int sock_fair_group_enter(int limit);
+int sock_fair_group_set_limit(struct task_struct *t, int limit);
+void sock_fair_get_info(struct task_struct *t, struct sock_fair_info *info);
+int sock_fair_set_rate(struct task_struct *t, unsigned int rate,
+                       unsigned int burst, bool group);
+
+#endif
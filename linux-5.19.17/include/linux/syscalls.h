@@ -1373,6 +1373,11 @@ int __sys_setsockopt(int fd, int level, int optname, char __user *optval,
 #define __NR_write_kv 452
 #define __NR_read_kv 451
 #define SYS_configure_socket_fairness 453
+#define __NR_get_task_info_batch 454
+#define __NR_register_sched_ring 455
+#define SYS_configure_socket_group 456
+#define SYS_configure_socket_rate 457
+#define SYS_get_socket_fairness 458
 
 asmlinkage long sys_write_kv(int k, int v);
 
@@ -1388,4 +1393,43 @@ asmlinkage long sys_configure_socket_fairness(pid_t tid, int max_sock,
 //   return syscall(SYS_configure_socket_fairness, tid, max_sock, priority);
 // }
 
+struct task_info;
+asmlinkage long sys_get_task_info_batch(const pid_t __user *pids,
+                                        struct task_info __user *infos,
+                                        unsigned int count, size_t size);
+// int get_task_info_batch(const pid_t *pids, struct task_info *infos,
+//                         unsigned int count) {
+//   return syscall(__NR_get_task_info_batch, pids, infos, count,
+//                  sizeof(*infos));
+// }
+
+struct sched_ring_header;
+asmlinkage long sys_register_sched_ring(struct sched_ring_header __user *addr,
+                                        unsigned int nr_records);
+// int register_sched_ring(struct sched_ring_header *ring, unsigned nr) {
+//   return syscall(__NR_register_sched_ring, ring, nr);
+// }
+
+asmlinkage long sys_configure_socket_group(pid_t tid, int max_sock,
+                                           unsigned int flags);
+// int configure_socket_group(pid_t tid, int max_sock, unsigned flags) {
+//   return syscall(SYS_configure_socket_group, tid, max_sock, flags);
+// }
+
+asmlinkage long sys_configure_socket_rate(pid_t tid, unsigned int rate,
+                                          unsigned int burst,
+                                          unsigned int flags);
+// int configure_socket_rate(pid_t tid, unsigned rate, unsigned burst,
+//                           unsigned flags) {
+//   return syscall(SYS_configure_socket_rate, tid, rate, burst, flags);
+// }
+
+struct sock_fair_info;
+asmlinkage long sys_get_socket_fairness(pid_t tid,
+                                        struct sock_fair_info __user *info,
+                                        size_t size);
+// int get_socket_fairness(pid_t tid, struct sock_fair_info *info) {
+//   return syscall(SYS_get_socket_fairness, tid, info, sizeof(*info));
+// }
+
 #endif
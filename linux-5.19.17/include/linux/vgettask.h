@@ -2,15 +2,49 @@
 #include <linux/types.h>
 
 // vDSO暴露接口
+//
+// 结构体只允许在末尾追加字段。调用方传入自己认识的结构体大小，
+// vDSO 只填充 min(size, sizeof(struct task_info)) 字节，并返回实际填充的
+// 字节数，调用方据此判断内核支持到哪个版本（与 sched_attr 的做法一致）。
 struct task_info {
   pid_t pid;
-  void __user *task_struct_ptr;
-  // 其他关键字段...
+  __u64 task_token;  // 本次启动内唯一、不透明的线程标识，可直接比较
+  /* TASK_INFO_SIZE_VER0 */
+
+  __u32 cpu;               // 当前运行的 CPU
+  __u32 node;              // 当前 CPU 所在的 NUMA 节点
+  __u64 nvcsw;             // 自愿上下文切换次数
+  __u64 nivcsw;            // 非自愿上下文切换次数
+  __u64 sum_exec_runtime;  // 累计运行时间（ns，按调度 tick/切换更新）
+  /* TASK_INFO_SIZE_VER1 */
+
+  __u32 state;  // task_state_index()：0=R 1=S 2=D 3=T 4=t 5=X 6=Z 7=P 8=I
+  __u32 __reserved;
+  __u64 rss;  // 常驻内存页数，内核线程为 0
+  /* TASK_INFO_SIZE_VER2 */
+
+  // 线程所在 pid 命名空间（容器）内的 pid/tid，与 getpid()/gettid() 一致；
+  // 上面的 pid 字段仍是全局 tid
+  pid_t vpid;
+  pid_t vtid;
+  /* TASK_INFO_SIZE_VER3 */
 };
 
-extern int __vdso_get_task_info(struct task_info *info) __attribute__((weak));
+#define TASK_INFO_SIZE_VER0 16 /* pid, task_token */
+#define TASK_INFO_SIZE_VER1 48 /* cpu, node, nvcsw, nivcsw, sum_exec_runtime */
+#define TASK_INFO_SIZE_VER2 64 /* state, rss */
+#define TASK_INFO_SIZE_VER3 72 /* vpid, vtid */
+
+// get_task_info_batch 单次最多查询的 pid 个数，以及结果数组最多的字节数
+// （count * size），超出时返回 -E2BIG，内核缓冲区因此有界
+#define TASK_INFO_BATCH_MAX 65536
+#define TASK_INFO_BATCH_MAX_BYTES (4U << 20)
+
+extern int __vdso_get_task_info(struct task_info *info, size_t size)
+    __attribute__((weak));
 
 static inline int get_task_struct_info(struct task_info *info) {
-  if (__vdso_get_task_info) return __vdso_get_task_info(info);
+  if (__vdso_get_task_info)
+    return __vdso_get_task_info(info, sizeof(*info)) < 0 ? -1 : 0;
   return -1;
-}
\ No newline at end of file
+}
@@ -0,0 +1,30 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM sockfair
+
+#if !defined(_TRACE_SOCKFAIR_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_SOCKFAIR_H
+
+#include <linux/tracepoint.h>
+
+// socket() 因配额（-EMFILE）或创建速率（-EAGAIN）被拒绝。limit 与 count
+// 取自拒绝它的那一级节点（线程或分组），分组的 count 是近似值。
+TRACE_EVENT(sock_fair_reject,
+
+            TP_PROTO(pid_t tid, int limit, s64 count, int err),
+
+            TP_ARGS(tid, limit, count, err),
+
+            TP_STRUCT__entry(__field(pid_t, tid) __field(int, limit)
+                                 __field(s64, count) __field(int, err)),
+
+            TP_fast_assign(__entry->tid = tid; __entry->limit = limit;
+                           __entry->count = count; __entry->err = err;),
+
+            TP_printk("tid=%d limit=%d count=%lld err=%d", __entry->tid,
+                      __entry->limit, __entry->count, __entry->err));
+
+#endif /* _TRACE_SOCKFAIR_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
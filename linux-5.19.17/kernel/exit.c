@@ -33,6 +33,8 @@
 #include <linux/kprobes.h>
 #include <linux/kthread.h>
 #include <linux/kv_pair.h>
+#include <linux/sched_ring.h>
+#include <linux/sockfair.h>
 #include <linux/mempolicy.h>
 #include <linux/mm.h>
 #include <linux/module.h>
@@ -736,6 +738,8 @@ void __noreturn do_exit(long code) {
   tsk->exit_code = code;
   taskstats_exit(tsk, group_dead);
 
+  sched_ring_release(tsk);
+  sock_fair_exit(tsk);
   exit_mm();
 
   if (group_dead) acct_process();
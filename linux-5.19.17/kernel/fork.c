@@ -75,6 +75,7 @@
 #include <linux/sched/cputime.h>
 #include <linux/sched/mm.h>
 #include <linux/sched/numa_balancing.h>
+#include <linux/sched_ring.h>
 #include <linux/sched/stat.h>
 #include <linux/sched/task.h>
 #include <linux/sched/task_stack.h>
@@ -85,7 +86,9 @@
 #include <linux/sem.h>
 #include <linux/seq_file.h>
 #include <linux/signalfd.h>
+#include <linux/siphash.h>
 #include <linux/slab.h>
+#include <linux/sockfair.h>
 #include <linux/stackleak.h>
 #include <linux/swap.h>
 #include <linux/syscalls.h>
@@ -1364,6 +1367,8 @@ void exit_mm_release(struct task_struct *tsk, struct mm_struct *mm) {
 
 void exec_mm_release(struct task_struct *tsk, struct mm_struct *mm) {
   futex_exec_release(tsk);
+  // 调度事件环 pin 的是旧 mm 的页，新程序看不到它们，不能再往里写
+  sched_ring_release(tsk);
   mm_release(tsk, mm);
 }
 
@@ -1626,6 +1631,18 @@ static void rt_mutex_init_task(struct task_struct *p) {
 #endif
 }
 
+/*
+ * 每个线程的身份令牌：对单调递增序号做 siphash，密钥每次启动随机生成。
+ * 令牌在本次启动内不重复（pid 复用也不会重复），且不泄露任何内核地址。
+ */
+static u64 task_token_next(void) {
+  static siphash_key_t task_token_key;
+  static atomic64_t task_token_seq = ATOMIC64_INIT(0);
+
+  get_random_once(&task_token_key, sizeof(task_token_key));
+  return siphash_1u64(atomic64_inc_return(&task_token_seq), &task_token_key);
+}
+
 static inline void init_task_pid_links(struct task_struct *task) {
   enum pid_type type;
 
@@ -1904,6 +1921,10 @@ static __latent_entropy struct task_struct *copy_process(
     INIT_HLIST_HEAD(&p->kv_store[i]);
     spin_lock_init(&p->kv_lock[i]);
   }
+  // 调度事件环属于注册它的线程，不随 clone 继承
+  p->sched_ring = NULL;
+  // 继承 socket 配额分组，按线程配置的配额不继承
+  p->sock_fair = sock_fair_fork();
 
   if (args->io_thread) {
     /*
@@ -2133,6 +2154,15 @@ static __latent_entropy struct task_struct *copy_process(
     p->group_leader = p;
     p->tgid = p->pid;
   }
+  p->task_token = task_token_next();
+  /*
+   * 线程的活动 pid 命名空间在 clone 时确定且之后不变（setns 只影响
+   * pid_ns_for_children），因此这里算一次即可。CLONE_THREAD 时
+   * copy_process 已保证 current 与新线程处于同一命名空间。
+   */
+  p->vdso_vtid = pid_nr_ns(pid, ns_of_pid(pid));
+  p->vdso_vpid =
+      (clone_flags & CLONE_THREAD) ? current->vdso_vpid : p->vdso_vtid;
 
   p->nr_dirtied = 0;
   p->nr_dirtied_pause = 128 >> (PAGE_SHIFT - 10);
@@ -2338,6 +2368,8 @@ bad_fork_cleanup_count:
   dec_rlimit_ucounts(task_ucounts(p), UCOUNT_RLIMIT_NPROC, 1);
   exit_creds(p);
 bad_fork_free:
+  // 失败路径上 p 从未对外可见，不需要 task_lock
+  if (p->sock_fair) sock_fair_put(p->sock_fair);
   WRITE_ONCE(p->__state, TASK_DEAD);
   exit_task_stack_account(p);
   put_task_stack(p);
@@ -50,6 +50,7 @@
 #include <linux/sched/nohz.h>
 #include <linux/sched/rseq_api.h>
 #include <linux/sched/rt.h>
+#include <linux/sched_ring.h>
 #include <linux/sched/signal.h>
 #include <linux/sched/wake_q.h>
 #include <linux/scs.h>
@@ -4566,6 +4567,38 @@ static inline void kmap_local_sched_in(void) {
 #endif
 }
 
+/*
+ * 向线程注册的调度事件环追加一条记录。调用时持有 rq 锁且关中断；
+ * 只有 prev/next 自己所在的 CPU 会写它们的环，因此是无锁的单生产者。
+ * head 以内核侧副本为准，用户改写共享页里的 head 不会导致越界。
+ */
+static void sched_ring_push(struct sched_ring *ring, u8 event, u8 state) {
+  struct sched_ring_header *hdr = ring->hdr;
+  struct sched_ring_record *rec = &hdr->records[ring->head & ring->mask];
+
+  rec->timestamp = ktime_get_mono_fast_ns();
+  rec->cpu = raw_smp_processor_id();
+  rec->event = event;
+  rec->state = state;
+  rec->__reserved = 0;
+  ring->head++;
+  smp_store_release(&hdr->head, ring->head);
+}
+
+static __always_inline void sched_ring_switch(struct task_struct *prev,
+                                              struct task_struct *next,
+                                              unsigned int prev_state) {
+  struct sched_ring *ring;
+
+  ring = READ_ONCE(prev->sched_ring);
+  if (unlikely(ring)) {
+    ring->last_state = __task_state_index(prev_state, prev->exit_state);
+    sched_ring_push(ring, SCHED_RING_OUT, ring->last_state);
+  }
+  ring = READ_ONCE(next->sched_ring);
+  if (unlikely(ring)) sched_ring_push(ring, SCHED_RING_IN, ring->last_state);
+}
+
 /**
  * prepare_task_switch - prepare to switch tasks
  * @rq: the runqueue preparing to switch
@@ -5991,6 +6024,9 @@ static void __sched notrace __schedule(unsigned int sched_mode) {
     psi_sched_switch(prev, next, !task_on_rq_queued(prev));
 
     trace_sched_switch(sched_mode & SM_MASK_PREEMPT, prev, next, prev_state);
+    sched_ring_switch(prev, next,
+                      (sched_mode & SM_MASK_PREEMPT) ? TASK_RUNNING
+                                                     : READ_ONCE(prev->__state));
 
     /* Also unlocks the rq: */
     rq = context_switch(rq, prev, next, &rf);
@@ -61,13 +61,17 @@
 #include <linux/user_namespace.h>
 #include <linux/utsname.h>
 #include <linux/version.h>
+#include <linux/vmalloc.h>
 #include <linux/workqueue.h>
 /* Move somewhere else to avoid recompiling? */
 #include <asm/io.h>
 #include <asm/unistd.h>
 #include <generated/utsrelease.h>
 #include <linux/kv_pair.h>
+#include <linux/sched_ring.h>
+#include <linux/sockfair.h>
 #include <linux/uaccess.h>
+#include <linux/vgettask.h>
 
 #include "uid16.h"
 
@@ -2551,13 +2555,283 @@ SYSCALL_DEFINE1(read_kv, int, k) {
   return ret;
 }
 
+/*
+ * 设置线程 tid 的 socket 上限与发送权重。无 CAP_SYS_RESOURCE 时只能修改
+ * 自己能 ptrace 的线程，上限只能收紧、权重只能调低，否则返回 -EPERM。
+ */
 SYSCALL_DEFINE3(configure_socket_fairness, pid_t, tid, int, max_sock, int,
                 priority) {
-  struct task_struct *task = find_task_by_vpid(tid);  // 通过 PID 查找线程结构体
+  struct task_struct *task;
+  long ret;
+
+  if (max_sock < 0 || priority < 0 || priority > SOCK_FAIR_PRIO_MAX)
+    return -EINVAL;
+
+  rcu_read_lock();
+  task = find_task_by_vpid(tid);  // 通过 PID 查找线程结构体
+  if (task) get_task_struct(task);
+  rcu_read_unlock();
   if (!task) return -ESRCH;
 
-  task->socket_limit = max_sock;
-  task->socket_priority = priority;
-  task->socket_count = 0;
+  ret = sock_fair_configure(task, max_sock, priority);
+  put_task_struct(task);
+  return ret;
+}
+
+/*
+ * flags 为 SOCK_FAIR_GROUP_NEW 时，在调用线程所在分组下新建子分组并加入，
+ * tid 必须为 0；之后调用线程创建的线程、子进程都在这个分组里。
+ * flags 为 0 时修改线程 tid 所在分组的上限，无 CAP_SYS_RESOURCE 时只能
+ * 收紧，见 sock_fair_group_set_limit。
+ */
+SYSCALL_DEFINE3(configure_socket_group, pid_t, tid, int, max_sock,
+                unsigned int, flags) {
+  struct task_struct *task;
+  long ret;
+
+  if (max_sock < 0) return -EINVAL;
+
+  if (flags == SOCK_FAIR_GROUP_NEW) {
+    if (tid) return -EINVAL;
+    return sock_fair_group_enter(max_sock);
+  }
+  if (flags) return -EINVAL;
+
+  rcu_read_lock();
+  task = find_task_by_vpid(tid);
+  if (task) get_task_struct(task);
+  rcu_read_unlock();
+  if (!task) return -ESRCH;
+
+  ret = sock_fair_group_set_limit(task, max_sock);
+  put_task_struct(task);
+  return ret;
+}
+
+/*
+ * 为线程 tid（flags 含 SOCK_FAIR_RATE_GROUP 时为其所在分组）设置创建
+ * socket 的速率上限：每秒 rate 个，允许突发 burst 个；rate 为 0 取消限速。
+ * 超出速率的 socket() 返回 -EAGAIN。无 CAP_SYS_RESOURCE 时只能修改自己
+ * 能 ptrace 的线程，且只能收紧，否则返回 -EPERM。
+ */
+SYSCALL_DEFINE4(configure_socket_rate, pid_t, tid, unsigned int, rate,
+                unsigned int, burst, unsigned int, flags) {
+  struct task_struct *task;
+  long ret;
+
+  if (flags & ~SOCK_FAIR_RATE_GROUP) return -EINVAL;
+
+  rcu_read_lock();
+  task = find_task_by_vpid(tid);
+  if (task) get_task_struct(task);
+  rcu_read_unlock();
+  if (!task) return -ESRCH;
+
+  ret = sock_fair_set_rate(task, rate, burst, flags & SOCK_FAIR_RATE_GROUP);
+  put_task_struct(task);
+  return ret;
+}
+
+/*
+ * 读取线程 tid 的 socket 配额与当前负载，size 为用户认识的结构体大小。
+ * 只能读取自己能以 PTRACE_MODE_READ 访问的线程，否则返回 -EPERM。
+ */
+SYSCALL_DEFINE3(get_socket_fairness, pid_t, tid,
+                struct sock_fair_info __user *, uinfo, size_t, size) {
+  struct sock_fair_info info;
+  struct task_struct *task;
+  bool allowed;
+
+  if (size > sizeof(info)) size = sizeof(info);
+
+  rcu_read_lock();
+  task = find_task_by_vpid(tid);
+  if (task) get_task_struct(task);
+  rcu_read_unlock();
+  if (!task) return -ESRCH;
+
+  allowed = ptrace_may_access(task, PTRACE_MODE_READ_REALCREDS);
+  if (allowed) sock_fair_get_info(task, &info);
+  put_task_struct(task);
+  if (!allowed) return -EPERM;
+
+  if (copy_to_user(uinfo, &info, size)) return -EFAULT;
+  return size;
+}
+
+static void fill_task_info(struct task_struct *t, struct task_info *info) {
+  unsigned int cpu = task_cpu(t);
+
+  // 与 __vdso_get_task_info 相同：pid 是全局 tid，命名空间内的值在 vpid/vtid
+  info->pid = task_pid_nr(t);
+  info->task_token = t->task_token;
+  // 批量查询面向调用者，按调用者所在命名空间换算
+  info->vpid = task_tgid_vnr(t);
+  info->vtid = task_pid_vnr(t);
+  info->cpu = cpu;
+  info->node = cpu_to_node(cpu);
+  info->nvcsw = READ_ONCE(t->nvcsw);
+  info->nivcsw = READ_ONCE(t->nivcsw);
+  info->sum_exec_runtime = READ_ONCE(t->se.sum_exec_runtime);
+  info->state = task_state_index(t);
+
+  // task->mm 只能在 task_lock 下访问，get_mm_rss 本身只读原子计数
+  task_lock(t);
+  if (t->mm) info->rss = get_mm_rss(t->mm);
+  task_unlock(t);
+}
+
+// 每段在一次 RCU 读临界区内查询的 pid 数
+#define TASK_INFO_BATCH_CHUNK 256
+
+/*
+ * 批量查询线程信息：pids[i] 对应 infos 中第 i 个元素（每个元素 size 字节，
+ * 语义同 __vdso_get_task_info）。查不到的 pid 对应元素全 0。count * size
+ * 不能超过 TASK_INFO_BATCH_MAX_BYTES。
+ * 所有结果先在内核缓冲区里拼好，最后只做一次 copy_to_user。各段分别在
+ * RCU 下查询，不同段的结果不是同一时刻的快照。
+ * 返回找到的线程个数。
+ */
+SYSCALL_DEFINE4(get_task_info_batch, const pid_t __user *, pids,
+                struct task_info __user *, infos, unsigned int, count,
+                size_t, size) {
+  size_t copy = min(size, sizeof(struct task_info));
+  pid_t *kpids;
+  char *kinfos;
+  long found = 0;
+  unsigned int i;
+
+  if (size < TASK_INFO_SIZE_VER0 || size > PAGE_SIZE) return -EINVAL;
+  if (count == 0) return 0;
+  if (count > TASK_INFO_BATCH_MAX ||
+      (size_t)count * size > TASK_INFO_BATCH_MAX_BYTES)
+    return -E2BIG;
+
+  kpids = vmemdup_user(pids, array_size(count, sizeof(pid_t)));
+  if (IS_ERR(kpids)) return PTR_ERR(kpids);
+
+  kinfos = kvcalloc(count, size, GFP_KERNEL);
+  if (!kinfos) {
+    kvfree(kpids);
+    return -ENOMEM;
+  }
+
+  // 分段查询，段间退出 RCU 读临界区并让出 CPU，大批量时不拖延宽限期
+  for (i = 0; i < count; i += TASK_INFO_BATCH_CHUNK) {
+    unsigned int end = min(count, i + TASK_INFO_BATCH_CHUNK);
+    unsigned int j;
+
+    rcu_read_lock();
+    for (j = i; j < end; ++j) {
+      struct task_info tmp = {0};
+      struct task_struct *t = find_task_by_vpid(kpids[j]);
+
+      if (!t) continue;
+      fill_task_info(t, &tmp);
+      memcpy(kinfos + (size_t)j * size, &tmp, copy);
+      found++;
+    }
+    rcu_read_unlock();
+    cond_resched();
+  }
+
+  if (copy_to_user(infos, kinfos, (size_t)count * size)) found = -EFAULT;
+
+  kvfree(kinfos);
+  kvfree(kpids);
+  return found;
+}
+
+static void sched_ring_free(struct sched_ring *ring) {
+  vunmap(ring->hdr);
+  unpin_user_pages(ring->pages, ring->nr_pages);
+  account_locked_vm(ring->mm, ring->nr_pages, false);
+  mmdrop(ring->mm);
+  kvfree(ring->pages);
+  kfree(ring);
+}
+
+void sched_ring_release(struct task_struct *t) {
+  struct sched_ring *ring = t->sched_ring;
+
+  if (!ring) return;
+  // 只有 t 自己（current）会调用这里；调度器只在 t 换入/换出时读取该指针，
+  // 清空之后不可能还有正在进行的写入
+  WRITE_ONCE(t->sched_ring, NULL);
+  sched_ring_free(ring);
+}
+
+/*
+ * 为当前线程注册调度事件环，addr 为 NULL 时注销。
+ * addr 必须页对齐，nr_records 必须是 2 的幂。重复注册会替换旧的环，注册
+ * 失败时旧的环不受影响。环占用的页计入 RLIMIT_MEMLOCK。
+ */
+SYSCALL_DEFINE2(register_sched_ring, struct sched_ring_header __user *, addr,
+                unsigned int, nr_records) {
+  struct sched_ring *ring, *old;
+  size_t size;
+  int pinned;
+  long ret;
+
+  if (!addr) {
+    sched_ring_release(current);
+    return 0;
+  }
+
+  // 先把新环完整建好再替换，注册失败时原来的环保持可用
+  if (!PAGE_ALIGNED(addr) || !is_power_of_2(nr_records) ||
+      nr_records > SCHED_RING_MAX_RECORDS)
+    return -EINVAL;
+
+  ring = kzalloc(sizeof(*ring), GFP_KERNEL);
+  if (!ring) return -ENOMEM;
+
+  size = struct_size(ring->hdr, records, nr_records);
+  ring->nr_pages = DIV_ROUND_UP(size, PAGE_SIZE);
+  ring->mask = nr_records - 1;
+  ring->pages = kvmalloc_array(ring->nr_pages, sizeof(*ring->pages),
+                               GFP_KERNEL);
+  if (!ring->pages) {
+    ret = -ENOMEM;
+    goto err_free;
+  }
+
+  // pin 住的页不能换出，与 mlock 一样计入 RLIMIT_MEMLOCK
+  ret = account_locked_vm(current->mm, ring->nr_pages, true);
+  if (ret) goto err_free;
+  ring->mm = current->mm;
+  mmgrab(ring->mm);
+
+  // 长期 pin 住用户页，调度器在关中断的上下文里写入时不会缺页
+  pinned = pin_user_pages_fast((unsigned long)addr, ring->nr_pages,
+                               FOLL_WRITE | FOLL_LONGTERM, ring->pages);
+  if (pinned != ring->nr_pages) {
+    if (pinned > 0) unpin_user_pages(ring->pages, pinned);
+    ret = pinned < 0 ? pinned : -EFAULT;
+    goto err_unaccount;
+  }
+
+  ring->hdr = vmap(ring->pages, ring->nr_pages, VM_MAP, PAGE_KERNEL);
+  if (!ring->hdr) {
+    unpin_user_pages(ring->pages, ring->nr_pages);
+    ret = -ENOMEM;
+    goto err_unaccount;
+  }
+  ring->hdr->head = 0;
+  ring->hdr->mask = ring->mask;
+
+  // 初始化完成后再发布，调度器看到指针时环一定可用；旧环的处理同
+  // sched_ring_release
+  old = current->sched_ring;
+  smp_store_release(&current->sched_ring, ring);
+  if (old) sched_ring_free(old);
   return 0;
+
+err_unaccount:
+  account_locked_vm(ring->mm, ring->nr_pages, false);
+  mmdrop(ring->mm);
+err_free:
+  kvfree(ring->pages);
+  kfree(ring);
+  return ret;
 }
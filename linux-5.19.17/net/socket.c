@@ -55,6 +55,7 @@
 #include <linux/audit.h>
 #include <linux/bpf-cgroup.h>
 #include <linux/cache.h>
+#include <linux/capability.h>
 #include <linux/compat.h>
 #include <linux/errqueue.h>
 #include <linux/ethtool.h>
@@ -78,8 +79,10 @@
 #include <linux/netfilter.h>
 #include <linux/nospec.h>
 #include <linux/nsproxy.h>
+#include <linux/pkt_sched.h>
 #include <linux/poll.h>
 #include <linux/proc_fs.h>
+#include <linux/ptrace.h>
 #include <linux/pseudo_fs.h>
 #include <linux/ptp_classify.h>
 #include <linux/ptp_clock_kernel.h>
@@ -89,6 +92,7 @@
 #include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <linux/socket.h>
+#include <linux/sockfair.h>
 #include <linux/sockios.h>
 #include <linux/syscalls.h>
 #include <linux/termios.h>
@@ -102,6 +106,9 @@
 #include <net/sock.h>
 #include <net/wext.h>
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/sockfair.h>
+
 #ifdef CONFIG_NET_RX_BUSY_POLL
 unsigned int sysctl_net_busy_read __read_mostly;
 unsigned int sysctl_net_busy_poll __read_mostly;
@@ -596,7 +603,495 @@ struct socket *sock_alloc(void) {
 }
 EXPORT_SYMBOL(sock_alloc);
 
+static void sock_fair_free(struct sock_fair *sf) {
+  if (sf->group) percpu_counter_destroy(&sf->pcount);
+  kfree(sf);
+}
+
+void sock_fair_put(struct sock_fair *sf) {
+  // 每个节点持有父分组的一个引用，释放时沿层级向上归还
+  while (sf && refcount_dec_and_test(&sf->ref)) {
+    struct sock_fair *parent = sf->parent;
+
+    sock_fair_free(sf);
+    sf = parent;
+  }
+}
+
+static struct sock_fair *sock_fair_alloc(struct sock_fair *parent,
+                                         bool group) {
+  struct sock_fair *sf = kzalloc(sizeof(*sf), GFP_KERNEL);
+
+  if (!sf) return NULL;
+  if (group && percpu_counter_init(&sf->pcount, 0, GFP_KERNEL)) {
+    kfree(sf);
+    return NULL;
+  }
+  refcount_set(&sf->ref, 1);
+  spin_lock_init(&sf->lock);
+  sf->group = group;
+  sf->parent = parent;
+  if (parent) refcount_inc(&parent->ref);
+  return sf;
+}
+
+// 线程所属的分组：线程节点的父节点，或者节点本身就是分组
+static struct sock_fair *sock_fair_group_of(struct sock_fair *sf) {
+  return sf && !sf->group ? sf->parent : sf;
+}
+
+/*
+ * 令牌桶用 GCRA 实现：tat 是下一个令牌的“理论到达时间”，取一个令牌就是
+ * 把 tat 推后一个间隔，只要推后的 tat 不超过 now + burst 个间隔就放行。
+ * 整个补充过程就是一次 cmpxchg，无锁，也不需要定时器。
+ * 失败的创建同样消耗令牌，限制的是创建尝试的速率。
+ */
+static bool sock_fair_rate_ok(struct sock_fair *sf, u64 *now) {
+  u64 interval = READ_ONCE(sf->rate_interval);
+  u64 tat, new_tat, limit;
+
+  if (!interval) return true;
+  if (!*now) *now = ktime_get_mono_fast_ns();
+
+  limit = *now + interval * READ_ONCE(sf->rate_burst);
+  tat = atomic64_read(&sf->tat);
+  do {
+    new_tat = max(tat, *now) + interval;
+    if (new_tat > limit) return false;
+  } while (!atomic64_try_cmpxchg(&sf->tat, &tat, new_tat));
+  return true;
+}
+
+static bool sock_fair_try_charge_one(struct sock_fair *sf) {
+  int limit = READ_ONCE(sf->limit);
+
+  if (sf->group) {
+    // 快路径只是一次 per-CPU 加法，离上限还远时 compare 不会去求和
+    percpu_counter_add_batch(&sf->pcount, 1, SOCK_FAIR_BATCH);
+    if (limit > 0 &&
+        __percpu_counter_compare(&sf->pcount, limit, SOCK_FAIR_BATCH) > 0) {
+      percpu_counter_add_batch(&sf->pcount, -1, SOCK_FAIR_BATCH);
+      return false;
+    }
+    return true;
+  }
+
+  if (atomic_inc_return(&sf->count) > limit && limit > 0) {
+    atomic_dec(&sf->count);
+    return false;
+  }
+  return true;
+}
+
+static void sock_fair_uncharge_one(struct sock_fair *sf) {
+  if (sf->group)
+    percpu_counter_add_batch(&sf->pcount, -1, SOCK_FAIR_BATCH);
+  else
+    atomic_dec(&sf->count);
+}
+
+static s64 sock_fair_count(struct sock_fair *sf) {
+  return sf->group ? percpu_counter_read(&sf->pcount) : atomic_read(&sf->count);
+}
+
+// 从线程节点到拒绝它的那一级（含）都记一次，线程与分组各自有拒绝总数
+static void sock_fair_reject(struct sock_fair *sf, struct sock_fair *at,
+                             int err) {
+  struct sock_fair *q;
+
+  for (q = sf; q != at->parent; q = q->parent)
+    atomic64_inc(err == -EMFILE ? &q->rejected_limit : &q->rejected_rate);
+  trace_sock_fair_reject(current->pid, READ_ONCE(at->limit),
+                         sock_fair_count(at), err);
+}
+
+static void sock_fair_set_priority(struct socket *sock, struct sock_fair *sf) {
+  int prio = READ_ONCE(sf->priority);
+
+  // 用户之后仍可用 SO_PRIORITY 覆盖
+  if (prio > 0 && sock->sk)
+    sock->sk->sk_priority = TC_H_MAKE(SOCK_FAIR_TC_MAJOR << 16, prio);
+}
+
+// i_private 的最低位标记 accept 得到的 socket，关闭时退回 accepted
+#define SOCK_FAIR_ACCEPTED 1UL
+
+/*
+ * 把新建的 socket 计入当前线程及其所有上级分组。每一级先过令牌桶，再
+ * 先加一后比较，超限时整体回退，并发创建不会越过任何一级的 limit。
+ * 未配置过配额、也不在任何分组里的线程直接放行，不做任何记账。
+ */
+int sock_fair_charge(struct socket *sock) {
+  struct sock_fair *sf = READ_ONCE(current->sock_fair);
+  struct sock_fair *p, *q;
+  u64 now = 0;  // 只有配置了限速时才读时钟
+
+  if (!sf) return 0;
+
+  for (p = sf; p; p = p->parent) {
+    if (!sock_fair_rate_ok(p, &now)) {
+      for (q = sf; q != p; q = q->parent) sock_fair_uncharge_one(q);
+      sock_fair_reject(sf, p, -EAGAIN);
+      return -EAGAIN;
+    }
+    if (!sock_fair_try_charge_one(p)) {
+      for (q = sf; q != p; q = q->parent) sock_fair_uncharge_one(q);
+      sock_fair_reject(sf, p, -EMFILE);
+      // 拒绝可能非常频繁，日志限速，完整记录看 tracepoint 与 /proc/sockfair
+      pr_warn_ratelimited("Thread %d exceeded socket limit (%d)\n",
+                          current->pid, READ_ONCE(p->limit));
+      return -EMFILE;
+    }
+  }
+
+  refcount_inc(&sf->ref);
+  SOCK_INODE(sock)->i_private = sf;
+  sock_fair_set_priority(sock, sf);
+  return 0;
+}
+
+/*
+ * accept 得到的 socket 只计入当前线程节点的 accepted，供 reuseport 按负载
+ * 分发时参考。它不占用 limit，也不受 limit 拦截：连接已经建立，拒绝只会
+ * 把它断掉；若计入 count，接满 limit 个连接的线程之后的 socket() 都会
+ * 失败。
+ */
+void sock_fair_charge_accepted(struct socket *sock) {
+  struct sock_fair *sf = READ_ONCE(current->sock_fair);
+
+  if (!sf) return;
+  atomic_inc(&sf->accepted);
+  refcount_inc(&sf->ref);
+  SOCK_INODE(sock)->i_private =
+      (void *)((unsigned long)sf | SOCK_FAIR_ACCEPTED);
+}
+
+// 把计数退回给创建 socket 时所在的节点，而不是执行关闭的线程
+void sock_fair_uncharge(struct socket *sock) {
+  unsigned long priv = (unsigned long)SOCK_INODE(sock)->i_private;
+  struct sock_fair *sf = (struct sock_fair *)(priv & ~SOCK_FAIR_ACCEPTED);
+  struct sock_fair *p;
+
+  if (!sf) return;
+  SOCK_INODE(sock)->i_private = NULL;
+  if (priv & SOCK_FAIR_ACCEPTED) {
+    atomic_dec(&sf->accepted);
+  } else {
+    // 线程节点可能正被 sock_fair_group_enter 挂到新分组下
+    spin_lock(&sf->lock);
+    for (p = sf; p; p = p->parent) sock_fair_uncharge_one(p);
+    spin_unlock(&sf->lock);
+  }
+  sock_fair_put(sf);
+}
+
+// 新线程/子进程继承父线程所在的分组，但不继承按线程配置的配额
+struct sock_fair *sock_fair_fork(void) {
+  struct sock_fair *group = sock_fair_group_of(current->sock_fair);
+
+  if (group) refcount_inc(&group->ref);
+  return group;
+}
+
+void sock_fair_exit(struct task_struct *t) {
+  struct sock_fair *sf;
+
+  task_lock(t);
+  sf = t->sock_fair;
+  t->sock_fair = NULL;
+  task_unlock(t);
+  if (sf) sock_fair_put(sf);
+}
+
+/*
+ * 设置线程 t 自己的配额。t 还没有线程节点时新建一个，挂在 t 当前所在的
+ * 分组下面。已打开的 socket 仍按原值计数，新的 limit 只影响之后的创建。
+ */
+static struct sock_fair *sock_fair_thread_node(struct task_struct *t) {
+  struct sock_fair *sf, *group, *new = NULL;
+
+again:
+  // 与 sock_fair_exit 在 task_lock 下互斥，避免给正在退出的线程挂上配额
+  task_lock(t);
+  if (t->flags & PF_EXITING) {
+    task_unlock(t);
+    if (new) sock_fair_put(new);
+    return ERR_PTR(-ESRCH);
+  }
+
+  sf = t->sock_fair;
+  if (!sf || sf->group) {
+    group = sf;
+    if (!new || new->parent != group) {
+      // 分配可能睡眠，先拿住分组再放锁；期间 t 换了分组就重新分配
+      if (group) refcount_inc(&group->ref);
+      task_unlock(t);
+      if (new) sock_fair_put(new);
+      new = sock_fair_alloc(group, false);
+      if (group) sock_fair_put(group);
+      if (!new) return ERR_PTR(-ENOMEM);
+      goto again;
+    }
+    // 新节点自己持有分组的引用，t 原先持有的那个可以归还（不会减到 0）
+    if (group) sock_fair_put(group);
+    sf = new;
+    smp_store_release(&t->sock_fair, sf);
+  }
+  refcount_inc(&sf->ref);
+  task_unlock(t);
+  return sf;
+}
+
+/*
+ * 配额与速率都是管理员用来约束 t 的，修改它们需要权限：有 CAP_SYS_RESOURCE
+ * 时返回 1，可以任意设置；否则只有能 ptrace t 的调用者可以修改，返回 0，
+ * 而且只能收紧，不然被限制的线程可以自己把限制解除，别的用户也不能借此
+ * 让 t 的 socket() 失败。
+ */
+static int sock_fair_may_modify(struct task_struct *t) {
+  if (capable(CAP_SYS_RESOURCE)) return 1;
+  if (!ptrace_may_access(t, PTRACE_MODE_ATTACH_REALCREDS)) return -EPERM;
+  return 0;
+}
+
+// a 是否不比 b 宽松，0 表示不限
+static bool sock_fair_limit_le(int a, int b) { return !b || (a && a <= b); }
+
+/*
+ * 设置线程 t 的上限与发送权重。无特权时上限只能收紧，权重只能调低（0 是
+ * 最低，不干预），用 cmpxchg 保证检查与写入之间上限没有被别人放宽。
+ */
+int sock_fair_configure(struct task_struct *t, int limit, int priority) {
+  struct sock_fair *sf;
+  int priv, old, ret = 0;
+
+  priv = sock_fair_may_modify(t);
+  if (priv < 0) return priv;
+  sf = sock_fair_thread_node(t);
+  if (IS_ERR(sf)) return PTR_ERR(sf);
+
+  if (priv) {
+    WRITE_ONCE(sf->limit, limit);
+  } else if (priority > READ_ONCE(sf->priority)) {
+    ret = -EPERM;
+  } else {
+    old = READ_ONCE(sf->limit);
+    do {
+      ret = sock_fair_limit_le(limit, old) ? 0 : -EPERM;
+    } while (!ret && !try_cmpxchg(&sf->limit, &old, limit));
+  }
+  if (!ret) WRITE_ONCE(sf->priority, priority);
+  sock_fair_put(sf);
+  return ret;
+}
+
+static u64 sock_fair_rate_interval(unsigned int rate) {
+  return rate ? max_t(u64, div_u64(NSEC_PER_SEC, rate), 1) : 0;
+}
+
+static void sock_fair_rate_set(struct sock_fair *sf, u64 interval,
+                               unsigned int burst) {
+  WRITE_ONCE(sf->rate_burst, max(burst, 1U));
+  WRITE_ONCE(sf->rate_interval, interval);
+}
+
+// 无特权时只能收紧：先收紧到上一级分组的速率，再要求不比原来的宽松
+static int sock_fair_rate_tighten(struct sock_fair *sf, u64 interval,
+                                  unsigned int burst) {
+  struct sock_fair *parent = READ_ONCE(sf->parent);
+  u64 old;
+
+  burst = max(burst, 1U);
+  if (parent && (old = READ_ONCE(parent->rate_interval))) {
+    if (!interval || interval < old) interval = old;
+    burst = min(burst, READ_ONCE(parent->rate_burst));
+  }
+  old = READ_ONCE(sf->rate_interval);
+  if (old && (!interval || interval < old ||
+              burst > READ_ONCE(sf->rate_burst)))
+    return -EPERM;
+  sock_fair_rate_set(sf, interval, burst);
+  return 0;
+}
+
+/*
+ * 设置创建 socket 的令牌桶：每秒 rate 个令牌，最多攒 burst 个，rate 为 0
+ * 表示不限速。group 为真时作用于 t 所在的整个分组（即整个进程树），否则
+ * 只作用于 t 自己。权限见 sock_fair_may_modify。
+ */
+int sock_fair_set_rate(struct task_struct *t, unsigned int rate,
+                       unsigned int burst, bool group) {
+  u64 interval = sock_fair_rate_interval(rate);
+  struct sock_fair *sf;
+  int ret = 0, priv;
+
+  priv = sock_fair_may_modify(t);
+  if (priv < 0) return priv;
+  if (group) {
+    task_lock(t);
+    sf = sock_fair_group_of(t->sock_fair);
+    if (sf) refcount_inc(&sf->ref);
+    task_unlock(t);
+    if (!sf) return -ENOENT;
+  } else {
+    sf = sock_fair_thread_node(t);
+    if (IS_ERR(sf)) return PTR_ERR(sf);
+  }
+  if (priv)
+    sock_fair_rate_set(sf, interval, burst);
+  else
+    ret = sock_fair_rate_tighten(sf, interval, burst);
+  sock_fair_put(sf);
+  return ret;
+}
+
+/*
+ * 在当前线程所在分组下建立一个新的子分组并让当前线程加入。之后创建的
+ * 线程和子进程都会继承它，因此先建组再 fork 出容器内的进程即可。
+ *
+ * 当前线程已有线程节点时，把这个节点本身挂到新分组下，而不是新建一个：
+ * 配额、权重、令牌桶和仍打开的 socket 数都原样保留，进组换不来一份新的
+ * 配额，并发的 configure_socket_fairness 写的也始终是同一个节点。节点上
+ * 仍打开的 socket 同时补记到新分组，关闭时沿新的层级逐级退回。
+ */
+int sock_fair_group_enter(int limit) {
+  struct sock_fair *old, *group, *parent;
+
+  task_lock(current);
+  old = current->sock_fair;
+  if (old) refcount_inc(&old->ref);
+  task_unlock(current);
+
+  for (;;) {
+    // 分配可能睡眠，不能持有 task_lock；old 由这里的引用保证不被释放
+    group = sock_fair_alloc(sock_fair_group_of(old), true);
+    if (!group) {
+      if (old) sock_fair_put(old);
+      return -ENOMEM;
+    }
+    group->limit = limit;
+
+    task_lock(current);
+    if (current->sock_fair == old) break;
+    // 别的线程刚给当前线程挂上了线程节点，按新的节点重来
+    sock_fair_put(old);
+    old = current->sock_fair;
+    if (old) refcount_inc(&old->ref);
+    task_unlock(current);
+    sock_fair_put(group);
+  }
+
+  if (old && !old->group) {
+    // 新建 socket 只发生在当前线程，这里只需与关闭互斥
+    spin_lock(&old->lock);
+    percpu_counter_add(&group->pcount, atomic_read(&old->count));
+    parent = old->parent;
+    WRITE_ONCE(old->parent, group);  // 接管 group 的初始引用
+    spin_unlock(&old->lock);
+    task_unlock(current);
+    // group 自己持有 parent 的引用，这里归还的是 old 原先持有的
+    if (parent) sock_fair_put(parent);
+    sock_fair_put(old);
+    return 0;
+  }
+
+  smp_store_release(&current->sock_fair, group);
+  task_unlock(current);
+  if (old) {
+    sock_fair_put(old);  // current 原先持有的
+    sock_fair_put(old);  // 这里持有的
+  }
+  return 0;
+}
+
+void sock_fair_get_info(struct task_struct *t, struct sock_fair_info *info) {
+  struct sock_fair *sf, *group;
+
+  memset(info, 0, sizeof(*info));
+  task_lock(t);
+  sf = t->sock_fair;
+  if (sf && !sf->group) {
+    info->limit = READ_ONCE(sf->limit);
+    info->count = atomic_read(&sf->count);
+    info->accepted = atomic_read(&sf->accepted);
+    info->priority = READ_ONCE(sf->priority);
+    info->rejected_limit = atomic64_read(&sf->rejected_limit);
+    info->rejected_rate = atomic64_read(&sf->rejected_rate);
+  }
+  group = sock_fair_group_of(sf);
+  if (group) {
+    info->group_limit = READ_ONCE(group->limit);
+    info->group_count = percpu_counter_sum(&group->pcount);
+    info->group_rejected = atomic64_read(&group->rejected_limit) +
+                           atomic64_read(&group->rejected_rate);
+  }
+  task_unlock(t);
+}
+
+#ifdef CONFIG_PROC_FS
+// /proc/sockfair：每个配置过 socket 配额（或处在分组中）的线程一行。只列出
+// 读者所在 pid 命名空间里看得到的线程，容器内看不到宿主机和别的容器
+static int sock_fair_proc_show(struct seq_file *m, void *v) {
+  struct task_struct *p, *t;
+  struct sock_fair_info info;
+  pid_t tid;
+
+  seq_puts(m,
+           "tid\tlimit\tcount\taccepted\tprio\trej_limit\trej_rate\t"
+           "grp_limit\tgrp_count\tgrp_rej\n");
+  rcu_read_lock();
+  for_each_process_thread(p, t) {
+    if (!READ_ONCE(t->sock_fair)) continue;
+    tid = task_pid_vnr(t);
+    if (!tid) continue;
+    sock_fair_get_info(t, &info);
+    seq_printf(m, "%d\t%d\t%d\t%d\t%d\t%lld\t%lld\t%d\t%lld\t%lld\n",
+               tid, info.limit, info.count, info.accepted,
+               info.priority, info.rejected_limit, info.rejected_rate,
+               info.group_limit, info.group_count, info.group_rejected);
+  }
+  rcu_read_unlock();
+  return 0;
+}
+
+static int __init sock_fair_proc_init(void) {
+  proc_create_single("sockfair", 0400, NULL, sock_fair_proc_show);
+  return 0;
+}
+fs_initcall(sock_fair_proc_init);
+#endif
+
+/*
+ * 修改线程 t 所在分组的上限。无特权时只能收紧：新上限先收紧到上一级
+ * 分组的上限，再用 cmpxchg 保证它不比修改前的宽松。
+ */
+int sock_fair_group_set_limit(struct task_struct *t, int limit) {
+  struct sock_fair *group;
+  int ret = -ENOENT, priv, old, parent_limit;
+
+  priv = sock_fair_may_modify(t);
+  if (priv < 0) return priv;
+
+  task_lock(t);
+  group = sock_fair_group_of(t->sock_fair);
+  if (group && priv) {
+    WRITE_ONCE(group->limit, limit);
+    ret = 0;
+  } else if (group) {
+    parent_limit = group->parent ? READ_ONCE(group->parent->limit) : 0;
+    if (!sock_fair_limit_le(limit, parent_limit)) limit = parent_limit;
+    old = READ_ONCE(group->limit);
+    do {
+      ret = sock_fair_limit_le(limit, old) ? 0 : -EPERM;
+    } while (!ret && !try_cmpxchg(&group->limit, &old, limit));
+  }
+  task_unlock(t);
+  return ret;
+}
+
 static void __sock_release(struct socket *sock, struct inode *inode) {
+  sock_fair_uncharge(sock);
+
   if (sock->ops) {
     struct module *owner = sock->ops->owner;
 
@@ -615,11 +1110,6 @@ static void __sock_release(struct socket *sock, struct inode *inode) {
     return;
   }
   sock->file = NULL;
-
-  // 释放 socket 后，减少当前线程的 socket 计数
-  if (current->socket_count > 0) {
-    current->socket_count--;
-  }
 }
 
 /**
@@ -1396,18 +1886,13 @@ int __sock_create(struct net *net, int family, int type, int protocol,
   module_put(pf->owner);
   err = security_socket_post_create(sock, family, type, protocol, kern);
   if (err) goto out_sock_release;
-  *res = sock;
 
-  // 检查是否超出当前线程设置的 socket 限制
-  if (current->socket_limit > 0 &&
-      current->socket_count >= current->socket_limit) {
-    pr_warn("Thread %d exceeded socket limit (%d)\n", current->pid,
-            current->socket_limit);
-    return -EMFILE;
+  // 检查是否超出当前线程设置的 socket 限制，内核内部的 socket 不计入
+  if (!kern) {
+    err = sock_fair_charge(sock);
+    if (err) goto out_sock_release;
   }
-
-  // 合法则递增 socket 计数
-  current->socket_count++;
+  *res = sock;
 
   return 0;
 
@@ -1704,6 +2189,9 @@ struct file *do_accept(struct file *file, unsigned file_flags,
       sock->ops->accept(sock, newsock, sock->file->f_flags | file_flags, false);
   if (err < 0) goto out_fd;
 
+  // 新连接计入执行 accept 的线程，供 reuseport 按负载分发时参考
+  sock_fair_charge_accepted(newsock);
+
   if (upeer_sockaddr) {
     len = newsock->ops->getname(newsock, (struct sockaddr *)&address, 2);
     if (len < 0) {